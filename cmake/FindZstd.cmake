@@ -0,0 +1,42 @@
+# Try to find libzstd headers and libraries.
+#
+# Usage of this module as follows:
+#
+#     include(FindZstd)
+#
+# Variables used by this module, they can change the default behaviour and need
+# to be set before calling find_package:
+#
+#  ZSTD_PREFIX         Set this variable to the root installation of
+#                      libzstd if the module has problems finding the
+#                      proper installation path.
+#
+# Variables defined by this module:
+#
+#  ZSTD_FOUND              System has libzstd libraries and headers
+#  ZSTD_LIBRARY            The libzstd library
+#  ZSTD_INCLUDE_DIR        The location of libzstd headers
+
+if (ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+  set(ZSTD_FIND_QUIETLY true)
+endif()
+
+find_path(ZSTD_INCLUDE_DIR zstd.h
+  HINTS ${ZSTD_PREFIX}/include
+)
+
+find_library(ZSTD_LIBRARY
+  NAMES zstd
+  HINTS ${ZSTD_PREFIX}/lib
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD DEFAULT_MSG
+  ZSTD_LIBRARY
+  ZSTD_INCLUDE_DIR
+)
+
+mark_as_advanced(
+  ZSTD_INCLUDE_DIR
+  ZSTD_LIBRARY
+)
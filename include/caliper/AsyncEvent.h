@@ -8,7 +8,7 @@
 #ifndef CALI_ASYNC_EVENT_H
 #define CALI_ASYNC_EVENT_H
 
-#include <chrono>
+#include <cstdint>
 #include <memory>
 
 namespace cali
@@ -18,19 +18,17 @@ class Node;
 
 class TimedAsyncEvent
 {
-    using clock = std::chrono::steady_clock;
-
     Node* end_tree_node_;
-    std::chrono::time_point<clock> start_time_;
+    uint64_t start_time_;
 
-    explicit TimedAsyncEvent(Node* node) : end_tree_node_ { node }, start_time_ { clock::now() } { }
+    TimedAsyncEvent(Node* node, uint64_t start_time) : end_tree_node_ { node }, start_time_ { start_time } { }
 
 public:
 
 #if __cplusplus >= 201402L
-    constexpr TimedAsyncEvent() : end_tree_node_ { nullptr } { }
+    constexpr TimedAsyncEvent() : end_tree_node_ { nullptr }, start_time_ { 0 } { }
 #else
-    TimedAsyncEvent() : end_tree_node_ { nullptr } { }
+    TimedAsyncEvent() : end_tree_node_ { nullptr }, start_time_ { 0 } { }
 #endif
 
     void end();
@@ -90,6 +90,10 @@ public:
         /// \brief Invoked when a new thread context is being created.
         caliper_cbvec create_thread_evt;
         /// \brief Invoked when a thread context is being released.
+        ///
+        /// The thread's blackboard is cleared afterwards and its context is
+        /// handed to the next new thread. Services can keep released
+        /// per-thread state and re-use it in create_thread_evt.
         caliper_cbvec release_thread_evt;
 
         /// \brief Invoked at the end of a %Caliper channel initialization.
@@ -266,6 +270,43 @@ public:
     /// \param attr Attribute key.
     void end_with_value_check(const Attribute& attr, const Variant& data);
 
+    /// \brief Begin region \a attr:\a data with a pre-resolved context
+    ///   tree node.
+    ///
+    /// A fast path of begin() for callers that cache context tree nodes.
+    /// It invokes the pre_begin/post_begin callbacks like begin(), but
+    /// puts \a node on the blackboard directly instead of looking up
+    /// \a data under the current region path. \a node must be a
+    /// descendant of the current region path (see get_region_path())
+    /// and contain the \a attr:\a data entry. \a attr must be a
+    /// reference (not as-value) attribute.
+    ///
+    /// This function is signal safe.
+    ///
+    /// \param attr Attribute key
+    /// \param data Value to set
+    /// \param node Pre-resolved region path
+    void begin_path(const Attribute& attr, const Variant& data, Node* node);
+
+    /// \brief End region \a attr started with begin_path().
+    ///
+    /// Checks that \a node is the current region path, invokes the
+    /// pre_end callbacks like end(), and resets the region path to
+    /// \a parent. Use a null \a parent to clear the region path.
+    ///
+    /// This function is signal safe.
+    ///
+    /// \param attr   Attribute key
+    /// \param node   The region path given to begin_path()
+    /// \param parent The region path to restore
+    void end_path(const Attribute& attr, Node* node, Node* parent);
+
+    /// \brief Return the current region path for reference attribute
+    ///   \a attr on the process or thread blackboard.
+    ///
+    /// \return The blackboard node, or a null pointer if it is empty.
+    Node* get_region_path(const Attribute& attr);
+
     /// \brief Set attribute:value pair on the process or thread blackboard
     ///
     /// Set the given attribute/value pair on the blackboard. Overwrites
@@ -60,6 +60,20 @@ public:
     /// appends to it. Only applies to file streams.
     void set_mode(Mode mode);
 
+    /// \brief Set the stream's compression format
+    ///
+    /// \a format is "none", "gzip", "zstd", or "auto". With "auto" (the
+    /// default), file streams with a ".gz" or ".zst" suffix are compressed
+    /// with the corresponding format. An explicitly set format also applies
+    /// to stdout, stderr, and user-given streams. The compressed stream is
+    /// finalized when the stream is closed, i.e. when the last copy of the
+    /// OutputStream object is destroyed or the stream is re-assigned.
+    /// Falls back to uncompressed output if this Caliper build does not
+    /// support the format.
+    ///
+    /// \return \c false if \a format is not a known format name
+    bool set_compression(const char* format);
+
     /// \brief Create stream's filename from the given format string pattern and
     ///   entry list.
     ///
@@ -95,6 +95,10 @@ public:
 
     std::ostream& write_cali(std::ostream& os);
 
+    /// \brief Append the value in .cali format to \a buf. Produces the
+    ///   same output as write_cali(std::ostream&).
+    void append_cali(std::string& buf) const;
+
     static Variant unpack(const unsigned char* buf, size_t* inc, bool* ok = nullptr)
     {
         return {cali_variant_unpack(buf, inc, ok)};
@@ -18,6 +18,11 @@ class CaliperMetadataAccessInterface;
 class Node;
 class OutputStream;
 
+/// \brief Writes records in .cali format
+///
+/// Records are buffered and written to the output stream in large blocks.
+/// The buffered data is written out when flush() is called or the last
+/// copy of the writer object is destroyed.
 class CaliWriter
 {
     struct CaliWriterImpl;
@@ -36,6 +41,9 @@ public:
     void write_snapshot(const CaliperMetadataAccessInterface&, const std::vector<Entry>&);
 
     void write_globals(const CaliperMetadataAccessInterface&, const std::vector<Entry>&);
+
+    /// \brief Write out buffered records
+    void flush();
 };
 
 } // namespace cali
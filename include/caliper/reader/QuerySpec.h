@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <map>
 #include <string>
 #include <vector>
@@ -121,6 +122,9 @@ struct QuerySpec {
     /// \brief List of sort specifications
     SortSelection sort;
 
+    /// \brief Max number of output records (i.e., "LIMIT n"). 0 means no limit.
+    std::size_t limit = 0;
+
     /// \brief Output formatter specification
     FormatSpec format;
 
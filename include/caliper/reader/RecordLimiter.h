@@ -0,0 +1,50 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+/// \file RecordLimiter.h
+/// \brief Defines RecordLimiter
+
+#pragma once
+
+#include "QuerySpec.h"
+#include "RecordProcessor.h"
+
+#include <memory>
+
+namespace cali
+{
+
+class CaliperMetadataAccessInterface;
+
+/// \brief Select the first (or, with a sort spec, the top) N records of
+///   a record stream ("LIMIT N" clause)
+/// \ingroup ReaderAPI
+///
+/// Keeps at most N records in a bounded heap ordered by the query's
+/// ORDER BY attributes. Records are forwarded in sort order on flush().
+/// Typically placed between Aggregator::flush() and the formatter so
+/// that top-k reports over large aggregations use O(N) memory.
+
+class RecordLimiter
+{
+    struct RecordLimiterImpl;
+    std::shared_ptr<RecordLimiterImpl> mP;
+
+public:
+
+    RecordLimiter(const QuerySpec& spec);
+
+    ~RecordLimiter();
+
+    /// \brief Returns \a true if the spec defines a record limit
+    bool is_active() const;
+
+    void add(CaliperMetadataAccessInterface& db, const EntryList& list);
+
+    void operator() (CaliperMetadataAccessInterface& db, const EntryList& list) { add(db, list); }
+
+    /// \brief Forward the selected records in sort order to \a push and clear
+    void flush(CaliperMetadataAccessInterface& db, SnapshotProcessFn push);
+};
+
+} // namespace cali
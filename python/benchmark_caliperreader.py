@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+
+# Compares read times of the pure-Python and the native (compiled) .cali reader.
+#
+# Usage: benchmark_caliperreader.py FILE [REPETITIONS]
+#
+# The native reader requires Caliper's Python bindings (pycaliper) on the
+# Python path.
+
+import sys
+import time
+
+import caliperreader
+
+
+def measure(name, fn, reps):
+    best = None
+    for _ in range(reps):
+        t0 = time.perf_counter()
+        fn()
+        t = time.perf_counter() - t0
+        best = t if best is None else min(best, t)
+    print("{0:<32} {1:10.3f} s".format(name, best))
+    return best
+
+
+def read_python_records(file):
+    caliperreader.CaliperReader().read(file)
+
+
+def read_python_columns(file):
+    caliperreader.read_caliper_columns(file, native=False)
+
+
+def read_native_records(file):
+    r = caliperreader.NativeCaliperReader()
+    r.read(file)
+    r.records
+
+
+def read_native_columns(file):
+    caliperreader.read_caliper_columns(file, native=True)
+
+
+if __name__ == "__main__":
+    file = sys.argv[1]
+    reps = int(sys.argv[2]) if len(sys.argv) > 2 else 3
+
+    t_py = measure("python: records", lambda: read_python_records(file), reps)
+    measure("python: columns", lambda: read_python_columns(file), reps)
+
+    if caliperreader.have_native_reader():
+        t_nat = measure("native: records", lambda: read_native_records(file), reps)
+        measure("native: columns", lambda: read_native_columns(file), reps)
+
+        print("speedup (records): {0:.1f}x".format(t_py / t_nat))
+    else:
+        print("native reader not available (build Caliper with -DWITH_PYTHON_BINDINGS=On)")
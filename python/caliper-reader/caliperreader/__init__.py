@@ -5,3 +5,4 @@
 
 from .caliperreader import CaliperReader, read_caliper_globals, read_caliper_contents
 from .caliperstreamreader import CaliperStreamReader
+from .nativereader import NativeCaliperReader, have_native_reader, read_caliper_columns
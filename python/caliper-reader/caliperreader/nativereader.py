@@ -0,0 +1,203 @@
+# Copyright (c) 2020, Lawrence Livermore National Security, LLC.
+# See top-level LICENSE file for details.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+
+from array import array
+
+from .caliperreader import CaliperReader
+
+try:
+    from pycaliper.__pycaliper_impl import reader as _native
+except ImportError:
+    _native = None
+
+
+def have_native_reader():
+    """ Returns True if the compiled reader extension (built with Caliper's
+    Python bindings) is available.
+    """
+    return _native is not None
+
+
+class NativeAttribute:
+    """ Attribute info for the native reader.
+
+    Provides the same query methods as the pure-Python Attribute class.
+    """
+
+    def __init__(self, metadata):
+        self._meta = metadata
+
+    def name(self):
+        return self._meta['cali.attribute.name']
+
+    def id(self):
+        return self._meta['id']
+
+    def get(self, attribute):
+        return self._meta.get(attribute)
+
+    def attribute_type(self):
+        return self._meta['type']
+
+    def is_nested(self):
+        return self._meta['is_nested']
+
+    def is_value(self):
+        return self._meta['is_value']
+
+    def is_global(self):
+        return self._meta['is_global']
+
+    def is_hidden(self):
+        return self._meta['is_hidden']
+
+    def is_aggregatable(self):
+        return self._meta['is_aggregatable']
+
+    def scope(self):
+        scopemap = { 12: "process", 20: "thread", 24: "task" }
+        return scopemap.get(self._meta['properties'] & 60, "UNKNOWN")
+
+    def metadata(self):
+        return { k: v for k, v in self._meta.items() if k not in ('id', 'properties', 'is_hidden') }
+
+
+class NativeCaliperReader:
+    """ Reads a Caliper .cali file using the compiled reader extension.
+
+    Has the same interface as CaliperReader, and additionally provides
+    the records in columnar form with columns(). Note that values in the
+    "records" list-of-dicts are converted from their typed representation,
+    so floating-point values may be formatted differently than in the
+    original file.
+
+    Attributes:
+        records : list-of-dicts
+            The snapshot records read from the .cali file.
+        globals : dict
+            The global key:value attributes defined in the .cali file
+    """
+
+    def __init__(self):
+        if _native is None:
+            raise RuntimeError("caliperreader: native reader extension is not available")
+
+        self._reader = _native.CaliReader()
+        self._records = None
+
+        self.globals = {}
+
+
+    def read(self, filename):
+        """ Read a .cali file. Only file names (not streams) are supported.
+        """
+
+        self._reader.read(filename)
+        self._records = None
+        self.globals = self._reader.globals()
+
+
+    @property
+    def records(self):
+        if self._records is None:
+            self._records = self._reader.records()
+        return self._records
+
+
+    def columns(self):
+        """ Return the records in columnar form.
+
+        See read_caliper_columns() for the format.
+        """
+        return self._reader.columns()
+
+
+    def attributes(self):
+        """ Return the list of (non-hidden) attribute names.
+        """
+        return self._reader.attributes()
+
+
+    def attribute(self, attribute_name):
+        """ Return an attribute object for the given attribute name.
+        """
+        return NativeAttribute(self._reader.attribute_metadata(attribute_name))
+
+
+_array_typecodes = { 'int': 'q', 'uint': 'Q', 'double': 'd', 'bool': 'B' }
+
+
+def _python_columns(reader):
+    """ Build the columnar representation from a pure-Python CaliperReader.
+    """
+
+    num_rows = len(reader.records)
+    columns = {}
+
+    for name in reader.attributes() + [ 'path' ]:
+        typecode = None
+
+        if name in reader.db.attributes:
+            attr = reader.attribute(name)
+            if attr.is_value():
+                typecode = _array_typecodes.get(attr.attribute_type())
+
+        values = [ rec.get(name) for rec in reader.records ]
+
+        if all(v is None for v in values):
+            continue
+
+        if typecode is None:
+            columns[name] = values
+        else:
+            conv = float if typecode == 'd' else int
+            vals = array(typecode, [ 0 ] * num_rows)
+            valid = array('B', [ 0 ] * num_rows)
+
+            for i, v in enumerate(values):
+                if v is not None:
+                    vals[i] = conv(v) if typecode != 'B' else int(v in ('true', 'True', '1'))
+                    valid[i] = 1
+
+            columns[name] = (vals, valid)
+
+    return columns
+
+
+def read_caliper_columns(filename, native=None):
+    """ Reads a Caliper .cali file and returns its records in columnar form.
+
+    Uses the compiled reader extension if it is available, and the
+    pure-Python reader otherwise.
+
+    Arguments:
+        filename:
+            Name of the .cali file.
+        native:
+            Force (True) or disable (False) the native reader. By default,
+            the native reader is used if available.
+
+    Returns:
+        (columns, globals):
+            columns is a dict with one entry per attribute. Numeric value
+            attributes are stored as a (values, valid) tuple of typed
+            buffers that can be passed to numpy.asarray(); valid[i] is 1 if
+            record i has a value for the attribute. All other attributes
+            are lists with one entry (or None) per record. globals contains
+            the global key:value attributes as a dict.
+    """
+
+    if native is None:
+        native = have_native_reader()
+
+    if native:
+        reader = NativeCaliperReader()
+        reader.read(filename)
+        return (reader.columns(), reader.globals)
+
+    reader = CaliperReader()
+    reader.read(filename)
+
+    return (_python_columns(reader), reader.globals)
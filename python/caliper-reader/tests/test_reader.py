@@ -88,5 +88,42 @@ class CaliperReaderBasic(unittest.TestCase):
         self.assertEqual(globals['region_balance'], '1')
         self.assertEqual(globals['user'], 'david')
 
+    def test_read_columns(self):
+        columns, globals = cr.read_caliper_columns('example-profile.cali', native=False)
+
+        self.assertEqual(len(globals), 22)
+
+        self.assertIn('path', columns)
+        self.assertEqual(len(columns['path']), 25)
+
+        values, valid = columns['avg#inclusive#sum#time.duration']
+
+        self.assertEqual(len(values), 25)
+        self.assertEqual(len(valid), 25)
+
+        records, _ = cr.read_caliper_contents('example-profile.cali')
+
+        for i, rec in enumerate(records):
+            if 'avg#inclusive#sum#time.duration' in rec:
+                self.assertEqual(valid[i], 1)
+                self.assertAlmostEqual(values[i], float(rec['avg#inclusive#sum#time.duration']))
+            else:
+                self.assertEqual(valid[i], 0)
+
+    @unittest.skipUnless(cr.have_native_reader(), "native reader not available")
+    def test_native_reader(self):
+        r = cr.NativeCaliperReader()
+        r.read('example-profile.cali')
+
+        self.assertEqual(len(r.records), 25)
+        self.assertEqual(r.globals['threads'], '2')
+        self.assertTrue(r.attribute('function').is_nested())
+        self.assertIn('avg#inclusive#sum#time.duration', r.attributes())
+
+        columns = r.columns()
+        values, valid = columns['avg#inclusive#sum#time.duration']
+
+        self.assertEqual(len(values), 25)
+
 if __name__ == "__main__":
     unittest.main()
@@ -6,6 +6,8 @@
 #include "caliper/Caliper.h"
 #include "caliper/SnapshotRecord.h"
 
+#include "../common/util/clock.h"
+
 using namespace cali;
 
 namespace
@@ -59,7 +61,8 @@ Node async_event_root_node { CALI_INV_ID, CALI_INV_ID, Variant() };
 
 void TimedAsyncEvent::end()
 {
-    uint64_t nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_time_).count();
+    const util::Clock& clock = util::Clock::get();
+    uint64_t nsec = clock.to_nsec(clock.now() - start_time_);
 
     Caliper c;
     Attribute duration_attr = ::get_event_duration_attr(c);
@@ -82,5 +85,5 @@ TimedAsyncEvent TimedAsyncEvent::begin(const char* message)
 
     c.async_event(SnapshotView(Entry(begin_node)));
 
-    return TimedAsyncEvent(end_node);
+    return TimedAsyncEvent(end_node, util::Clock::get().now());
 }
\ No newline at end of file
@@ -107,6 +107,24 @@ void Blackboard::del(cali_id_t key)
         toctoc &= ~(1 << (I / 32));
 }
 
+void Blackboard::clear()
+{
+    std::lock_guard<util::spinlock> g(lock);
+
+    // the toc only tracks snapshot entries, so we have to scan everything
+    for (size_t i = 0; i < Nmax; ++i)
+        if (hashtable[i].key != CALI_INV_ID)
+            hashtable[i] = blackboard_entry_t();
+
+    for (size_t j = 0; j < (Nmax + 31) / 32; ++j)
+        toc[j] = 0;
+
+    toctoc      = 0;
+    num_entries = 0;
+
+    ++ucount;
+}
+
 Entry Blackboard::exchange(cali_id_t key, const Entry& value, bool include_in_snapshots)
 {
     std::lock_guard<util::spinlock> g(lock);
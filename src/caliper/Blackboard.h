@@ -97,6 +97,9 @@ public:
     void set(cali_id_t key, const Entry& value, bool include_in_snapshots);
     void del(cali_id_t key);
 
+    /// \brief Remove all entries
+    void clear();
+
     Entry exchange(cali_id_t key, const Entry& value, bool include_in_snapshots);
 
     void snapshot(SnapshotBuilder& rec) const;
@@ -262,6 +262,19 @@ struct Caliper::ThreadData {
             print_detailed_stats(Log(2).stream());
     }
 
+    /// \brief Reset per-thread state so the object can be handed to a new
+    ///   thread. The metadata tree is kept: its nodes may still be referenced
+    ///   by snapshot data in the services.
+    void reset()
+    {
+        thread_blackboard.clear();
+        snapshot.reset();
+        process_snapshot.reset();
+
+        process_bb_count = -1;
+        stack_error      = false;
+    }
+
     void print_detailed_stats(std::ostream& os)
     {
         tree.print_statistics(os << "Releasing Caliper thread data: \n") << std::endl;
@@ -313,7 +326,23 @@ struct Caliper::GlobalData {
 
     size_t max_active_channels;
 
+    //   Flattened callback tables for the annotation update events over all
+    // active channels. Channels without callbacks for an event are left
+    // out, so begin/end/set don't visit them at all. The tables are rebuilt
+    // whenever the set of active channels changes.
+
+    struct UpdateCallback {
+        Channel*                       channel;
+        Channel::Events::update_cbvec* cbvec;
+    };
+
+    vector<UpdateCallback> pre_begin_cbs;
+    vector<UpdateCallback> post_begin_cbs;
+    vector<UpdateCallback> pre_set_cbs;
+    vector<UpdateCallback> pre_end_cbs;
+
     vector<ThreadData*> thread_data;
+    vector<ThreadData*> thread_data_pool; // released thread data objects for reuse
     std::mutex          thread_data_lock;
 
     // --- constructor
@@ -358,6 +387,27 @@ struct Caliper::GlobalData {
         Log::fini();
     }
 
+    void update_callback_tables()
+    {
+        pre_begin_cbs.clear();
+        post_begin_cbs.clear();
+        pre_set_cbs.clear();
+        pre_end_cbs.clear();
+
+        for (Channel& channel : active_channels) {
+            Channel::Events& events = channel.mP->events;
+
+            if (!events.pre_begin_evt.empty())
+                pre_begin_cbs.push_back({ &channel, &events.pre_begin_evt });
+            if (!events.post_begin_evt.empty())
+                post_begin_cbs.push_back({ &channel, &events.post_begin_evt });
+            if (!events.pre_set_evt.empty())
+                pre_set_cbs.push_back({ &channel, &events.pre_set_evt });
+            if (!events.pre_end_evt.empty())
+                pre_end_cbs.push_back({ &channel, &events.pre_end_evt });
+        }
+    }
+
     void parse_attribute_config(const ConfigSet& config)
     {
         auto preset_cfg = config.get("attribute_properties").to_stringlist();
@@ -415,6 +465,34 @@ struct Caliper::GlobalData {
         return t;
     }
 
+    /// \brief Get thread data for a new thread. Re-uses thread data of
+    ///   previously released threads if possible.
+    ThreadData* acquire_thread_data()
+    {
+        {
+            std::lock_guard<std::mutex> g(thread_data_lock);
+
+            if (!thread_data_pool.empty()) {
+                ThreadData* t = thread_data_pool.back();
+                thread_data_pool.pop_back();
+
+                tObj.t_ptr = t;
+                return t;
+            }
+        }
+
+        return add_thread_data(new ThreadData(false /* is_initial_thread */));
+    }
+
+    /// \brief Return a released thread's data to the pool
+    void recycle_thread_data(ThreadData* t)
+    {
+        t->reset();
+
+        std::lock_guard<std::mutex> g(thread_data_lock);
+        thread_data_pool.push_back(t);
+    }
+
     //   S_TLSObject uses C++ thread-local storage to hold a pointer to the
     // thread-local data. This is for lookup only, GlobalData owns all
     // ThreadData objects. The object also notifies us of thread destruction
@@ -439,6 +517,7 @@ struct Caliper::GlobalData {
                     delete gObj.g_ptr;
                 } else {
                     c.release_thread();
+                    gObj.g_ptr->recycle_thread_data(t_ptr);
                 }
             }
 
@@ -953,8 +1032,8 @@ void Caliper::begin(const Attribute& attr, const Variant& data)
 
     // invoke callbacks
     if (run_events)
-        for (auto& channel : sG->active_channels)
-            channel.mP->events.pre_begin_evt(this, &channel, attr, data);
+        for (auto& cb : sG->pre_begin_cbs)
+            (*cb.cbvec)(this, cb.channel, attr, data);
 
     if (scope == CALI_ATTR_SCOPE_THREAD)
         handle_begin(attr, data, prop, sT->thread_blackboard, sT->tree);
@@ -963,8 +1042,8 @@ void Caliper::begin(const Attribute& attr, const Variant& data)
 
     // invoke callbacks
     if (run_events)
-        for (auto& channel : sG->active_channels)
-            channel.mP->events.post_begin_evt(this, &channel, attr, data);
+        for (auto& cb : sG->post_begin_cbs)
+            (*cb.cbvec)(this, cb.channel, attr, data);
 }
 
 void Caliper::end(const Attribute& attr)
@@ -998,8 +1077,8 @@ void Caliper::end(const Attribute& attr)
 
     // invoke callbacks
     if (run_events)
-        for (auto& channel : sG->active_channels)
-            channel.mP->events.pre_end_evt(this, &channel, attr, current.entry.value());
+        for (auto& cb : sG->pre_end_cbs)
+            (*cb.cbvec)(this, cb.channel, attr, current.entry.value());
 
     handle_end(attr, prop, current, key, *blackboard, sT->tree);
 }
@@ -1036,12 +1115,103 @@ void Caliper::end_with_value_check(const Attribute& attr, const Variant& data)
 
     // invoke callbacks
     if (run_events)
-        for (auto& channel : sG->active_channels)
-            channel.mP->events.pre_end_evt(this, &channel, attr, current.entry.value());
+        for (auto& cb : sG->pre_end_cbs)
+            (*cb.cbvec)(this, cb.channel, attr, current.entry.value());
 
     handle_end(attr, prop, current, key, *blackboard, sT->tree);
 }
 
+void Caliper::begin_path(const Attribute& attr, const Variant& data, Node* node)
+{
+    if (sT->stack_error)
+        return;
+
+    int prop  = attr.properties();
+    int scope = prop & CALI_ATTR_SCOPE_MASK;
+
+    bool run_events = !(prop & CALI_ATTR_SKIP_EVENTS);
+
+    Blackboard* blackboard = nullptr;
+
+    if (scope == CALI_ATTR_SCOPE_THREAD)
+        blackboard = &sT->thread_blackboard;
+    else if (scope == CALI_ATTR_SCOPE_PROCESS)
+        blackboard = &sG->process_blackboard;
+    else
+        return;
+
+    std::lock_guard<::siglock> g(sT->lock);
+
+    if (run_events)
+        for (auto& cb : sG->pre_begin_cbs)
+            (*cb.cbvec)(this, cb.channel, attr, data);
+
+    blackboard->set(get_blackboard_key_for_reference_entry(prop), Entry(node), !(prop & CALI_ATTR_HIDDEN));
+
+    if (run_events)
+        for (auto& cb : sG->post_begin_cbs)
+            (*cb.cbvec)(this, cb.channel, attr, data);
+}
+
+void Caliper::end_path(const Attribute& attr, Node* node, Node* parent)
+{
+    if (sT->stack_error)
+        return;
+
+    int prop  = attr.properties();
+    int scope = prop & CALI_ATTR_SCOPE_MASK;
+
+    bool run_events = !(prop & CALI_ATTR_SKIP_EVENTS);
+
+    cali_id_t   key        = get_blackboard_key_for_reference_entry(prop);
+    Blackboard* blackboard = nullptr;
+
+    if (scope == CALI_ATTR_SCOPE_THREAD)
+        blackboard = &sT->thread_blackboard;
+    else if (scope == CALI_ATTR_SCOPE_PROCESS)
+        blackboard = &sG->process_blackboard;
+    else
+        return;
+
+    std::lock_guard<::siglock> g(sT->lock);
+
+    Entry current = blackboard->get(key);
+
+    if (current.node() != node) {
+        log_stack_error(current.node(), attr);
+        sT->stack_error = true;
+        return;
+    }
+
+    if (run_events)
+        for (auto& cb : sG->pre_end_cbs)
+            (*cb.cbvec)(this, cb.channel, attr, current.get(attr).value());
+
+    if (!parent || parent == sT->tree.root())
+        blackboard->del(key);
+    else
+        blackboard->set(key, Entry(parent), !(prop & CALI_ATTR_HIDDEN));
+}
+
+Node* Caliper::get_region_path(const Attribute& attr)
+{
+    int prop  = attr.properties();
+    int scope = prop & CALI_ATTR_SCOPE_MASK;
+
+    Blackboard* blackboard = nullptr;
+
+    if (scope == CALI_ATTR_SCOPE_THREAD)
+        blackboard = &sT->thread_blackboard;
+    else if (scope == CALI_ATTR_SCOPE_PROCESS)
+        blackboard = &sG->process_blackboard;
+    else
+        return nullptr;
+
+    std::lock_guard<::siglock> g(sT->lock);
+
+    return blackboard->get(get_blackboard_key_for_reference_entry(prop)).node();
+}
+
 void Caliper::set(const Attribute& attr, const Variant& data)
 {
     if (sT->stack_error)
@@ -1056,8 +1226,8 @@ void Caliper::set(const Attribute& attr, const Variant& data)
 
     // invoke callbacks
     if (run_events)
-        for (auto& channel : sG->active_channels)
-            channel.mP->events.pre_set_evt(this, &channel, attr, data);
+        for (auto& cb : sG->pre_set_cbs)
+            (*cb.cbvec)(this, cb.channel, attr, data);
 
     if (scope == CALI_ATTR_SCOPE_THREAD)
         handle_set(attr, data, prop, sT->thread_blackboard, sT->tree);
@@ -1334,6 +1504,8 @@ void Caliper::delete_channel(Channel& channel)
     if (it != sG->all_channels.end())
         sG->all_channels.erase(it);
 
+    sG->update_callback_tables();
+
     channel.mP->events.finish_evt(this, &channel);
 }
 
@@ -1346,6 +1518,8 @@ void Caliper::activate_channel(Channel& channel)
         sG->active_channels.emplace_back(channel);
 
     sG->max_active_channels = std::max(sG->max_active_channels, sG->active_channels.size());
+
+    sG->update_callback_tables();
 }
 
 void Caliper::deactivate_channel(Channel& channel)
@@ -1355,6 +1529,8 @@ void Caliper::deactivate_channel(Channel& channel)
         sG->active_channels.erase(it);
 
     channel.mP->is_active = false;
+
+    sG->update_callback_tables();
 }
 
 /// \brief Release current thread
@@ -1426,7 +1602,7 @@ Caliper Caliper::instance()
     }
 
     if (!tPtr) {
-        tPtr = gPtr->add_thread_data(new ThreadData(false /* is_initial_thread */));
+        tPtr = gPtr->acquire_thread_data();
         Caliper c(gPtr, tPtr, false);
 
         for (auto& channel : gPtr->all_channels)
@@ -896,6 +896,12 @@ struct ConfigManager::ConfigManagerImpl {
 
     std::map<std::string, std::shared_ptr<config_spec_t>> m_spec;
 
+    //   Built-in config specs are parsed only when they are used. Until then,
+    // they are kept here by name.
+    std::map<std::string, ConfigInfo> m_pending_specs;
+
+    std::size_t m_num_imported_specs = 0;
+
     void set_error(const std::string& msg)
     {
         m_error     = true;
@@ -954,7 +960,7 @@ struct ConfigManager::ConfigManagerImpl {
         spec.name = it->second.to_string();
 
         // check if the spec already exists
-        if (m_spec.count(spec.name) > 0) {
+        if (m_spec.count(spec.name) > 0 || m_pending_specs.count(spec.name) > 0) {
             if (!ignore_existing)
                 set_error(spec.name + std::string(" already exists"));
             return;
@@ -1017,12 +1023,53 @@ struct ConfigManager::ConfigManagerImpl {
             set_error(std::string("parse error: ") + util::clamp_string(json, 48));
     }
 
-    void import_builtin_config_specs()
+    //   Import the built-in config specs that have been added since the last
+    // call. Only the names are read; the specs are parsed on first use
+    // unless parse_all is set.
+    void import_builtin_config_specs(bool parse_all = false)
     {
         add_submodule_controllers_and_services();
 
-        for (const ConfigInfo& s : ::ConfigSpecManager::instance()->get_config_specs())
-            add_config_spec(s.spec, s.create, s.check_args, true /* ignore existing */);
+        auto specs = ::ConfigSpecManager::instance()->get_config_specs();
+
+        for (std::size_t i = m_num_imported_specs; i < specs.size(); ++i) {
+            std::string name;
+
+            if (util::find_json_toplevel_string(specs[i].spec, "name", name)) {
+                if (m_spec.count(name) == 0)
+                    m_pending_specs.emplace(name, specs[i]);
+            } else {
+                // let add_config_spec() report the error
+                add_config_spec(specs[i].spec, specs[i].create, specs[i].check_args, true /* ignore existing */);
+            }
+        }
+
+        m_num_imported_specs = specs.size();
+
+        if (parse_all)
+            parse_pending_specs();
+    }
+
+    std::shared_ptr<config_spec_t> find_spec(const std::string& name)
+    {
+        auto pending_it = m_pending_specs.find(name);
+
+        if (pending_it != m_pending_specs.end()) {
+            ConfigInfo info = pending_it->second;
+            m_pending_specs.erase(pending_it);
+            add_config_spec(info.spec, info.create, info.check_args, true /* ignore existing */);
+        }
+
+        auto it = m_spec.find(name);
+        return it != m_spec.end() ? it->second : nullptr;
+    }
+
+    void parse_pending_specs()
+    {
+        while (!m_pending_specs.empty()) {
+            std::string name = m_pending_specs.begin()->first;
+            find_spec(name);
+        }
     }
 
     //   Parse "=value" or "(value)"
@@ -1103,6 +1150,8 @@ struct ConfigManager::ConfigManagerImpl {
         if (m_global_opts.contains(key))
             return true;
 
+        parse_pending_specs();
+
         for (const auto& p : m_spec)
             if (p.second->opts.contains(key))
                 return true;
@@ -1241,17 +1290,17 @@ struct ConfigManager::ConfigManagerImpl {
                 if (m_error)
                     return ret;
             } else {
-                auto spec_p = m_spec.find(key);
-                if (spec_p != m_spec.end() && spec_p->second) {
-                    OptionSpec opts(spec_p->second->opts);
-                    opts.add(m_global_opts, spec_p->second->categories);
+                auto spec_p = find_spec(key);
+                if (spec_p) {
+                    OptionSpec opts(spec_p->opts);
+                    opts.add(m_global_opts, spec_p->categories);
 
                     auto args = parse_arglist(is, opts);
 
                     if (m_error)
                         return ret;
 
-                    ret.push_back(std::make_pair(spec_p->second, std::move(args)));
+                    ret.push_back(std::make_pair(spec_p, std::move(args)));
                 } else {
                     std::string val = read_value(is, key);
 
@@ -1561,7 +1610,7 @@ std::string ConfigManager::check(const char* configstr, bool allow_extra_kv_pair
 
 std::vector<std::string> ConfigManager::available_config_specs() const
 {
-    mP->import_builtin_config_specs();
+    mP->import_builtin_config_specs(true);
 
     std::vector<std::string> ret;
     for (const auto& p : mP->m_spec)
@@ -1572,13 +1621,13 @@ std::vector<std::string> ConfigManager::available_config_specs() const
 
 std::string ConfigManager::get_description_for_spec(const char* name) const
 {
-    mP->import_builtin_config_specs();
+    mP->import_builtin_config_specs(true);
     return mP->get_description_for_spec(name);
 }
 
 std::string ConfigManager::get_documentation_for_spec(const char* name) const
 {
-    mP->import_builtin_config_specs();
+    mP->import_builtin_config_specs(true);
     return mP->get_documentation_for_spec(name);
 }
 
@@ -1590,7 +1639,7 @@ std::vector<std::string> ConfigManager::available_configs()
 std::vector<std::string> ConfigManager::get_config_docstrings()
 {
     ConfigManagerImpl mgr;
-    mgr.import_builtin_config_specs();
+    mgr.import_builtin_config_specs(true);
     return mgr.get_docstrings();
 }
 
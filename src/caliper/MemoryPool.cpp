@@ -3,8 +3,10 @@
 
 #include "MemoryPool.h"
 
+#include "caliper/common/Log.h"
 #include "caliper/common/RuntimeConfig.h"
 
+#include "../common/util/page_alloc.h"
 #include "../common/util/spinlock.hpp"
 #include "../common/util/unitfmt.h"
 
@@ -19,14 +21,13 @@ using namespace std;
 struct MemoryPool::MemoryPoolImpl {
     // --- data
 
-    const size_t chunksize = 64 * 1024;
-
     static const ConfigSet::Entry s_configdata[];
 
     struct Chunk {
-        unsigned char* ptr;
-        size_t         wmark;
-        size_t         size;
+        unsigned char*  ptr;
+        size_t          wmark;
+        size_t          size;
+        util::PageBlock block;
     };
 
     ConfigSet m_config;
@@ -36,22 +37,32 @@ struct MemoryPool::MemoryPoolImpl {
     vector<Chunk> m_chunks;
     bool          m_can_expand;
 
+    size_t          m_chunksize;
+    util::HugePages m_hugepages;
+    bool            m_prefault;
+
     size_t m_total_reserved;
     size_t m_total_used;
+    size_t m_total_huge;
 
     // --- interface
 
     void expand(size_t bytes)
     {
-        size_t len = max(bytes, chunksize);
+        //   Chunks come straight from the OS and are zero-initialized. They
+        // are first touched by the thread that owns the pool, so they are
+        // placed on that thread's NUMA node.
+        util::PageBlock block = util::page_alloc(max(bytes, m_chunksize), m_hugepages, m_prefault);
 
-        unsigned char* ptr = new unsigned char[len];
+        if (!block.ptr)
+            return;
 
-        std::fill_n(ptr, len, 0);
+        m_chunks.push_back({ static_cast<unsigned char*>(block.ptr), 0, block.size, block });
 
-        m_chunks.push_back({ ptr, 0, len });
+        m_total_reserved += block.size;
 
-        m_total_reserved += len;
+        if (block.is_huge)
+            m_total_huge += block.size;
     }
 
     void* allocate(size_t bytes, size_t alignment, bool can_expand)
@@ -60,8 +71,8 @@ struct MemoryPool::MemoryPoolImpl {
 
         if (m_chunks.empty() || m_chunks.back().wmark + bytes + alignment > m_chunks.back().size) {
             if (can_expand)
-                expand(bytes);
-            else
+                expand(bytes + alignment);
+            if (m_chunks.empty() || m_chunks.back().wmark + bytes + alignment > m_chunks.back().size)
                 return nullptr;
         }
 
@@ -85,9 +96,11 @@ struct MemoryPool::MemoryPoolImpl {
 
         m_total_reserved += other.m_total_reserved;
         m_total_used += other.m_total_used;
+        m_total_huge += other.m_total_huge;
 
         other.m_total_reserved = 0;
         other.m_total_used     = 0;
+        other.m_total_huge     = 0;
     }
 
     std::ostream& print_statistics(std::ostream& os) const
@@ -96,7 +109,12 @@ struct MemoryPool::MemoryPoolImpl {
         unitfmt_result bytes_used     = unitfmt(m_total_used, unitfmt_bytes);
 
         os << "Metadata memory pool: " << bytes_reserved.val << " " << bytes_reserved.symbol << " reserved, "
-           << bytes_used.val << " " << bytes_used.symbol << " used";
+           << bytes_used.val << " " << bytes_used.symbol << " used, " << m_chunks.size() << " chunks";
+
+        if (m_hugepages != util::HugePages::None) {
+            unitfmt_result bytes_huge = unitfmt(m_total_huge, unitfmt_bytes);
+            os << ", " << bytes_huge.val << " " << bytes_huge.symbol << " in huge pages";
+        }
 
         return os;
     }
@@ -104,10 +122,21 @@ struct MemoryPool::MemoryPoolImpl {
     MemoryPoolImpl()
         : m_config { RuntimeConfig::get_default_config().init("memory", s_configdata) },
           m_total_reserved { 0 },
-          m_total_used { 0 }
+          m_total_used { 0 },
+          m_total_huge { 0 }
     {
         m_can_expand = m_config.get("can_expand").to_bool();
-        size_t s     = m_config.get("pool_size").to_uint();
+        m_chunksize  = max<size_t>(m_config.get("chunk_size").to_uint(), 4096);
+        m_prefault   = m_config.get("prefault").to_bool();
+
+        bool        ok  = true;
+        std::string str = m_config.get("hugepages").to_string();
+        m_hugepages     = util::parse_hugepages(str, &ok);
+
+        if (!ok)
+            Log(0).stream() << "MemoryPool: unknown huge page policy \"" << str << "\"" << std::endl;
+
+        size_t s = m_config.get("pool_size").to_uint();
 
         expand(s);
     }
@@ -115,7 +144,7 @@ struct MemoryPool::MemoryPoolImpl {
     ~MemoryPoolImpl()
     {
         for (auto& c : m_chunks)
-            delete[] c.ptr;
+            util::page_free(c.block);
 
         m_chunks.clear();
     }
@@ -135,6 +164,25 @@ const ConfigSet::Entry MemoryPool::MemoryPoolImpl::s_configdata[] = {
       "true",
       "Allow memory pool to expand at runtime",
       "Allow memory pool to expand at runtime" },
+    { "chunk_size",
+      CALI_TYPE_UINT,
+      "65536",
+      "Size of the chunks added when the memory pool expands (in bytes)",
+      "Size of the chunks added when the memory pool expands (in bytes)" },
+    { "hugepages",
+      CALI_TYPE_STRING,
+      "none",
+      "Huge page policy for the memory pool: none, thp, or explicit",
+      "Huge page policy for the memory pool:\n"
+      "  none:      Use regular pages\n"
+      "  thp:       Request transparent huge pages (useful with chunk sizes of 2 MiB or more)\n"
+      "  explicit:  Use pre-allocated huge pages, fall back to regular pages if none are available" },
+    { "prefault",
+      CALI_TYPE_BOOL,
+      "false",
+      "Touch memory pool pages when they are allocated",
+      "Touch memory pool pages on the allocating thread when they are allocated"
+      " instead of on first use" },
     ConfigSet::Terminator
 };
 
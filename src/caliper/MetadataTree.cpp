@@ -12,6 +12,7 @@
 
 #include "../common/util/spinlock.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <utility>
 
@@ -22,13 +23,21 @@ MetadataTree::GlobalData::GlobalData(MemoryPool& pool)
     : config(RuntimeConfig::get_default_config().init("contexttree", s_configdata)),
       root(CALI_INV_ID, CALI_INV_ID, Variant()),
       next_block(1),
-      node_blocks(0),
       g_mempool(pool)
 {
-    num_blocks      = config.get("num_blocks").to_uint();
     nodes_per_block = std::min<uint64_t>(config.get("nodes_per_block").to_uint(), 256);
 
-    node_blocks = new NodeBlock[num_blocks];
+    // round the block table size up to a power of 2
+    size_t num_blocks = std::max<uint64_t>(config.get("num_blocks").to_uint(), 1);
+
+    block_table_shift = 0;
+    while ((size_t(1) << block_table_shift) < num_blocks)
+        ++block_table_shift;
+
+    block_table_size = size_t(1) << block_table_shift;
+
+    for (size_t i = 0; i < s_max_block_tables; ++i)
+        block_tables[i].store(nullptr, std::memory_order_relaxed);
 
     Node* chunk = pool.aligned_alloc<Node>(nodes_per_block);
 
@@ -63,13 +72,40 @@ MetadataTree::GlobalData::GlobalData(MemoryPool& pool)
             type_nodes[info->data.to_attr_type()] = node;
     }
 
-    node_blocks[0].chunk = chunk;
-    node_blocks[0].index = 12;
+    NodeBlock* nb = get_node_block(0);
+
+    nb->chunk    = chunk;
+    nb->index    = 12;
+    nb->first_id = 0;
 }
 
 MetadataTree::GlobalData::~GlobalData()
 {
-    delete[] node_blocks;
+    for (size_t i = 0; i < s_max_block_tables; ++i)
+        delete[] block_tables[i].load();
+}
+
+MetadataTree::NodeBlock* MetadataTree::GlobalData::get_node_block(size_t n)
+{
+    size_t table = n >> block_table_shift;
+
+    if (table >= s_max_block_tables)
+        return nullptr;
+
+    NodeBlock* blocks = block_tables[table].load(std::memory_order_acquire);
+
+    if (!blocks) {
+        //   Allocate the block table. If another thread got there first,
+        // use theirs and discard ours.
+        NodeBlock* new_blocks = new NodeBlock[block_table_size]();
+
+        if (block_tables[table].compare_exchange_strong(blocks, new_blocks, std::memory_order_acq_rel))
+            blocks = new_blocks;
+        else
+            delete[] new_blocks;
+    }
+
+    return blocks + (n & (block_table_size - 1));
 }
 
 MetadataTree::MetadataTree() : m_nodeblock(nullptr), m_num_nodes(0), m_num_blocks(0)
@@ -82,7 +118,7 @@ MetadataTree::MetadataTree() : m_nodeblock(nullptr), m_num_nodes(0), m_num_block
         // Set mG. If mG != new_g, some other thread has set it,
         // so just delete our new object.
         if (mG.compare_exchange_strong(g, new_g)) {
-            m_nodeblock = new_g->node_blocks;
+            m_nodeblock = new_g->get_node_block(0);
 
             ++m_num_blocks;
             m_num_nodes = m_nodeblock->index;
@@ -102,7 +138,7 @@ bool MetadataTree::have_free_nodeblock(size_t n)
     GlobalData* g = mG.load();
 
     if (!m_nodeblock || m_nodeblock->index + n >= g->nodes_per_block) {
-        if (g->next_block.load() >= g->num_blocks)
+        if (g->next_block.load() >= GlobalData::s_max_block_tables * g->block_table_size)
             return false;
 
         // allocate new node block
@@ -112,15 +148,17 @@ bool MetadataTree::have_free_nodeblock(size_t n)
         if (!chunk)
             return false;
 
-        size_t block_index = g->next_block++;
+        size_t     block_index = g->next_block++;
+        NodeBlock* nb          = g->get_node_block(block_index);
 
-        if (block_index >= g->num_blocks)
+        if (!nb)
             return false;
 
-        m_nodeblock = g->node_blocks + block_index;
+        m_nodeblock = nb;
 
-        m_nodeblock->chunk = chunk;
-        m_nodeblock->index = 0;
+        m_nodeblock->chunk    = chunk;
+        m_nodeblock->first_id = block_index * g->nodes_per_block;
+        m_nodeblock->index    = 0;
 
         ++m_num_blocks;
     }
@@ -164,8 +202,6 @@ Node* MetadataTree::create_path(const Attribute& attr, size_t n, const Variant*
 
     // Create nodes
 
-    GlobalData* g = mG.load();
-
     for (size_t i = 0; i < n; ++i) {
         const void* dptr { data[i].data() };
         size_t      size { data[i].size() };
@@ -178,7 +214,7 @@ Node* MetadataTree::create_path(const Attribute& attr, size_t n, const Variant*
         size_t index = m_nodeblock->index++;
 
         node = new (m_nodeblock->chunk + index)
-            Node((m_nodeblock - g->node_blocks) * g->nodes_per_block + index, attr.id(), Variant(type, dptr, size));
+            Node(m_nodeblock->first_id + index, attr.id(), Variant(type, dptr, size));
 
         if (parent)
             parent->append(node);
@@ -203,11 +239,10 @@ Node* MetadataTree::create_child(const Attribute& attr, const Variant& value, No
     if (value.has_unmanaged_data())
         ptr = m_mempool.allocate(value.size() + 1 /* ensure 0-padding so we can safely hand out string ptrs */);
 
-    size_t      index = m_nodeblock->index++;
-    GlobalData* g     = mG.load();
+    size_t index = m_nodeblock->index++;
 
     Node* node = new (m_nodeblock->chunk + index)
-        Node((m_nodeblock - g->node_blocks) * g->nodes_per_block + index, attr.id(), value.copy(ptr));
+        Node(m_nodeblock->first_id + index, attr.id(), value.copy(ptr));
 
     if (parent)
         parent->append(node);
@@ -253,8 +288,6 @@ Node* MetadataTree::get_path(size_t n, const Node* nodelist[], Node* parent = nu
 
 Node* MetadataTree::get_or_copy_node(const Node* from, Node* parent)
 {
-    GlobalData* g = mG.load();
-
     if (!parent)
         parent = root();
 
@@ -271,7 +304,7 @@ Node* MetadataTree::get_or_copy_node(const Node* from, Node* parent)
         size_t index = m_nodeblock->index++;
 
         node = new (m_nodeblock->chunk + index)
-            Node((m_nodeblock - g->node_blocks) * g->nodes_per_block + index, from->attribute(), from->data());
+            Node(m_nodeblock->first_id + index, from->attribute(), from->data());
 
         parent->append(node);
 
@@ -377,7 +410,9 @@ const ConfigSet::Entry MetadataTree::GlobalData::s_configdata[] = {
     { "num_blocks",
       CALI_TYPE_UINT,
       "16384",
-      "Maximum number of context tree node blocks",
-      "Maximum number of context tree node blocks" },
+      "Number of context tree node blocks in a block table",
+      "Number of context tree node blocks in a block table."
+      " New block tables are added when the existing ones are full,"
+      " up to 1024 tables." },
     ConfigSet::Terminator
 };
@@ -23,20 +23,28 @@ namespace internal
 class MetadataTree
 {
     struct NodeBlock {
-        Node*  chunk;
-        size_t index;
+        Node*     chunk;
+        size_t    index;
+        cali_id_t first_id;
     };
 
     struct GlobalData {
         static const ConfigSet::Entry s_configdata[];
 
+        //   Node blocks are kept in a two-level table: a fixed-size array of
+        // pointers to block tables of block_table_size blocks each. Block
+        // tables are allocated on demand, so the number of node blocks can
+        // grow without locking or moving existing blocks.
+        static constexpr size_t s_max_block_tables = 1024;
+
         ConfigSet config;
 
         Node                  root;
-        std::atomic<unsigned> next_block;
-        NodeBlock*            node_blocks;
+        std::atomic<size_t>   next_block;
+        std::atomic<NodeBlock*> block_tables[s_max_block_tables];
 
-        size_t num_blocks;
+        size_t block_table_size; // power of 2
+        size_t block_table_shift;
         size_t nodes_per_block;
 
         Node* type_nodes[CALI_MAXTYPE + 1];
@@ -45,6 +53,11 @@ class MetadataTree
         // Used to merge in the pools of deleted threads.
         MemoryPool g_mempool;
 
+        /// \brief Return node block \a n, allocating its block table if
+        ///   necessary. Returns \c nullptr if \a n exceeds the maximum
+        ///   number of blocks.
+        NodeBlock* get_node_block(size_t n);
+
         explicit GlobalData(MemoryPool&);
         ~GlobalData();
     };
@@ -101,11 +114,22 @@ public:
 
         size_t block = id / g->nodes_per_block;
         size_t index = id % g->nodes_per_block;
+        size_t table = block >> g->block_table_shift;
+
+        if (table >= GlobalData::s_max_block_tables)
+            return nullptr;
+
+        NodeBlock* blocks = g->block_tables[table].load(std::memory_order_acquire);
+
+        if (!blocks)
+            return nullptr;
+
+        NodeBlock& nb = blocks[block & (g->block_table_size - 1)];
 
-        if (block >= g->num_blocks || index >= g->node_blocks[block].index)
+        if (index >= nb.index)
             return nullptr;
 
-        return g->node_blocks[block].chunk + index;
+        return nb.chunk + index;
     }
 
     Node* root() const { return &(mG.load()->root); }
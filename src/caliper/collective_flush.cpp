@@ -11,6 +11,7 @@
 #include "caliper/reader/FormatProcessor.h"
 #include "caliper/reader/Preprocessor.h"
 #include "caliper/reader/QuerySpec.h"
+#include "caliper/reader/RecordLimiter.h"
 #include "caliper/reader/RecordProcessor.h"
 #include "caliper/reader/RecordSelector.h"
 
@@ -97,8 +98,15 @@ void collective_flush(
             spec.format = CalQLParser("format table").spec().format;
 
         FormatProcessor formatter(spec, stream);
+        RecordLimiter   limiter(spec);
+
+        if (limiter.is_active()) {
+            cross_agg.flush(db, limiter);
+            limiter.flush(db, formatter);
+        } else {
+            cross_agg.flush(db, formatter);
+        }
 
-        cross_agg.flush(db, formatter);
         formatter.flush(db);
     }
 }
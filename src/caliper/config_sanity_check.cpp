@@ -17,7 +17,7 @@ namespace
 const char* trigger_grp[] = { "alloc",        "cuptitrace",     "event",   "libpfm",
                               "loop_monitor", "region_monitor", "sampler", nullptr };
 const char* buffer_grp[]  = { "aggregate", "trace", "cuptitrace", nullptr };
-const char* process_grp[] = { "aggregate", "trace", "textlog", nullptr };
+const char* process_grp[] = { "aggregate", "trace", "textlog", "shmring", nullptr };
 const char* online_grp[]  = { "textlog", nullptr };
 const char* offline_grp[] = { "recorder", "report", "sos", "mpireport", nullptr };
 
@@ -375,6 +375,17 @@ const char* builtin_base_option_specs = R"json(
  "description" : "Output location ('stdout', 'stderr', or filename)",
  "type"        : "string",
  "category"    : "output"
+},{
+ "name"        : "output.compression",
+ "description" : "Compress output ('gzip', 'zstd', or 'none'). Default: based on file name suffix.",
+ "type"        : "string",
+ "category"    : "output",
+ "config"      :
+ {
+  "CALI_RECORDER_COMPRESSION"  : "{}",
+  "CALI_REPORT_COMPRESSION"    : "{}",
+  "CALI_MPIREPORT_COMPRESSION" : "{}"
+ }
 },{
  "name"        : "adiak.import_categories",
  "services"    : [ "adiak_import" ],
@@ -498,6 +509,14 @@ const char* builtin_mpi_option_specs = R"json(
   }
  ]
 },
+{
+ "name"        : "mpi.aggregate_messages",
+ "description" : "Accumulate MPI point-to-point messages in per-thread counters instead of one snapshot per message",
+ "type"        : "bool",
+ "category"    : "metric",
+ "services"    : [ "mpi" ],
+ "config"      : { "CALI_MPI_MSG_AGGREGATION": "true" }
+},
 {
  "name"        : "comm.stats",
  "description" : "MPI message statistics in marked communication regions",
@@ -845,7 +864,7 @@ const char* builtin_openmp_option_specs = R"json(
   { "level"   : "local",
     "let"     :
     [
-     "t.omp.ns=first(sum#time.duration.ns,time.duration.ns)",
+     "t.omp.ns=first(sum#time.duration.ns,time.duration.ns,omp.sync.duration.ns)",
      "t.omp.work=scale(t.omp.ns,1e-9) if omp.work",
      "t.omp.sync=scale(t.omp.ns,1e-9) if omp.sync",
      "t.omp.total=first(t.omp.work,t.omp.sync)"
@@ -864,6 +883,14 @@ const char* builtin_openmp_option_specs = R"json(
    }
  ]
 },
+{
+ "name"        : "openmp.aggregate_sync",
+ "description" : "Accumulate OpenMP barrier times in per-thread counters instead of regions",
+ "type"        : "bool",
+ "category"    : "metric",
+ "inherit"     : [ "openmp.times" ],
+ "config"      : { "CALI_OMPT_AGGREGATE_SYNC": "true" }
+},
 {
  "name"        : "openmp.efficiency",
  "description" : "Compute OpenMP efficiency metrics",
@@ -92,6 +92,40 @@ TEST(BlackboardTest, Exchange)
     EXPECT_EQ(bb.num_skipped_entries(), 0);
 }
 
+TEST(BlackboardTest, Clear)
+{
+    Caliper c;
+
+    Attribute attr_ref = c.create_attribute("bb.cl.ref", CALI_TYPE_INT, CALI_ATTR_DEFAULT);
+    Attribute attr_imm = c.create_attribute("bb.cl.imm", CALI_TYPE_INT, CALI_ATTR_ASVALUE);
+    Attribute attr_hidden = c.create_attribute("bb.cl.h", CALI_TYPE_INT, CALI_ATTR_ASVALUE | CALI_ATTR_HIDDEN);
+
+    Node* node = c.make_tree_entry(attr_ref, Variant(42));
+
+    Blackboard bb;
+
+    bb.set(attr_ref.id(), Entry(node), true);
+    bb.set(attr_imm.id(), Entry(attr_imm, Variant(1122)), true);
+    bb.set(attr_hidden.id(), Entry(attr_hidden, Variant(2211)), false);
+
+    int count = bb.count();
+
+    bb.clear();
+
+    EXPECT_GT(bb.count(), count);
+    EXPECT_TRUE(bb.get(attr_ref.id()).empty());
+    EXPECT_TRUE(bb.get(attr_imm.id()).empty());
+    EXPECT_TRUE(bb.get(attr_hidden.id()).empty());
+
+    FixedSizeSnapshotRecord<8> rec;
+    bb.snapshot(rec.builder());
+
+    EXPECT_EQ(rec.view().size(), 0);
+
+    bb.set(attr_imm.id(), Entry(attr_imm, Variant(2211)), true);
+    EXPECT_EQ(bb.get(attr_imm.id()).value().to_int(), 2211);
+}
+
 TEST(BlackboardTest, Overflow)
 {
     Caliper    c;
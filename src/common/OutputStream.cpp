@@ -7,6 +7,8 @@
 
 #include "caliper/common/Log.h"
 
+#include "util/compress_stream.h"
+
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -93,6 +95,9 @@ struct OutputStream::OutputStreamImpl {
     StreamType type;
     Mode       mode;
 
+    bool              compression_set;
+    util::Compression compression;
+
     bool       is_initialized;
     std::mutex init_mutex;
 
@@ -105,6 +110,62 @@ struct OutputStream::OutputStreamImpl {
 
     std::ostream* user_os;
 
+    std::unique_ptr<std::streambuf> zbuf;
+    std::unique_ptr<std::ostream>   zos;
+
+    std::string filename_str() const
+    {
+#ifdef CALIPER_OSTREAM_USE_STD_FILESYSTEM
+        return filename.string();
+#else
+        return filename;
+#endif
+    }
+
+    std::streambuf* target_rdbuf()
+    {
+        switch (type) {
+        case StdOut:
+            return std::cout.rdbuf();
+        case StdErr:
+            return std::cerr.rdbuf();
+        case File:
+            return fs.rdbuf();
+        case User:
+            return user_os ? user_os->rdbuf() : nullptr;
+        default:
+            return nullptr;
+        }
+    }
+
+    // Compressed output is selected explicitly with set_compression(), or
+    // by a ".gz"/".zst" file name suffix
+    util::Compression get_compression() const
+    {
+        if (compression_set)
+            return compression;
+        if (type == StreamType::File)
+            return util::compression_from_filename(filename_str());
+
+        return util::Compression::None;
+    }
+
+    void init_compression(util::Compression c)
+    {
+        std::streambuf* sink = target_rdbuf();
+
+        if (!sink)
+            return;
+
+        zbuf = util::make_compress_streambuf(sink, c);
+
+        if (zbuf)
+            zos.reset(new std::ostream(zbuf.get()));
+        else
+            Log(0).stream() << "OutputStream: could not initialize " << util::compression_name(c) << " compression"
+                            << std::endl;
+    }
+
     void init()
     {
         if (is_initialized)
@@ -114,9 +175,22 @@ struct OutputStream::OutputStreamImpl {
 
         is_initialized = true;
 
+        util::Compression c = get_compression();
+
+        if (!util::compression_supported(c)) {
+            Log(0).stream() << "OutputStream: " << util::compression_name(c)
+                            << " compression is not available, writing uncompressed output" << std::endl;
+            c = util::Compression::None;
+        }
+
         if (type == StreamType::File) {
+            std::ios::openmode openmode = (mode == Mode::Append ? std::ios::app : std::ios::trunc);
+
+            if (c != util::Compression::None)
+                openmode |= std::ios::binary;
+
             check_and_create_directory(filename);
-            fs.open(filename, mode == Mode::Append ? std::ios::app : std::ios::trunc);
+            fs.open(filename, openmode);
 
             if (!fs.is_open()) {
                 type = StreamType::None;
@@ -124,12 +198,18 @@ struct OutputStream::OutputStreamImpl {
                 Log(0).stream() << "Could not open output stream " << filename << std::endl;
             }
         }
+
+        if (c != util::Compression::None && type != StreamType::None)
+            init_compression(c);
     }
 
     std::ostream* stream()
     {
         init();
 
+        if (zos)
+            return zos.get();
+
         switch (type) {
         case None:
             return &fs;
@@ -146,20 +226,43 @@ struct OutputStream::OutputStreamImpl {
         return &fs;
     }
 
-    void reset()
+    void close()
     {
+        // destroying the compressor writes the end of the compressed stream
+        zos.reset();
+        zbuf.reset();
         fs.close();
+    }
+
+    void reset()
+    {
+        close();
         filename.clear();
         user_os        = nullptr;
         type           = StreamType::None;
         is_initialized = false;
     }
 
-    OutputStreamImpl() : type(StreamType::None), mode(Truncate), is_initialized(false), user_os(nullptr) {}
+    OutputStreamImpl()
+        : type(StreamType::None),
+          mode(Truncate),
+          compression_set(false),
+          compression(util::Compression::None),
+          is_initialized(false),
+          user_os(nullptr)
+    {}
 
     OutputStreamImpl(const char* name)
-        : type(StreamType::None), mode(Truncate), is_initialized(false), filename(name), user_os(nullptr)
+        : type(StreamType::None),
+          mode(Truncate),
+          compression_set(false),
+          compression(util::Compression::None),
+          is_initialized(false),
+          filename(name),
+          user_os(nullptr)
     {}
+
+    ~OutputStreamImpl() { close(); }
 };
 
 OutputStream::OutputStream() : mP(new OutputStreamImpl)
@@ -190,6 +293,27 @@ void OutputStream::set_mode(OutputStream::Mode mode)
     mP->mode = mode;
 }
 
+bool OutputStream::set_compression(const char* format)
+{
+    if (!format || !*format || strcmp(format, "auto") == 0) {
+        mP->compression_set = false;
+        return true;
+    }
+
+    bool ok = false;
+    auto c  = util::parse_compression(format, &ok);
+
+    if (!ok) {
+        Log(0).stream() << "OutputStream: unknown compression format \"" << format << "\"" << std::endl;
+        return false;
+    }
+
+    mP->compression_set = true;
+    mP->compression     = c;
+
+    return true;
+}
+
 void OutputStream::set_stream(StreamType type)
 {
     mP->reset();
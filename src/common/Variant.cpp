@@ -13,14 +13,30 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
 #include <iterator>
 #include <sstream>
 
+#include <locale.h>
+
 using namespace cali;
 
+namespace
+{
+
+/// \brief Return a "C" locale for locale-independent number formatting,
+///   or 0 if it can't be created
+locale_t c_numeric_locale()
+{
+    static locale_t s_loc = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+    return s_loc;
+}
+
+} // namespace
+
 cali_id_t Variant::to_id(bool* okptr) const
 {
     bool      ok = false;
@@ -176,6 +192,59 @@ std::ostream& Variant::write_cali(std::ostream& os)
     return os;
 }
 
+void Variant::append_cali(std::string& buf) const
+{
+    switch (this->type()) {
+    case CALI_TYPE_INV:
+        break;
+    case CALI_TYPE_INT:
+        {
+            int64_t  i = m_v.value.v_int;
+            uint64_t u = static_cast<uint64_t>(i);
+
+            if (i < 0) {
+                buf.push_back('-');
+                u = ~u + 1;
+            }
+
+            util::append_uint64(buf, u);
+        }
+        break;
+    case CALI_TYPE_DOUBLE:
+        {
+            //   Same as the default std::ostream floating-point format.
+            // snprintf() uses the LC_NUMERIC decimal point, so switch this
+            // thread to the "C" locale while formatting.
+            locale_t loc = c_numeric_locale();
+            locale_t old = loc ? uselocale(loc) : static_cast<locale_t>(0);
+
+            char tmp[32];
+            int  len = snprintf(tmp, sizeof(tmp), "%g", m_v.value.v_double);
+
+            if (loc)
+                uselocale(old);
+
+            if (len > 0)
+                buf.append(tmp, std::min<std::size_t>(len, sizeof(tmp) - 1));
+        }
+        break;
+    case CALI_TYPE_UINT:
+        util::append_uint64(buf, m_v.value.v_uint);
+        break;
+    case CALI_TYPE_STRING:
+        util::append_cali_esc_string(buf, static_cast<const char*>(m_v.value.unmanaged_const_ptr), size());
+        break;
+    case CALI_TYPE_TYPE:
+        buf.append(cali_type2string(m_v.value.v_type));
+        break;
+    default:
+        {
+            std::string str = to_string();
+            util::append_cali_esc_string(buf, str.data(), str.size());
+        }
+    }
+}
+
 std::ostream& cali::operator<< (std::ostream& os, const Variant& v)
 {
     os << v.to_string();
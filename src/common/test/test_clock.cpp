@@ -0,0 +1,45 @@
+#include "../util/clock.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace cali;
+
+TEST(ClockTest, Monotonic)
+{
+    const util::Clock& clock = util::Clock::get();
+
+    uint64_t prev = clock.now();
+
+    for (int i = 0; i < 1000; ++i) {
+        uint64_t now = clock.now();
+        EXPECT_GE(now, prev);
+        prev = now;
+    }
+}
+
+TEST(ClockTest, Conversion)
+{
+    for (bool try_tsc : { true, false }) {
+        const util::Clock& clock = util::Clock::get(try_tsc);
+
+        if (!try_tsc) {
+            EXPECT_FALSE(clock.is_tsc());
+        }
+
+        auto     ref_begin = std::chrono::steady_clock::now();
+        uint64_t begin     = clock.now();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        uint64_t end     = clock.now();
+        auto     ref_end = std::chrono::steady_clock::now();
+
+        double ref_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(ref_end - ref_begin).count());
+        double ns     = static_cast<double>(clock.to_nsec(end - begin));
+
+        EXPECT_NEAR(ns, ref_ns, 0.02 * ref_ns) << "tsc: " << clock.is_tsc();
+    }
+}
@@ -0,0 +1,146 @@
+// Tests for the streaming (de)compression helpers
+
+#include "../util/compress_stream.h"
+
+#include "caliper/common/OutputStream.h"
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+std::string make_input(int lines)
+{
+    std::ostringstream os;
+
+    for (int i = 0; i < lines; ++i)
+        os << "__rec=ctx,ref=" << (i % 17) << ",attr=8,data=" << i << '\n';
+
+    return os.str();
+}
+
+std::string decompress(const std::string& in, util::Compression* format = nullptr, bool* error = nullptr)
+{
+    std::istringstream       is(in);
+    util::DecompressStreamBuf zbuf(is.rdbuf());
+    std::istream             zis(&zbuf);
+    std::ostringstream       os;
+
+    os << zis.rdbuf();
+
+    if (format)
+        *format = zbuf.format();
+    if (error)
+        *error = zbuf.error();
+
+    return os.str();
+}
+
+} // namespace
+
+TEST(CompressStreamTest, ParseCompression)
+{
+    bool ok = false;
+
+    EXPECT_EQ(util::parse_compression("none", &ok), util::Compression::None);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(util::parse_compression("gzip", &ok), util::Compression::Gzip);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(util::parse_compression("zstd", &ok), util::Compression::Zstd);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(util::parse_compression("lz77", &ok), util::Compression::None);
+    EXPECT_FALSE(ok);
+
+    EXPECT_EQ(util::compression_from_filename("out.cali.gz"), util::Compression::Gzip);
+    EXPECT_EQ(util::compression_from_filename("out.cali.zst"), util::Compression::Zstd);
+    EXPECT_EQ(util::compression_from_filename("out.cali"), util::Compression::None);
+    EXPECT_EQ(util::compression_from_filename(".gz"), util::Compression::None);
+}
+
+TEST(CompressStreamTest, Passthrough)
+{
+    std::string input = make_input(10000);
+
+    util::Compression format = util::Compression::Gzip;
+    bool              error  = true;
+
+    EXPECT_EQ(decompress(input, &format, &error), input);
+    EXPECT_EQ(format, util::Compression::None);
+    EXPECT_FALSE(error);
+
+    EXPECT_EQ(decompress(std::string("a\n")), std::string("a\n"));
+    EXPECT_EQ(decompress(std::string()), std::string());
+}
+
+TEST(CompressStreamTest, RoundTrip)
+{
+    const util::Compression formats[] = { util::Compression::Gzip, util::Compression::Zstd };
+
+    std::string input = make_input(20000);
+
+    for (util::Compression c : formats) {
+        if (!util::compression_supported(c)) {
+            EXPECT_EQ(util::make_compress_streambuf(std::cout.rdbuf(), c), nullptr);
+            continue;
+        }
+
+        std::ostringstream os;
+
+        {
+            auto zbuf = util::make_compress_streambuf(os.rdbuf(), c);
+            ASSERT_NE(zbuf, nullptr);
+            std::ostream zos(zbuf.get());
+
+            // line-wise flushes must not break the stream
+            std::istringstream is(input);
+            for (std::string line; std::getline(is, line);)
+                zos << line << std::endl;
+        }
+
+        std::string compressed = os.str();
+
+        EXPECT_LT(compressed.size(), input.size() / 4) << util::compression_name(c);
+
+        util::Compression format = util::Compression::None;
+        bool              error  = true;
+
+        EXPECT_EQ(decompress(compressed, &format, &error), input);
+        EXPECT_EQ(format, c);
+        EXPECT_FALSE(error);
+
+        // concatenated streams (appended output) decode in sequence
+        EXPECT_EQ(decompress(compressed + compressed), input + input);
+
+        // truncated input is an error
+        decompress(compressed.substr(0, compressed.size() / 2), nullptr, &error);
+        EXPECT_TRUE(error);
+    }
+}
+
+TEST(CompressStreamTest, OutputStreamCompression)
+{
+    if (!util::compression_supported(util::Compression::Gzip))
+        return;
+
+    std::ostringstream os;
+
+    {
+        cali::OutputStream stream;
+        stream.set_stream(&os);
+
+        EXPECT_FALSE(stream.set_compression("lz77"));
+        EXPECT_TRUE(stream.set_compression("gzip"));
+
+        *stream.stream() << "hello\n";
+    }
+
+    std::string out = os.str();
+
+    ASSERT_GE(out.size(), 2u);
+    EXPECT_EQ(static_cast<unsigned char>(out[0]), 0x1f);
+    EXPECT_EQ(static_cast<unsigned char>(out[1]), 0x8b);
+    EXPECT_EQ(decompress(out), std::string("hello\n"));
+}
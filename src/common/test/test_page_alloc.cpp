@@ -0,0 +1,43 @@
+// Tests for the page allocation helpers
+
+#include "../util/page_alloc.h"
+
+#include "gtest/gtest.h"
+
+TEST(PageAllocTest, ParseHugePages)
+{
+    bool ok = false;
+
+    EXPECT_EQ(util::parse_hugepages("none", &ok), util::HugePages::None);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(util::parse_hugepages("thp", &ok), util::HugePages::Transparent);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(util::parse_hugepages("explicit", &ok), util::HugePages::Explicit);
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(util::parse_hugepages("bogus", &ok), util::HugePages::None);
+    EXPECT_FALSE(ok);
+}
+
+TEST(PageAllocTest, AllocFree)
+{
+    const util::HugePages policies[] = { util::HugePages::None,
+                                         util::HugePages::Transparent,
+                                         util::HugePages::Explicit };
+
+    for (util::HugePages hp : policies) {
+        util::PageBlock block = util::page_alloc(10000, hp, hp == util::HugePages::None);
+
+        ASSERT_NE(block.ptr, nullptr);
+        EXPECT_GE(block.size, 10000);
+
+        unsigned char* p = static_cast<unsigned char*>(block.ptr);
+
+        EXPECT_EQ(p[0], 0);
+        EXPECT_EQ(p[9999], 0);
+
+        p[9999] = 42;
+        EXPECT_EQ(p[9999], 42);
+
+        util::page_free(block);
+    }
+}
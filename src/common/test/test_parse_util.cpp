@@ -0,0 +1,28 @@
+// Tests for the parse_util helper functions
+
+#include "../util/parse_util.h"
+
+#include "gtest/gtest.h"
+
+TEST(ParseUtilTest, FindJsonToplevelString)
+{
+    const char* spec = R"json(
+    {
+        "config" : [ { "name": "nested", "value": "x" } ],
+        "description" : "A \"quoted\" description, with {braces}",
+        "name" : "top"
+    }
+    )json";
+
+    std::string val;
+
+    EXPECT_TRUE(util::find_json_toplevel_string(spec, "name", val));
+    EXPECT_EQ(val, std::string("top"));
+    EXPECT_TRUE(util::find_json_toplevel_string(spec, "description", val));
+    EXPECT_EQ(val, std::string("A \"quoted\" description, with {braces}"));
+
+    EXPECT_FALSE(util::find_json_toplevel_string(spec, "value", val));
+    EXPECT_FALSE(util::find_json_toplevel_string(spec, "config", val));
+    EXPECT_FALSE(util::find_json_toplevel_string("not json", "name", val));
+    EXPECT_FALSE(util::find_json_toplevel_string("{ \"name\": \"unterminated }", "name", val));
+}
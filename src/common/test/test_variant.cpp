@@ -2,7 +2,11 @@
 
 #include "gtest/gtest.h"
 
+#include <clocale>
+#include <cstdint>
 #include <cstring>
+#include <sstream>
+#include <string>
 
 using namespace cali;
 
@@ -310,4 +314,59 @@ TEST(Variant_Test, PlusEq)
     v_e += v_i;
     EXPECT_EQ(v_e.type(), CALI_TYPE_DOUBLE);
     EXPECT_EQ(v_e.to_double(), 84.42);
-}
\ No newline at end of file
+}
+
+TEST(Variant_Test, AppendCali)
+{
+    const char* str = "a,b=c\\d\ne";
+
+    cali::Variant vals[] = { cali::Variant(),
+                             cali::Variant(cali_make_variant_from_int64(-1234567890123ll)),
+                             cali::Variant(cali_make_variant_from_int64(INT64_MIN)),
+                             cali::Variant(cali_make_variant_from_int64(0)),
+                             cali::Variant(cali_make_variant_from_uint(UINT64_MAX)),
+                             cali::Variant(cali_make_variant_from_double(0.1)),
+                             cali::Variant(cali_make_variant_from_double(-1.5e-300)),
+                             cali::Variant(cali_make_variant_from_double(123456789.0)),
+                             cali::Variant(CALI_TYPE_STRING, str, strlen(str)),
+                             cali::Variant(CALI_TYPE_DOUBLE),
+                             cali::Variant(true) };
+
+    for (cali::Variant& v : vals) {
+        std::ostringstream os;
+        v.write_cali(os);
+
+        std::string buf("x");
+        v.append_cali(buf);
+
+        EXPECT_EQ(buf, std::string("x") + os.str()) << v.to_string();
+    }
+}
+
+TEST(Variant_Test, AppendCaliLocale)
+{
+    std::string prev = std::setlocale(LC_NUMERIC, nullptr);
+
+    const char* locales[] = { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR" };
+
+    const char* loc = nullptr;
+
+    for (const char* name : locales)
+        if (std::setlocale(LC_NUMERIC, name)) {
+            loc = name;
+            break;
+        }
+
+    if (!loc)
+        GTEST_SKIP() << "No comma-decimal locale available";
+
+    std::string d, n;
+
+    cali::Variant(cali_make_variant_from_double(0.1)).append_cali(d);
+    cali::Variant(cali_make_variant_from_double(-2.5e-7)).append_cali(n);
+
+    std::setlocale(LC_NUMERIC, prev.c_str());
+
+    EXPECT_EQ(d, "0.1") << loc;
+    EXPECT_EQ(n, "-2.5e-07") << loc;
+}
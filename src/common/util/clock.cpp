@@ -0,0 +1,114 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+#include "clock.h"
+
+#ifdef UTIL_CLOCK_HAVE_TSC
+#include <cpuid.h>
+#endif
+
+using namespace cali::util;
+
+namespace
+{
+
+#ifdef UTIL_CLOCK_HAVE_TSC
+
+bool have_invariant_tsc()
+{
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+        return false;
+
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+
+    return (edx & (1u << 8)) != 0;
+}
+
+uint64_t gettime_nsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+/// \brief Measure the TSC frequency in Hz against clock_gettime()
+///   over a 5ms interval
+uint64_t calibrate_tsc_frequency()
+{
+    const uint64_t interval = 5000000;
+
+    uint64_t ns_begin  = gettime_nsec();
+    uint64_t tsc_begin = __rdtsc();
+    uint64_t ns_end    = ns_begin;
+
+    while (ns_end - ns_begin < interval)
+        ns_end = gettime_nsec();
+
+    uint64_t tsc_end = __rdtsc();
+
+    return static_cast<uint64_t>(
+        static_cast<double>(tsc_end - tsc_begin) * 1e9 / static_cast<double>(ns_end - ns_begin)
+    );
+}
+
+/// \brief Determine the TSC frequency in Hz
+uint64_t tsc_frequency()
+{
+    uint64_t calibrated = calibrate_tsc_frequency();
+
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+    //   CPUID leaf 0x15 provides the TSC/crystal clock ratio and (on newer
+    // CPUs) the crystal clock frequency. Some CPUs and hypervisors report
+    // a nominal crystal frequency that is off from the actual TSC rate,
+    // so we only use the CPUID value if it is within 1% of the calibrated
+    // frequency.
+    if (__get_cpuid_max(0, nullptr) >= 0x15) {
+        __get_cpuid(0x15, &eax, &ebx, &ecx, &edx);
+
+        if (eax > 0 && ebx > 0 && ecx > 0) {
+            uint64_t freq = static_cast<uint64_t>(ecx) * ebx / eax;
+            uint64_t diff = freq > calibrated ? freq - calibrated : calibrated - freq;
+
+            if (diff < calibrated / 100)
+                return freq;
+        }
+    }
+
+    return calibrated;
+}
+
+#endif
+
+} // namespace
+
+Clock::Clock(bool try_tsc) : m_use_tsc(false), m_mult(1), m_shift(0)
+{
+#ifdef UTIL_CLOCK_HAVE_TSC
+    if (try_tsc && have_invariant_tsc()) {
+        uint64_t freq = tsc_frequency();
+
+        if (freq > 0) {
+            m_use_tsc = true;
+            m_shift   = 32;
+            m_mult    = static_cast<uint64_t>((static_cast<unsigned __int128>(1000000000ull) << m_shift) / freq);
+        }
+    }
+#else
+    (void) try_tsc;
+#endif
+}
+
+const Clock& Clock::get(bool try_tsc)
+{
+    if (try_tsc) {
+        static const Clock s_tsc_clock(true);
+        return s_tsc_clock;
+    }
+
+    static const Clock s_gettime_clock(false);
+    return s_gettime_clock;
+}
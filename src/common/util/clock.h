@@ -0,0 +1,82 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+/// \file clock.h
+/// Low-overhead monotonic clock
+
+#pragma once
+
+#ifndef UTIL_CLOCK_H
+#define UTIL_CLOCK_H
+
+#include <cstdint>
+#include <ctime>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define UTIL_CLOCK_HAVE_TSC
+#include <x86intrin.h>
+#endif
+
+namespace cali
+{
+
+namespace util
+{
+
+/// \brief A low-overhead monotonic clock
+///
+/// Reads the CPU timestamp counter (TSC) on x86 CPUs with an invariant
+/// TSC, and uses clock_gettime(CLOCK_MONOTONIC) otherwise. Clock readings
+/// (\a now()) are in clock-specific ticks. Convert tick values or tick
+/// differences into nanoseconds with \a to_nsec(), which is a
+/// fixed-point multiplication. The TSC frequency is calibrated against
+/// clock_gettime() at startup; the CPUID frequency is used instead if
+/// it is available and agrees with the calibrated value.
+class Clock
+{
+    bool     m_use_tsc;
+    uint64_t m_mult;
+    unsigned m_shift;
+
+    explicit Clock(bool try_tsc);
+
+public:
+
+    /// \brief Return the current clock value in ticks
+    uint64_t now() const
+    {
+#ifdef UTIL_CLOCK_HAVE_TSC
+        if (m_use_tsc)
+            return __rdtsc();
+#endif
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    /// \brief Convert \a ticks into nanoseconds
+    uint64_t to_nsec(uint64_t ticks) const
+    {
+#ifdef UTIL_CLOCK_HAVE_TSC
+        if (m_use_tsc)
+            return static_cast<uint64_t>((static_cast<unsigned __int128>(ticks) * m_mult) >> m_shift);
+#endif
+        return ticks;
+    }
+
+    /// \brief Return \c true if this clock reads the CPU timestamp counter
+    bool is_tsc() const { return m_use_tsc; }
+
+    /// \brief Return the process-wide clock object
+    ///
+    /// Returns the TSC clock if \a try_tsc is \c true and the CPU has an
+    /// invariant TSC, otherwise the clock_gettime() clock.
+    static const Clock& get(bool try_tsc = true);
+};
+
+} // namespace util
+
+} // namespace cali
+
+#endif
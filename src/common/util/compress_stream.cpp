@@ -0,0 +1,584 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+#include "compress_stream.h"
+
+#include "caliper/caliper-config.h"
+
+#ifdef CALIPER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CALIPER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <cstring>
+#include <vector>
+
+using namespace util;
+
+namespace
+{
+
+const std::size_t buffer_size = 64 * 1024;
+
+bool has_suffix(const std::string& str, const char* suffix)
+{
+    std::size_t len = std::strlen(suffix);
+    return str.size() > len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+// Collects written characters in a fixed-size put area and hands them to
+// the derived class's compressor in blocks
+class CompressStreamBufBase : public std::streambuf
+{
+    std::vector<char> m_inbuf;
+
+protected:
+
+    std::streambuf*   m_sink;
+    std::vector<char> m_outbuf;
+    bool              m_ok;
+    bool              m_finished;
+
+    virtual bool compress(const char* data, std::size_t len, bool finish) = 0;
+
+    bool write_out(std::size_t len)
+    {
+        if (len == 0)
+            return true;
+
+        return m_sink->sputn(m_outbuf.data(), len) == static_cast<std::streamsize>(len);
+    }
+
+    bool drain(bool finish)
+    {
+        std::size_t len = pptr() - pbase();
+        m_ok            = m_ok && compress(pbase(), len, finish);
+        setp(m_inbuf.data(), m_inbuf.data() + m_inbuf.size());
+        return m_ok;
+    }
+
+    // Must be called from the derived class destructor, while the compressor
+    // state is still alive
+    void finish()
+    {
+        if (m_finished)
+            return;
+
+        m_finished = true;
+
+        if (m_ok)
+            drain(true);
+
+        m_sink->pubsync();
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (m_finished || !drain(false))
+            return traits_type::eof();
+
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override
+    {
+        if (m_finished || !drain(false))
+            return -1;
+
+        return m_sink->pubsync();
+    }
+
+public:
+
+    CompressStreamBufBase(std::streambuf* sink)
+        : m_inbuf(buffer_size), m_sink(sink), m_outbuf(buffer_size), m_ok(true), m_finished(false)
+    {
+        setp(m_inbuf.data(), m_inbuf.data() + m_inbuf.size());
+    }
+
+    bool ok() const { return m_ok; }
+};
+
+#ifdef CALIPER_HAVE_ZLIB
+
+class GzipCompressStreamBuf : public CompressStreamBufBase
+{
+    z_stream m_zs;
+
+protected:
+
+    bool compress(const char* data, std::size_t len, bool finish) override
+    {
+        m_zs.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        m_zs.avail_in = static_cast<uInt>(len);
+
+        do {
+            m_zs.next_out  = reinterpret_cast<Bytef*>(m_outbuf.data());
+            m_zs.avail_out = static_cast<uInt>(m_outbuf.size());
+
+            if (deflate(&m_zs, finish ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR)
+                return false;
+            if (!write_out(m_outbuf.size() - m_zs.avail_out))
+                return false;
+        } while (m_zs.avail_out == 0);
+
+        return true;
+    }
+
+public:
+
+    GzipCompressStreamBuf(std::streambuf* sink, int level) : CompressStreamBufBase(sink)
+    {
+        std::memset(&m_zs, 0, sizeof(m_zs));
+
+        // windowBits 15 + 16 selects the gzip container format
+        if (level < 0 || level > 9)
+            level = Z_DEFAULT_COMPRESSION;
+
+        m_ok = (deflateInit2(&m_zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+
+        if (!m_ok)
+            m_finished = true;
+    }
+
+    ~GzipCompressStreamBuf()
+    {
+        finish();
+
+        if (m_ok || m_zs.state)
+            deflateEnd(&m_zs);
+    }
+};
+
+#endif
+
+#ifdef CALIPER_HAVE_ZSTD
+
+class ZstdCompressStreamBuf : public CompressStreamBufBase
+{
+    ZSTD_CCtx* m_cctx;
+
+protected:
+
+    bool compress(const char* data, std::size_t len, bool finish) override
+    {
+        ZSTD_inBuffer      in   = { data, len, 0 };
+        ZSTD_EndDirective  mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+        bool               done = false;
+
+        do {
+            ZSTD_outBuffer out = { m_outbuf.data(), m_outbuf.size(), 0 };
+            std::size_t    rem = ZSTD_compressStream2(m_cctx, &out, &in, mode);
+
+            if (ZSTD_isError(rem))
+                return false;
+            if (!write_out(out.pos))
+                return false;
+
+            done = finish ? (rem == 0) : (in.pos == in.size);
+        } while (!done);
+
+        return true;
+    }
+
+public:
+
+    ZstdCompressStreamBuf(std::streambuf* sink, int level) : CompressStreamBufBase(sink), m_cctx(ZSTD_createCCtx())
+    {
+        if (level <= 0)
+            level = 3;
+
+        m_ok = m_cctx && !ZSTD_isError(ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_compressionLevel, level));
+
+        if (!m_ok)
+            m_finished = true;
+    }
+
+    ~ZstdCompressStreamBuf()
+    {
+        finish();
+        ZSTD_freeCCtx(m_cctx);
+    }
+};
+
+#endif
+
+} // namespace
+
+struct DecompressStreamBuf::DecompressStreamBufImpl {
+    std::streambuf*   src;
+    bool              src_eof;
+    std::vector<char> inbuf;
+    std::size_t       in_pos;
+    std::size_t       in_len;
+    std::vector<char> outbuf;
+
+    bool        detected;
+    Compression format;
+
+    bool        error;
+    std::string error_msg;
+
+    bool in_member; // inside a gzip member or zstd frame
+
+#ifdef CALIPER_HAVE_ZLIB
+    z_stream zs;
+    bool     zs_init;
+#endif
+#ifdef CALIPER_HAVE_ZSTD
+    ZSTD_DCtx* dctx;
+#endif
+
+    void set_error(const char* msg)
+    {
+        error     = true;
+        error_msg = msg;
+    }
+
+    // Move unread input to the front of the buffer and refill the rest
+    void read_input()
+    {
+        if (src_eof)
+            return;
+
+        if (in_pos > 0) {
+            std::memmove(inbuf.data(), inbuf.data() + in_pos, in_len - in_pos);
+            in_len -= in_pos;
+            in_pos  = 0;
+        }
+
+        std::streamsize n = src->sgetn(inbuf.data() + in_len, inbuf.size() - in_len);
+
+        if (n <= 0)
+            src_eof = true;
+        else
+            in_len += n;
+    }
+
+    void detect()
+    {
+        detected = true;
+
+        while (!src_eof && in_len < 4)
+            read_input();
+
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(inbuf.data());
+
+        if (in_len >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+            format = Compression::Gzip;
+        else if (in_len >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd)
+            format = Compression::Zstd;
+        else
+            format = Compression::None;
+
+        if (!compression_supported(format)) {
+            set_error(
+                format == Compression::Gzip ? "Input is gzip-compressed, but gzip support is not available"
+                                            : "Input is zstd-compressed, but zstd support is not available"
+            );
+            return;
+        }
+
+#ifdef CALIPER_HAVE_ZLIB
+        if (format == Compression::Gzip) {
+            std::memset(&zs, 0, sizeof(zs));
+            zs_init = (inflateInit2(&zs, 15 + 16) == Z_OK);
+            if (!zs_init)
+                set_error("inflateInit2 failed");
+        }
+#endif
+#ifdef CALIPER_HAVE_ZSTD
+        if (format == Compression::Zstd) {
+            dctx = ZSTD_createDCtx();
+            if (!dctx)
+                set_error("ZSTD_createDCtx failed");
+        }
+#endif
+    }
+
+    // Returns a pointer to the next chunk of decoded data and sets len to
+    // its size, or returns nullptr at the end of the input
+    char* fill(std::size_t& len)
+    {
+        if (!detected)
+            detect();
+        if (error)
+            return nullptr;
+
+        switch (format) {
+        case Compression::None:
+            return fill_passthrough(len);
+        case Compression::Gzip:
+            return fill_gzip(len);
+        case Compression::Zstd:
+            return fill_zstd(len);
+        }
+
+        return nullptr;
+    }
+
+    char* fill_passthrough(std::size_t& len)
+    {
+        if (in_pos == in_len) {
+            in_pos = in_len = 0;
+            read_input();
+        }
+
+        len    = in_len - in_pos;
+        char* p = inbuf.data() + in_pos;
+        in_pos = in_len;
+
+        return len > 0 ? p : nullptr;
+    }
+
+    char* fill_gzip(std::size_t& len)
+    {
+#ifdef CALIPER_HAVE_ZLIB
+        while (true) {
+            if (in_pos == in_len)
+                read_input();
+            if (in_pos == in_len && src_eof) {
+                if (in_member)
+                    set_error("Truncated gzip input");
+                return nullptr;
+            }
+
+            zs.next_in   = reinterpret_cast<Bytef*>(inbuf.data() + in_pos);
+            zs.avail_in  = static_cast<uInt>(in_len - in_pos);
+            zs.next_out  = reinterpret_cast<Bytef*>(outbuf.data());
+            zs.avail_out = static_cast<uInt>(outbuf.size());
+
+            int ret = inflate(&zs, Z_NO_FLUSH);
+
+            in_pos = in_len - zs.avail_in;
+            len    = outbuf.size() - zs.avail_out;
+
+            if (ret == Z_STREAM_END) {
+                // another gzip member may follow (appended output)
+                inflateReset(&zs);
+                in_member = false;
+            } else if (ret == Z_OK) {
+                in_member = true;
+            } else {
+                set_error(zs.msg ? zs.msg : "gzip decompression failed");
+                return nullptr;
+            }
+
+            if (len > 0)
+                return outbuf.data();
+        }
+#else
+        (void) len;
+        return nullptr;
+#endif
+    }
+
+    char* fill_zstd(std::size_t& len)
+    {
+#ifdef CALIPER_HAVE_ZSTD
+        while (true) {
+            if (in_pos == in_len)
+                read_input();
+
+            ZSTD_inBuffer  in  = { inbuf.data(), in_len, in_pos };
+            ZSTD_outBuffer out = { outbuf.data(), outbuf.size(), 0 };
+
+            // returns 0 at the end of a frame, otherwise a size hint
+            std::size_t ret = ZSTD_decompressStream(dctx, &out, &in);
+
+            if (ZSTD_isError(ret)) {
+                set_error(ZSTD_getErrorName(ret));
+                return nullptr;
+            }
+
+            in_pos    = in.pos;
+            len       = out.pos;
+            in_member = (ret != 0);
+
+            if (len > 0)
+                return outbuf.data();
+            if (in_pos == in_len && src_eof) {
+                if (in_member)
+                    set_error("Truncated zstd input");
+                return nullptr;
+            }
+        }
+#else
+        (void) len;
+        return nullptr;
+#endif
+    }
+
+    DecompressStreamBufImpl(std::streambuf* s)
+        : src(s),
+          src_eof(false),
+          inbuf(buffer_size),
+          in_pos(0),
+          in_len(0),
+          outbuf(buffer_size),
+          detected(false),
+          format(Compression::None),
+          error(false),
+          in_member(false)
+#ifdef CALIPER_HAVE_ZLIB
+          ,
+          zs_init(false)
+#endif
+#ifdef CALIPER_HAVE_ZSTD
+          ,
+          dctx(nullptr)
+#endif
+    {}
+
+    ~DecompressStreamBufImpl()
+    {
+#ifdef CALIPER_HAVE_ZLIB
+        if (zs_init)
+            inflateEnd(&zs);
+#endif
+#ifdef CALIPER_HAVE_ZSTD
+        if (dctx)
+            ZSTD_freeDCtx(dctx);
+#endif
+    }
+};
+
+DecompressStreamBuf::DecompressStreamBuf(std::streambuf* src) : mP(new DecompressStreamBufImpl(src))
+{}
+
+DecompressStreamBuf::~DecompressStreamBuf()
+{}
+
+DecompressStreamBuf::int_type DecompressStreamBuf::underflow()
+{
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    std::size_t len = 0;
+    char*       p   = mP->fill(len);
+
+    if (!p)
+        return traits_type::eof();
+
+    setg(p, p, p + len);
+    return traits_type::to_int_type(*p);
+}
+
+Compression DecompressStreamBuf::format() const
+{
+    return mP->format;
+}
+
+bool DecompressStreamBuf::error() const
+{
+    return mP->error;
+}
+
+std::string DecompressStreamBuf::error_msg() const
+{
+    return mP->error_msg;
+}
+
+namespace util
+{
+
+Compression parse_compression(const std::string& str, bool* ok)
+{
+    if (ok)
+        *ok = true;
+
+    if (str.empty() || str == "none")
+        return Compression::None;
+    if (str == "gzip" || str == "gz")
+        return Compression::Gzip;
+    if (str == "zstd" || str == "zst")
+        return Compression::Zstd;
+
+    if (ok)
+        *ok = false;
+
+    return Compression::None;
+}
+
+const char* compression_name(Compression c)
+{
+    switch (c) {
+    case Compression::None:
+        return "none";
+    case Compression::Gzip:
+        return "gzip";
+    case Compression::Zstd:
+        return "zstd";
+    }
+
+    return "none";
+}
+
+Compression compression_from_filename(const std::string& filename)
+{
+    if (has_suffix(filename, ".gz"))
+        return Compression::Gzip;
+    if (has_suffix(filename, ".zst"))
+        return Compression::Zstd;
+
+    return Compression::None;
+}
+
+bool compression_supported(Compression c)
+{
+    switch (c) {
+    case Compression::None:
+        return true;
+    case Compression::Gzip:
+#ifdef CALIPER_HAVE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Compression::Zstd:
+#ifdef CALIPER_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+std::unique_ptr<std::streambuf> make_compress_streambuf(std::streambuf* sink, Compression c, int level)
+{
+    switch (c) {
+    case Compression::Gzip:
+#ifdef CALIPER_HAVE_ZLIB
+    {
+        std::unique_ptr<GzipCompressStreamBuf> buf(new GzipCompressStreamBuf(sink, level));
+        if (buf->ok())
+            return std::unique_ptr<std::streambuf>(buf.release());
+    }
+#endif
+        break;
+    case Compression::Zstd:
+#ifdef CALIPER_HAVE_ZSTD
+    {
+        std::unique_ptr<ZstdCompressStreamBuf> buf(new ZstdCompressStreamBuf(sink, level));
+        if (buf->ok())
+            return std::unique_ptr<std::streambuf>(buf.release());
+    }
+#endif
+        break;
+    default:
+        break;
+    }
+
+    return nullptr;
+}
+
+} // namespace util
@@ -0,0 +1,87 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+/// \file compress_stream.h
+/// Streaming (de)compression stream buffers for Caliper I/O
+
+#pragma once
+
+#ifndef UTIL_COMPRESS_STREAM_H
+#define UTIL_COMPRESS_STREAM_H
+
+#include <memory>
+#include <streambuf>
+#include <string>
+
+namespace util
+{
+
+/// \brief Stream compression formats
+enum class Compression {
+    /// No compression
+    None,
+    /// gzip (zlib)
+    Gzip,
+    /// Zstandard
+    Zstd
+};
+
+/// \brief Parse a compression format name ("none", "gzip"/"gz", or
+///   "zstd"/"zst"). Sets \a ok to \c false and returns Compression::None
+///   for unknown names.
+Compression parse_compression(const std::string& str, bool* ok = nullptr);
+
+/// \brief Return the canonical name of \a c
+const char* compression_name(Compression c);
+
+/// \brief Pick the compression format from a file name suffix
+///   (".gz" or ".zst"). Returns Compression::None for other names.
+Compression compression_from_filename(const std::string& filename);
+
+/// \brief Returns \c true if this build supports the given format
+bool compression_supported(Compression c);
+
+/// \brief Create a stream buffer that compresses everything written to it
+///   and forwards the compressed data to \a sink.
+///
+/// The compressed stream is finished (i.e., the gzip trailer or zstd frame
+/// epilogue is written) when the returned buffer is destroyed. Syncing the
+/// buffer only pushes completed compressed blocks to \a sink, so line-wise
+/// flushes in writers don't hurt the compression ratio.
+///
+/// \return The stream buffer, or \c nullptr if \a c is not supported.
+std::unique_ptr<std::streambuf> make_compress_streambuf(std::streambuf* sink, Compression c, int level = -1);
+
+/// \brief Create a stream buffer that reads from \a src and decompresses
+///   gzip or zstd input transparently.
+///
+/// The format is detected from the leading magic bytes; uncompressed input
+/// is passed through unchanged. Concatenated gzip members and zstd frames
+/// (e.g. from appending to a compressed file) are decoded in sequence.
+/// Input in a format this build does not support, or corrupted compressed
+/// data, sets the error flag and ends the stream.
+class DecompressStreamBuf : public std::streambuf
+{
+    struct DecompressStreamBufImpl;
+    std::unique_ptr<DecompressStreamBufImpl> mP;
+
+protected:
+
+    int_type underflow() override;
+
+public:
+
+    explicit DecompressStreamBuf(std::streambuf* src);
+
+    ~DecompressStreamBuf();
+
+    /// \brief The detected input format. Only valid after the first read.
+    Compression format() const;
+
+    bool        error() const;
+    std::string error_msg() const;
+};
+
+} // namespace util
+
+#endif
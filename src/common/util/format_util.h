@@ -72,6 +72,59 @@ inline std::ostream& write_cali_esc_string(std::ostream& os, const char* str, st
     return os;
 }
 
+/// \brief Append the decimal representation of \a value to \a buf
+inline void append_uint64(std::string& buf, uint64_t value)
+{
+    char     tmp[24];
+    unsigned p = 24;
+    do {
+        tmp[--p] = (static_cast<char>(value % 10) + '0');
+        value /= 10;
+    } while (value > 0);
+    buf.append(tmp + p, 24 - p);
+}
+
+/// \brief Append the decimal representation of signed \a value to \a buf
+inline void append_int64(std::string& buf, int64_t value)
+{
+    if (value < 0) {
+        buf.push_back('-');
+        append_uint64(buf, static_cast<uint64_t>(-(value + 1)) + 1);
+    } else {
+        append_uint64(buf, static_cast<uint64_t>(value));
+    }
+}
+
+/// \brief Append string \a str to \a buf, escaping characters like
+///   write_cali_esc_string()
+inline void append_cali_esc_string(std::string& buf, const char* str, std::string::size_type size)
+{
+    std::string::size_type start = 0;
+
+    for (std::string::size_type i = 0; i < size; ++i) {
+        const char c = str[i];
+
+        if (c >= 0x20 && c != '\\' && c != ',' && c != '=')
+            continue;
+
+        // copy the unescaped run up to here in one go
+        buf.append(str + start, i - start);
+        start = i + 1;
+
+        if (c < 0x20) {
+            if (c == '\n') // handle newline in string
+                buf.append("\\n", 2);
+            // skip control characters
+            continue;
+        }
+
+        buf.push_back('\\');
+        buf.push_back(c);
+    }
+
+    buf.append(str + start, size - start);
+}
+
 inline std::ostream& write_json_esc_string(std::ostream& os, const std::string& str)
 {
     return write_json_esc_string(os, str.data(), str.size());
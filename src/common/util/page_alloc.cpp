@@ -0,0 +1,122 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+#include "page_alloc.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <cstdlib>
+
+namespace
+{
+
+#ifdef __linux__
+
+// default huge page size on x86-64, and the THP size on most platforms
+const std::size_t hugepage_size = 2 * 1024 * 1024;
+
+std::size_t round_up(std::size_t n, std::size_t a)
+{
+    return ((n + a - 1) / a) * a;
+}
+
+void* map_pages(std::size_t len, int extra_flags)
+{
+    void* ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+#endif
+
+} // namespace
+
+namespace util
+{
+
+HugePages parse_hugepages(const std::string& str, bool* ok)
+{
+    if (ok)
+        *ok = true;
+
+    if (str == "none" || str.empty())
+        return HugePages::None;
+    if (str == "thp" || str == "transparent")
+        return HugePages::Transparent;
+    if (str == "explicit")
+        return HugePages::Explicit;
+
+    if (ok)
+        *ok = false;
+
+    return HugePages::None;
+}
+
+PageBlock page_alloc(std::size_t bytes, HugePages hugepages, bool prefault)
+{
+    PageBlock block { nullptr, 0, false };
+
+#ifdef __linux__
+    const std::size_t pagesize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+#ifdef MAP_HUGETLB
+    if (hugepages == HugePages::Explicit) {
+        std::size_t len = round_up(bytes, hugepage_size);
+
+        block.ptr = map_pages(len, MAP_HUGETLB);
+
+        if (block.ptr) {
+            block.size    = len;
+            block.is_huge = true;
+        }
+    }
+#endif
+
+    if (!block.ptr) {
+        std::size_t len = round_up(bytes, pagesize);
+
+        block.ptr = map_pages(len, 0);
+
+        if (!block.ptr)
+            return block;
+
+        block.size = len;
+
+#ifdef MADV_HUGEPAGE
+        if (hugepages == HugePages::Transparent)
+            madvise(block.ptr, len, MADV_HUGEPAGE);
+#endif
+    }
+
+    if (prefault) {
+        volatile unsigned char* p = static_cast<unsigned char*>(block.ptr);
+
+        for (std::size_t i = 0; i < block.size; i += pagesize)
+            p[i] = 0;
+    }
+#else
+    (void) hugepages;
+    (void) prefault;
+
+    block.ptr  = std::calloc(bytes, 1);
+    block.size = block.ptr ? bytes : 0;
+#endif
+
+    return block;
+}
+
+void page_free(const PageBlock& block)
+{
+    if (!block.ptr)
+        return;
+
+#ifdef __linux__
+    munmap(block.ptr, block.size);
+#else
+    std::free(block.ptr);
+#endif
+}
+
+} // namespace util
@@ -0,0 +1,55 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+/// \file page_alloc.h
+/// Page-backed allocation for Caliper's internal buffers
+
+#pragma once
+
+#ifndef UTIL_PAGEALLOC_H
+#define UTIL_PAGEALLOC_H
+
+#include <cstddef>
+#include <string>
+
+namespace util
+{
+
+/// \brief Huge page policy for page-backed allocations
+enum class HugePages {
+    /// Regular pages
+    None,
+    /// Request transparent huge pages for the mapping (madvise)
+    Transparent,
+    /// Use explicit (hugetlbfs) huge pages, fall back to regular pages
+    /// if none are available
+    Explicit
+};
+
+/// \brief Parse a huge page policy name ("none", "thp", or "explicit").
+///   Sets \a ok to \c false and returns HugePages::None for unknown names.
+HugePages parse_hugepages(const std::string& str, bool* ok = nullptr);
+
+/// \brief A block of page-backed memory
+struct PageBlock {
+    void*       ptr;
+    std::size_t size;    ///< Actual (page-rounded) size of the mapping
+    bool        is_huge; ///< Backed by explicit huge pages
+};
+
+/// \brief Allocate at least \a bytes of zero-initialized memory directly
+///   from the OS.
+///
+/// Pages are not touched by default, so they are placed on the NUMA node
+/// of the thread that first writes to them. With \a prefault, the calling
+/// thread touches all pages before returning.
+///
+/// \return The block. \a ptr is \c nullptr if the allocation failed.
+PageBlock page_alloc(std::size_t bytes, HugePages hugepages = HugePages::None, bool prefault = false);
+
+/// \brief Release a block allocated with page_alloc()
+void page_free(const PageBlock& block);
+
+} // namespace util
+
+#endif
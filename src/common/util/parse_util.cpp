@@ -94,3 +94,75 @@ char util::read_char(std::istream& is)
 
     return c;
 }
+
+namespace
+{
+
+//   Read the JSON string starting at the '"' at str[pos]. Returns the
+// position after the closing '"', or npos if the string is unterminated.
+std::size_t scan_json_string(const char* str, std::size_t pos, std::string* out)
+{
+    for (++pos; str[pos]; ++pos) {
+        if (str[pos] == '\\') {
+            if (!str[++pos])
+                break;
+        } else if (str[pos] == '"') {
+            return pos + 1;
+        }
+
+        if (out)
+            out->push_back(str[pos]);
+    }
+
+    return std::string::npos;
+}
+
+} // namespace
+
+bool util::find_json_toplevel_string(const char* json, const char* key, std::string& value)
+{
+    std::size_t pos = 0;
+
+    while (std::isspace(json[pos]))
+        ++pos;
+
+    if (json[pos] != '{')
+        return false;
+
+    int  depth      = 0;
+    bool expect_key = false;
+
+    for (; json[pos]; ++pos) {
+        char c = json[pos];
+
+        if (c == '{' || c == '[') {
+            ++depth;
+            expect_key = (c == '{' && depth == 1);
+        } else if (c == '}' || c == ']') {
+            --depth;
+        } else if (c == ',') {
+            expect_key = (depth == 1);
+        } else if (c == '"') {
+            std::string str;
+            pos = scan_json_string(json, pos, expect_key ? &str : nullptr);
+
+            if (pos == std::string::npos)
+                return false;
+
+            if (expect_key && str == key) {
+                while (std::isspace(json[pos]) || json[pos] == ':')
+                    ++pos;
+                if (json[pos] != '"')
+                    return false;
+
+                value.clear();
+                return scan_json_string(json, pos, &value) != std::string::npos;
+            }
+
+            expect_key = false;
+            --pos;
+        }
+    }
+
+    return false;
+}
@@ -34,6 +34,12 @@ std::string read_nested_text(std::istream& is, char start_char, char end_char);
 /// \brief Read character from stream \a is, skipping whitespace.
 char read_char(std::istream& is);
 
+/// \brief Find the string value of the top-level entry \a key in the JSON
+///   dictionary \a json without parsing the entire dictionary.
+///
+/// \return \c true if the entry was found and is a string, \c false otherwise.
+bool find_json_toplevel_string(const char* json, const char* key, std::string& value);
+
 inline std::pair<bool, uint64_t> str_to_uint64(const char* str)
 {
     uint64_t    ret = 0;
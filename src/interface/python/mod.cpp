@@ -2,6 +2,7 @@
 #include "config_manager.h"
 #include "instrumentation.h"
 #include "loop.h"
+#include "reader.h"
 
 bool pycaliper_is_initialized()
 {
@@ -85,4 +86,7 @@ PYBIND11_MODULE(__pycaliper_impl, m)
 
     auto config_mgr_mod = m.def_submodule("config_manager", "Support for dynamic configuration of Caliper.");
     cali::create_caliper_config_manager_mod(config_mgr_mod);
+
+    auto reader_mod = m.def_submodule("reader", "Native reader for .cali files.");
+    cali::create_caliper_reader_mod(reader_mod);
 }
\ No newline at end of file
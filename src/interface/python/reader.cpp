@@ -0,0 +1,370 @@
+#include "reader.h"
+
+#include <caliper/common/Attribute.h>
+#include <caliper/common/Node.h>
+
+#include <caliper/reader/CaliReader.h>
+
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+namespace cali
+{
+
+namespace
+{
+
+bool is_numeric_type(cali_attr_type type)
+{
+    return type == CALI_TYPE_INT || type == CALI_TYPE_UINT || type == CALI_TYPE_DOUBLE || type == CALI_TYPE_BOOL;
+}
+
+std::shared_ptr<PythonColumnBuffer> make_buffer_for_type(cali_attr_type type, std::size_t count)
+{
+    switch (type) {
+    case CALI_TYPE_INT:
+        return std::make_shared<PythonColumnBuffer>(py::format_descriptor<int64_t>::format(), sizeof(int64_t), count);
+    case CALI_TYPE_UINT:
+        return std::make_shared<PythonColumnBuffer>(
+            py::format_descriptor<uint64_t>::format(),
+            sizeof(uint64_t),
+            count
+        );
+    case CALI_TYPE_DOUBLE:
+        return std::make_shared<PythonColumnBuffer>(py::format_descriptor<double>::format(), sizeof(double), count);
+    default:
+        return std::make_shared<PythonColumnBuffer>(py::format_descriptor<uint8_t>::format(), sizeof(uint8_t), count);
+    }
+}
+
+void set_buffer_value(PythonColumnBuffer& buf, std::size_t i, cali_attr_type type, const Variant& v)
+{
+    switch (type) {
+    case CALI_TYPE_INT:
+        buf.data<int64_t>()[i] = v.to_int64();
+        break;
+    case CALI_TYPE_UINT:
+        buf.data<uint64_t>()[i] = v.to_uint();
+        break;
+    case CALI_TYPE_DOUBLE:
+        buf.data<double>()[i] = v.to_double();
+        break;
+    default:
+        buf.data<uint8_t>()[i] = v.to_bool() ? 1 : 0;
+    }
+}
+
+/// \brief Expand a reference entry into attribute:values pairs following
+///   the conventions of the pure-Python reader
+void expand_node_path(
+    const CaliperMetadataDB&                       db,
+    const Node*                                    node,
+    std::map<cali_id_t, std::vector<std::string>>& values,
+    std::vector<std::string>&                      path
+)
+{
+    std::vector<const Node*> nodes;
+
+    for (; node && node->id() != CALI_INV_ID; node = node->parent())
+        nodes.push_back(node);
+
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+        Attribute attr = db.get_attribute((*it)->attribute());
+
+        if (!attr || attr.is_hidden())
+            continue;
+
+        std::string str = (*it)->data().to_string();
+
+        if (attr.is_nested())
+            path.push_back(str);
+
+        values[attr.id()].push_back(std::move(str));
+    }
+}
+
+py::object make_value_object(const std::vector<std::string>& vec)
+{
+    if (vec.size() == 1)
+        return py::str(vec.front());
+
+    py::list list;
+    for (const std::string& s : vec)
+        list.append(py::str(s));
+
+    return std::move(list);
+}
+
+} // namespace
+
+py::buffer_info PythonColumnBuffer::buffer_info()
+{
+    return py::buffer_info(
+        m_data.data(),
+        static_cast<py::ssize_t>(m_itemsize),
+        m_format,
+        1,
+        { static_cast<py::ssize_t>(m_count) },
+        { static_cast<py::ssize_t>(m_itemsize) }
+    );
+}
+
+PythonCaliReader::PythonCaliReader()
+{}
+
+void PythonCaliReader::read(const std::string& filename)
+{
+    CaliReader reader;
+
+    {
+        py::gil_scoped_release release;
+
+        reader.read(
+            filename,
+            m_db,
+            [](CaliperMetadataAccessInterface&, const Node*) {},
+            [this](CaliperMetadataAccessInterface&, const EntryList& rec) { m_records.push_back(rec); }
+        );
+    }
+
+    if (reader.error())
+        throw std::runtime_error(filename + ": " + reader.error_msg());
+}
+
+py::dict PythonCaliReader::expand_record(const EntryList& rec)
+{
+    py::dict ret;
+
+    for (const Entry& e : rec) {
+        if (e.is_reference()) {
+            std::map<cali_id_t, std::vector<std::string>> values;
+            std::vector<std::string>                      path;
+
+            expand_node_path(m_db, e.node(), values, path);
+
+            for (const auto& p : values)
+                ret[py::str(m_db.get_attribute(p.first).name())] = make_value_object(p.second);
+            if (!path.empty())
+                ret["path"] = py::cast(path);
+        } else if (e.is_immediate()) {
+            Attribute attr = m_db.get_attribute(e.attribute());
+
+            if (attr && !attr.is_hidden())
+                ret[py::str(attr.name())] = py::str(e.value().to_string());
+        }
+    }
+
+    return ret;
+}
+
+py::list PythonCaliReader::records()
+{
+    py::list ret;
+
+    for (const EntryList& rec : m_records)
+        ret.append(expand_record(rec));
+
+    return ret;
+}
+
+py::dict PythonCaliReader::globals()
+{
+    return expand_record(m_db.get_globals());
+}
+
+py::list PythonCaliReader::attributes() const
+{
+    py::list ret;
+
+    for (const Attribute& attr : m_db.get_all_attributes())
+        if (!attr.is_hidden())
+            ret.append(py::str(attr.name()));
+
+    return ret;
+}
+
+py::dict PythonCaliReader::attribute_metadata(const std::string& name) const
+{
+    Attribute attr = m_db.get_attribute(name);
+
+    if (!attr)
+        throw py::key_error(name);
+
+    py::dict ret;
+    int      prop = attr.properties();
+
+    ret["id"]                 = py::int_(attr.id());
+    ret["properties"]         = py::int_(prop);
+    ret["type"]               = py::str(cali_type2string(attr.type()));
+    ret["is_global"]          = py::bool_(attr.is_global());
+    ret["is_value"]           = py::bool_(attr.store_as_value());
+    ret["is_nested"]          = py::bool_(attr.is_nested());
+    ret["is_hidden"]          = py::bool_(attr.is_hidden());
+    ret["is_aggregatable"]    = py::bool_((prop & CALI_ATTR_AGGREGATABLE) != 0);
+    ret["class.aggregatable"] = py::bool_((prop & CALI_ATTR_AGGREGATABLE) != 0);
+
+    for (const Node* node = m_db.node(attr.id()); node && node->id() != CALI_INV_ID; node = node->parent()) {
+        Attribute meta_attr = m_db.get_attribute(node->attribute());
+
+        if (meta_attr && !ret.contains(meta_attr.name()))
+            ret[py::str(meta_attr.name())] = py::str(node->data().to_string());
+    }
+
+    return ret;
+}
+
+py::dict PythonCaliReader::columns()
+{
+    struct ColumnData {
+        cali_attr_type                      type;
+        std::shared_ptr<PythonColumnBuffer> values;
+        std::shared_ptr<PythonColumnBuffer> valid;
+        py::list                            objects;
+    };
+
+    const std::size_t num_rows = m_records.size();
+
+    std::map<cali_id_t, ColumnData> cols;
+    py::list                        path_col;
+    bool                            have_path = false;
+
+    auto get_column = [&](cali_id_t attr_id) -> ColumnData* {
+        auto it = cols.find(attr_id);
+
+        if (it != cols.end())
+            return &it->second;
+
+        Attribute attr = m_db.get_attribute(attr_id);
+
+        if (!attr || attr.is_hidden())
+            return nullptr;
+
+        ColumnData col;
+        col.type = attr.type();
+
+        if (attr.store_as_value() && is_numeric_type(col.type)) {
+            col.values = make_buffer_for_type(col.type, num_rows);
+            col.valid  = make_buffer_for_type(CALI_TYPE_BOOL, num_rows);
+        } else {
+            col.objects = py::list(num_rows);
+
+            for (std::size_t i = 0; i < num_rows; ++i)
+                col.objects[i] = py::none();
+        }
+
+        return &(cols.emplace(attr_id, std::move(col)).first->second);
+    };
+
+    for (std::size_t row = 0; row < num_rows; ++row) {
+        for (const Entry& e : m_records[row]) {
+            if (e.is_reference()) {
+                std::map<cali_id_t, std::vector<std::string>> values;
+                std::vector<std::string>                      path;
+
+                expand_node_path(m_db, e.node(), values, path);
+
+                for (const auto& p : values) {
+                    ColumnData* col = get_column(p.first);
+
+                    if (!col)
+                        continue;
+
+                    if (col->values) {
+                        Variant v = Variant::from_string(col->type, p.second.back().c_str());
+                        set_buffer_value(*(col->values), row, col->type, v);
+                        col->valid->data<uint8_t>()[row] = 1;
+                    } else {
+                        col->objects[row] = make_value_object(p.second);
+                    }
+                }
+
+                if (!path.empty()) {
+                    if (!have_path) {
+                        path_col = py::list(num_rows);
+
+                        for (std::size_t i = 0; i < num_rows; ++i)
+                            path_col[i] = py::none();
+
+                        have_path = true;
+                    }
+
+                    path_col[row] = py::cast(path);
+                }
+            } else if (e.is_immediate()) {
+                ColumnData* col = get_column(e.attribute());
+
+                if (!col)
+                    continue;
+
+                if (col->values) {
+                    set_buffer_value(*(col->values), row, col->type, e.value());
+                    col->valid->data<uint8_t>()[row] = 1;
+                } else {
+                    col->objects[row] = py::str(e.value().to_string());
+                }
+            }
+        }
+    }
+
+    py::dict ret;
+
+    for (auto& p : cols) {
+        py::str name(m_db.get_attribute(p.first).name());
+
+        if (p.second.values)
+            ret[name] = py::make_tuple(p.second.values, p.second.valid);
+        else
+            ret[name] = p.second.objects;
+    }
+
+    if (have_path)
+        ret["path"] = path_col;
+
+    return ret;
+}
+
+void create_caliper_reader_mod(py::module_& caliper_reader_mod)
+{
+    py::class_<PythonColumnBuffer, std::shared_ptr<PythonColumnBuffer>> column_buffer_type(
+        caliper_reader_mod,
+        "ColumnBuffer",
+        py::buffer_protocol()
+    );
+    column_buffer_type.def_buffer(&PythonColumnBuffer::buffer_info);
+    column_buffer_type.def("__len__", &PythonColumnBuffer::size);
+
+    py::class_<PythonCaliReader> reader_type(caliper_reader_mod, "CaliReader");
+    reader_type.def(py::init<>(), "Create a CaliReader.");
+    reader_type.def(
+        "read",
+        &PythonCaliReader::read,
+        "Read a .cali file.\n\n"
+        "Records are kept in the reader's metadata DB. Can be called multiple "
+        "times to read several files into the same DB."
+    );
+    reader_type.def_property_readonly("num_records", &PythonCaliReader::num_records, "Number of records read.");
+    reader_type.def(
+        "records",
+        &PythonCaliReader::records,
+        "Return the records as list of dicts, in the same layout as the pure-Python reader."
+    );
+    reader_type.def("globals", &PythonCaliReader::globals, "Return the global (run metadata) values as dict.");
+    reader_type.def("attributes", &PythonCaliReader::attributes, "Return the names of all non-hidden attributes.");
+    reader_type.def(
+        "attribute_metadata",
+        &PythonCaliReader::attribute_metadata,
+        "Return the properties and metadata of the given attribute as dict."
+    );
+    reader_type.def(
+        "columns",
+        &PythonCaliReader::columns,
+        "Return the records in columnar form.\n\n"
+        "Returns a dict with one entry per attribute. Numeric value attributes "
+        "are (values, valid) tuples of ColumnBuffer objects that support the "
+        "buffer protocol (e.g., numpy.asarray()). Other attributes are lists "
+        "with one entry (or None) per record."
+    );
+}
+
+} // namespace cali
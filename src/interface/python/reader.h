@@ -0,0 +1,68 @@
+#ifndef CALI_INTERFACE_PYTHON_READER_H
+#define CALI_INTERFACE_PYTHON_READER_H
+
+#include "common.h"
+
+#include <caliper/reader/CaliperMetadataDB.h>
+#include <caliper/reader/RecordProcessor.h>
+
+#include <string>
+#include <vector>
+
+namespace cali
+{
+
+/// \brief A typed, contiguous column of values exported through the
+///   Python buffer protocol (e.g., for zero-copy numpy.asarray())
+class PythonColumnBuffer
+{
+    std::vector<unsigned char> m_data;
+    std::string                m_format;
+    std::size_t                m_itemsize;
+    std::size_t                m_count;
+
+public:
+
+    PythonColumnBuffer(const std::string& format, std::size_t itemsize, std::size_t count)
+        : m_data(itemsize * count, 0), m_format(format), m_itemsize(itemsize), m_count(count)
+    {}
+
+    template <typename T>
+    T* data()
+    {
+        return reinterpret_cast<T*>(m_data.data());
+    }
+
+    py::buffer_info buffer_info();
+
+    std::size_t size() const { return m_count; }
+};
+
+/// \brief Native .cali file reader for the caliperreader Python package
+class PythonCaliReader
+{
+    CaliperMetadataDB      m_db;
+    std::vector<EntryList> m_records;
+
+    py::dict expand_record(const EntryList& rec);
+
+public:
+
+    PythonCaliReader();
+
+    void read(const std::string& filename);
+
+    std::size_t num_records() const { return m_records.size(); }
+
+    py::list records();
+    py::dict globals();
+    py::list attributes() const;
+    py::dict attribute_metadata(const std::string& name) const;
+    py::dict columns();
+};
+
+void create_caliper_reader_mod(py::module_& caliper_reader_mod);
+
+} // namespace cali
+
+#endif /* CALI_INTERFACE_PYTHON_READER_H */
@@ -7,6 +7,8 @@
 #include "caliper/reader/FormatProcessor.h"
 #include "caliper/reader/Preprocessor.h"
 
+#include "caliper/common/StringConverter.h"
+
 #include "../common/util/parse_util.h"
 
 #include <algorithm>
@@ -86,7 +88,7 @@ struct CalQLParser::CalQLParserImpl {
     std::string            error_msg;
     std::istream::pos_type error_pos;
 
-    enum Clause { None = 0, Aggregate, Format, Group, Select, Sort, Where, Let };
+    enum Clause { None = 0, Aggregate, Format, Group, Select, Sort, Where, Let, Limit };
 
     Clause get_clause_from_word(const std::string& w)
     {
@@ -95,6 +97,7 @@ struct CalQLParser::CalQLParserImpl {
             Clause      clause;
         } keywords[] = { { "aggregate", Aggregate }, { "format", Format }, { "group", Group }, { "select", Select },
                          { "order", Sort },          { "where", Where },   { "let", Let },
+                         { "limit", Limit },
 
                          { nullptr, None } };
 
@@ -593,6 +596,24 @@ struct CalQLParser::CalQLParserImpl {
             parse_clause_from_word(next_keyword, is);
     }
 
+    void parse_limit(std::istream& is)
+    {
+        std::string w = util::read_word(is, ",;=<>()\n");
+
+        if (w.empty()) {
+            set_error("Expected number for LIMIT", is);
+            return;
+        }
+
+        bool               ok = false;
+        unsigned long long n  = StringConverter(w).to_uint(&ok);
+
+        if (!ok || n == 0)
+            set_error(std::string("Invalid LIMIT value ") + w, is);
+        else
+            spec.limit = static_cast<std::size_t>(n);
+    }
+
     void parse_clause(Clause clause, std::istream& is)
     {
         switch (clause) {
@@ -619,6 +640,9 @@ struct CalQLParser::CalQLParserImpl {
         case Let:
             parse_let(is);
             break;
+        case Limit:
+            parse_limit(is);
+            break;
         case None:
             // do nothing
             break;
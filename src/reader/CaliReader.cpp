@@ -8,6 +8,8 @@
 #include "caliper/common/Log.h"
 #include "caliper/common/StringConverter.h"
 
+#include "../common/util/compress_stream.h"
+
 #include <algorithm>
 #include <iostream>
 #include <fstream>
@@ -257,12 +259,19 @@ struct CaliReader::CaliReaderImpl {
     {
         IdMap idmap;
 
-        for (std::string line; std::getline(is, line);) {
+        // transparently decompresses gzip/zstd input
+        util::DecompressStreamBuf zbuf(is.rdbuf());
+        std::istream              zis(&zbuf);
+
+        for (std::string line; std::getline(zis, line);) {
             if (line.empty())
                 continue;
             fast_istringstream isstream { line.begin(), line.end() };
             read_record(isstream, db, idmap, node_proc, snap_proc);
         }
+
+        if (zbuf.error())
+            set_error(zbuf.error_msg());
     }
 };
 
@@ -297,7 +306,7 @@ void CaliReader::read(
     if (filename.empty())
         mP->read(std::cin, db, node_proc, snap_proc);
     else {
-        std::ifstream is(filename.c_str());
+        std::ifstream is(filename.c_str(), std::ios::binary);
 
         if (!is) {
             mP->m_error     = true;
@@ -12,7 +12,8 @@
 #include "../common/util/format_util.h"
 
 #include <mutex>
-#include <set>
+#include <string>
+#include <unordered_set>
 
 using namespace cali;
 
@@ -21,76 +22,108 @@ namespace
 
 enum RecordKind { Snapshot, Globals };
 
-void write_node_content(std::ostream& os, const cali::Node* node)
-{
-    util::write_uint64(os.write("__rec=node,id=", 14), node->id());
-    util::write_uint64(os.write(",attr=", 6), node->attribute());
-
-    node->data().write_cali(os.write(",data=", 6));
+// Output is collected and written in blocks of this size
+const std::size_t block_size = 4 * 1024 * 1024;
 
-    if (node->parent() && node->parent()->id() != CALI_INV_ID)
-        util::write_uint64(os.write(",parent=", 8), node->parent()->id());
+void append_node_content(std::string& buf, const cali::Node* node)
+{
+    buf.append("__rec=node,id=", 14);
+    util::append_uint64(buf, node->id());
+    buf.append(",attr=", 6);
+    util::append_uint64(buf, node->attribute());
+    buf.append(",data=", 6);
+    node->data().append_cali(buf);
+
+    if (node->parent() && node->parent()->id() != CALI_INV_ID) {
+        buf.append(",parent=", 8);
+        util::append_uint64(buf, node->parent()->id());
+    }
 
-    os.put('\n');
+    buf.push_back('\n');
 }
 
-void write_record_content(
-    std::ostream&             os,
-    RecordKind                kind,
-    const std::vector<Entry>& ref_entries,
-    const std::vector<Entry>& imm_entries
-)
+void append_record_content(std::string& buf, RecordKind kind, const std::vector<Entry>& rec)
 {
     if (kind == RecordKind::Snapshot)
-        os.write("__rec=ctx", 9);
+        buf.append("__rec=ctx", 9);
     else if (kind == RecordKind::Globals)
-        os.write("__rec=globals", 13);
+        buf.append("__rec=globals", 13);
 
     // write reference entries
-    if (!ref_entries.empty()) {
-        os.write(",ref", 4);
-        for (const Entry& e : ref_entries)
-            util::write_uint64(os.put('='), e.node()->id());
-    }
+    bool first = true;
+
+    for (const Entry& e : rec)
+        if (e.is_reference()) {
+            if (first)
+                buf.append(",ref", 4);
+            first = false;
+            buf.push_back('=');
+            util::append_uint64(buf, e.node()->id());
+        }
 
     // write immediate entries
-    if (!imm_entries.empty()) {
-        os.write(",attr", 5);
-        for (const Entry& e : imm_entries)
-            util::write_uint64(os.put('='), e.attribute());
-
-        os.write(",data", 5);
-        for (const Entry& e : imm_entries)
-            e.value().write_cali(os.put('='));
+    first = true;
+
+    for (const Entry& e : rec)
+        if (e.is_immediate()) {
+            if (first)
+                buf.append(",attr", 5);
+            first = false;
+            buf.push_back('=');
+            util::append_uint64(buf, e.attribute());
+        }
+
+    if (!first) {
+        buf.append(",data", 5);
+
+        for (const Entry& e : rec)
+            if (e.is_immediate()) {
+                buf.push_back('=');
+                e.value().append_cali(buf);
+            }
     }
 
-    os.put('\n');
+    buf.push_back('\n');
 }
 
 } // namespace
 
 struct CaliWriter::CaliWriterImpl {
     OutputStream m_os;
-    std::mutex   m_os_lock;
 
-    std::set<cali_id_t> m_written_nodes;
-    std::mutex          m_written_nodes_lock;
+    //   Records are formatted directly into the output block, which is
+    // written out once it is full. The lock also covers the written-nodes
+    // set so that node records always precede the records referencing
+    // them in the output.
+    std::mutex  m_lock;
+    std::string m_block;
+
+    std::unordered_set<cali_id_t> m_written_nodes;
 
     std::size_t m_num_written;
 
     CaliWriterImpl(OutputStream& os) : m_os(os), m_num_written(0) {}
 
-    void recursive_write_node(const CaliperMetadataAccessInterface& db, cali_id_t id)
+    ~CaliWriterImpl() { flush(); }
+
+    void write_block()
     {
-        if (id < 11) // don't write the hard-coded metadata nodes
+        if (m_block.empty())
             return;
 
-        {
-            std::lock_guard<std::mutex> g(m_written_nodes_lock);
+        std::ostream* real_os = m_os.stream();
 
-            if (m_written_nodes.count(id) > 0)
-                return;
-        }
+        real_os->write(m_block.data(), m_block.size());
+        m_block.clear();
+    }
+
+    // must be called with m_lock held
+    void recursive_write_node(const CaliperMetadataAccessInterface& db, cali_id_t id)
+    {
+        if (id < 11) // don't write the hard-coded metadata nodes
+            return;
+        if (m_written_nodes.count(id) > 0)
+            return;
 
         Node* node = db.node(id);
 
@@ -104,51 +137,38 @@ struct CaliWriter::CaliWriterImpl {
         if (parent && parent->id() != CALI_INV_ID)
             recursive_write_node(db, parent->id());
 
-        {
-            std::lock_guard<std::mutex> g(m_os_lock);
-
-            std::ostream* real_os = m_os.stream();
+        ::append_node_content(m_block, node);
+        ++m_num_written;
 
-            ::write_node_content(*real_os, node);
-            ++m_num_written;
-        }
-
-        {
-            std::lock_guard<std::mutex> g(m_written_nodes_lock);
-
-            m_written_nodes.insert(id);
-        }
+        m_written_nodes.insert(id);
     }
 
     void write_entrylist(const CaliperMetadataAccessInterface& db, RecordKind kind, const std::vector<Entry>& rec)
     {
-        // write node entries
+        std::lock_guard<std::mutex> g(m_lock);
 
-        std::vector<Entry> ref_entries;
-        std::vector<Entry> imm_entries;
-        ref_entries.reserve(rec.size());
-        imm_entries.reserve(rec.size());
+        // write node entries
 
         for (const Entry& e : rec) {
-            if (e.is_reference()) {
+            if (e.is_reference())
                 recursive_write_node(db, e.node()->id());
-                ref_entries.push_back(e);
-            } else if (e.is_immediate()) {
+            else if (e.is_immediate())
                 recursive_write_node(db, e.attribute());
-                imm_entries.push_back(e);
-            }
         }
 
         // write the record
 
-        {
-            std::lock_guard<std::mutex> g(m_os_lock);
+        ::append_record_content(m_block, kind, rec);
+        ++m_num_written;
 
-            std::ostream* real_os = m_os.stream();
+        if (m_block.size() >= block_size)
+            write_block();
+    }
 
-            ::write_record_content(*real_os, kind, ref_entries, imm_entries);
-            ++m_num_written;
-        }
+    void flush()
+    {
+        std::lock_guard<std::mutex> g(m_lock);
+        write_block();
     }
 };
 
@@ -165,6 +185,12 @@ size_t CaliWriter::num_written() const
     return mP ? mP->m_num_written : 0;
 }
 
+void CaliWriter::flush()
+{
+    if (mP)
+        mP->flush();
+}
+
 void CaliWriter::write_snapshot(const CaliperMetadataAccessInterface& db, const std::vector<Entry>& list)
 {
     mP->write_entrylist(db, ::RecordKind::Snapshot, list);
@@ -7,6 +7,7 @@
 #include "JsonFormatter.h"
 #include "JsonSplitFormatter.h"
 #include "TableFormatter.h"
+#include "TraceEventFormatter.h"
 #include "TreeFormatter.h"
 #include "UserFormatter.h"
 
@@ -24,8 +25,10 @@ const char* format_kernel_args[] = { "format", "title" };
 const char* tree_kernel_args[]   = { "path-attributes", "column-width", "print-globals" };
 const char* table_kernel_args[]  = { "column-width", "print-globals" };
 const char* json_kernel_args[]   = { "object", "pretty", "quote-all", "separate-nested", "records", "split" };
+const char* jsplit_kernel_args[] = { "memory-budget" };
+const char* tevent_kernel_args[] = { "pid-attributes", "tid-attributes" };
 
-enum FormatterID { Cali = 0, Json = 1, Expand = 2, Format = 3, Table = 4, Tree = 5, JsonSplit = 6 };
+enum FormatterID { Cali = 0, Json = 1, Expand = 2, Format = 3, Table = 4, Tree = 5, JsonSplit = 6, TraceEvent = 7 };
 
 const QuerySpec::FunctionSignature formatters[] = { { FormatterID::Cali, "cali", 0, 0, nullptr },
                                                     { FormatterID::Json, "json", 0, 6, json_kernel_args },
@@ -33,7 +36,8 @@ const QuerySpec::FunctionSignature formatters[] = { { FormatterID::Cali, "cali",
                                                     { FormatterID::Format, "format", 1, 2, format_kernel_args },
                                                     { FormatterID::Table, "table", 0, 2, table_kernel_args },
                                                     { FormatterID::Tree, "tree", 0, 3, tree_kernel_args },
-                                                    { FormatterID::JsonSplit, "json-split", 0, 0, nullptr },
+                                                    { FormatterID::JsonSplit, "json-split", 0, 1, jsplit_kernel_args },
+                                                    { FormatterID::TraceEvent, "traceevent", 0, 2, tevent_kernel_args },
 
                                                     QuerySpec::FunctionSignatureTerminator };
 
@@ -50,7 +54,11 @@ public:
         m_writer.write_snapshot(db, list);
     }
 
-    void flush(CaliperMetadataAccessInterface& db, std::ostream&) { m_writer.write_globals(db, db.get_globals()); }
+    void flush(CaliperMetadataAccessInterface& db, std::ostream&)
+    {
+        m_writer.write_globals(db, db.get_globals());
+        m_writer.flush();
+    }
 };
 
 } // namespace
@@ -86,6 +94,9 @@ struct FormatProcessor::FormatProcessorImpl {
             case FormatterID::JsonSplit:
                 m_formatter = new JsonSplitFormatter(spec);
                 break;
+            case FormatterID::TraceEvent:
+                m_formatter = new TraceEventFormatter(m_stream, spec);
+                break;
             }
         }
     }
@@ -12,12 +12,15 @@
 #include "caliper/common/CaliperMetadataAccessInterface.h"
 #include "caliper/common/Node.h"
 #include "caliper/common/OutputStream.h"
+#include "caliper/common/StringConverter.h"
 
 #include "caliper/common/lockfree-tree.hpp"
 
 #include "../common/util/format_util.h"
+#include "../common/util/vlenc.h"
 
 #include <algorithm>
+#include <cstdio>
 #include <functional>
 #include <iterator>
 #include <mutex>
@@ -136,6 +139,88 @@ public:
     }
 };
 
+/// \brief Temporary file for records that exceed the in-memory budget
+///
+/// Records are stored in packed binary form (Entry::pack()). Node
+/// references and immediate values remain valid since the metadata DB
+/// outlives the formatter.
+class RecordSpillFile
+{
+    std::FILE*                 m_file;
+    std::size_t                m_num_records;
+    std::vector<unsigned char> m_buffer;
+
+public:
+
+    RecordSpillFile() : m_file(nullptr), m_num_records(0) {}
+
+    ~RecordSpillFile()
+    {
+        if (m_file)
+            std::fclose(m_file);
+    }
+
+    std::size_t num_records() const { return m_num_records; }
+
+    bool write(const EntryList& rec)
+    {
+        if (!m_file) {
+            m_file = std::tmpfile();
+
+            if (!m_file)
+                return false;
+        }
+
+        m_buffer.resize(10 + rec.size() * Entry::MAX_PACKED_SIZE);
+
+        std::size_t pos = vlenc_u64(rec.size(), m_buffer.data());
+
+        for (const Entry& e : rec)
+            pos += e.pack(m_buffer.data() + pos);
+
+        uint32_t len = static_cast<uint32_t>(pos);
+
+        if (std::fwrite(&len, sizeof(len), 1, m_file) != 1 || std::fwrite(m_buffer.data(), 1, pos, m_file) != pos)
+            return false;
+
+        ++m_num_records;
+        return true;
+    }
+
+    /// \brief Read back all records in order and invoke \a fn on each
+    template <typename RecFn>
+    void for_each(CaliperMetadataAccessInterface& db, RecFn fn)
+    {
+        if (!m_file)
+            return;
+
+        std::rewind(m_file);
+
+        EntryList rec;
+        uint32_t  len = 0;
+
+        for (std::size_t r = 0; r < m_num_records; ++r) {
+            if (std::fread(&len, sizeof(len), 1, m_file) != 1)
+                break;
+
+            m_buffer.resize(len);
+
+            if (std::fread(m_buffer.data(), 1, len, m_file) != len)
+                break;
+
+            std::size_t pos = 0;
+            std::size_t n   = vldec_u64(m_buffer.data(), &pos);
+
+            rec.clear();
+
+            for (std::size_t i = 0; i < n && pos < len; ++i)
+                rec.push_back(Entry::unpack(db, m_buffer.data() + pos, &pos));
+
+            fn(rec);
+        }
+    }
+};
+
 } // namespace
 
 struct JsonSplitFormatter::JsonSplitFormatterImpl {
@@ -166,7 +251,14 @@ struct JsonSplitFormatter::JsonSplitFormatterImpl {
     std::vector<EntryList> m_records;
     std::mutex             m_records_lock;
 
-    JsonSplitFormatterImpl() : m_select_all(false) {}
+    // Records are moved to the spill file when the in-memory records
+    // exceed m_memory_budget bytes. A budget of 0 disables spilling.
+    std::size_t     m_memory_budget;
+    std::size_t     m_records_size;
+    RecordSpillFile m_spill_file;
+    bool            m_spill_error;
+
+    JsonSplitFormatterImpl() : m_select_all(false), m_memory_budget(0), m_records_size(0), m_spill_error(false) {}
 
     void configure(const QuerySpec& spec)
     {
@@ -197,6 +289,19 @@ struct JsonSplitFormatter::JsonSplitFormatterImpl {
         }
 
         m_aliases = spec.aliases;
+
+        {
+            auto it = spec.format.kwargs.find("memory-budget");
+            if (it != spec.format.kwargs.end()) {
+                bool ok = false;
+                auto mb = StringConverter(it->second).to_uint(&ok);
+
+                if (ok)
+                    m_memory_budget = mb * 1024 * 1024;
+                else
+                    std::cerr << "json-split: invalid memory-budget value " << it->second << std::endl;
+            }
+        }
     }
 
     std::vector<Column> init_columns(const CaliperMetadataAccessInterface& db) const
@@ -291,11 +396,45 @@ struct JsonSplitFormatter::JsonSplitFormatterImpl {
         os << "null";
     }
 
+    static std::size_t record_size(const EntryList& list)
+    {
+        return sizeof(EntryList) + list.size() * sizeof(Entry);
+    }
+
+    void spill_records()
+    {
+        auto it = m_records.begin();
+
+        for (; it != m_records.end(); ++it)
+            if (!m_spill_file.write(*it))
+                break;
+
+        if (it != m_records.end()) {
+            std::cerr << "json-split: could not write temporary file, keeping records in memory" << std::endl;
+            m_spill_error = true;
+
+            // the records written so far are in the spill file: drop them
+            // from memory so they aren't written twice
+            for (auto wit = m_records.begin(); wit != it; ++wit)
+                m_records_size -= record_size(*wit);
+
+            m_records.erase(m_records.begin(), it);
+            return;
+        }
+
+        m_records.clear();
+        m_records_size = 0;
+    }
+
     void process_record(const CaliperMetadataAccessInterface& db, const EntryList& list)
     {
         std::lock_guard<std::mutex> g(m_records_lock);
 
         m_records.push_back(list);
+        m_records_size += record_size(list);
+
+        if (m_memory_budget > 0 && !m_spill_error && m_records_size > m_memory_budget)
+            spill_records();
     }
 
     std::ostream& write_globals(std::ostream& os, CaliperMetadataAccessInterface& db)
@@ -392,7 +531,7 @@ struct JsonSplitFormatter::JsonSplitFormatterImpl {
 
         int rowcount = 0;
 
-        for (auto rec : m_records) {
+        auto write_row = [&](const EntryList& rec) {
             os << (rowcount++ > 0 ? ",\n    [ " : "\n    [ ");
 
             int colcount = 0;
@@ -408,7 +547,13 @@ struct JsonSplitFormatter::JsonSplitFormatterImpl {
             }
 
             os << " ]";
-        }
+        };
+
+        // spilled records come first to keep the original record order
+        m_spill_file.for_each(db, write_row);
+
+        for (const EntryList& rec : m_records)
+            write_row(rec);
 
         // close "data"
         os << "\n  ]";
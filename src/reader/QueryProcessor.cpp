@@ -6,6 +6,7 @@
 #include "caliper/reader/Aggregator.h"
 #include "caliper/reader/FormatProcessor.h"
 #include "caliper/reader/Preprocessor.h"
+#include "caliper/reader/RecordLimiter.h"
 #include "caliper/reader/RecordSelector.h"
 
 #include "caliper/common/CaliperMetadataAccessInterface.h"
@@ -17,6 +18,7 @@ struct QueryProcessor::QueryProcessorImpl {
     Preprocessor    preprocessor;
     RecordSelector  filter;
     FormatProcessor formatter;
+    RecordLimiter   limiter;
 
     bool do_aggregate;
 
@@ -27,6 +29,8 @@ struct QueryProcessor::QueryProcessorImpl {
 
             if (do_aggregate)
                 aggregator.add(db, rec);
+            else if (limiter.is_active())
+                limiter.add(db, rec);
             else
                 formatter.process_record(db, rec);
         }
@@ -34,12 +38,18 @@ struct QueryProcessor::QueryProcessorImpl {
 
     void flush(CaliperMetadataAccessInterface& db)
     {
-        aggregator.flush(db, formatter);
+        if (limiter.is_active()) {
+            aggregator.flush(db, limiter);
+            limiter.flush(db, formatter);
+        } else {
+            aggregator.flush(db, formatter);
+        }
+
         formatter.flush(db);
     }
 
     QueryProcessorImpl(const QuerySpec& spec, OutputStream& stream)
-        : aggregator(spec), preprocessor(spec), filter(spec), formatter(spec, stream)
+        : aggregator(spec), preprocessor(spec), filter(spec), formatter(spec, stream), limiter(spec)
     {
         do_aggregate = (spec.aggregate.selection != QuerySpec::AggregationSelection::None);
     }
@@ -0,0 +1,145 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+// RecordLimiter implementation
+
+#include "caliper/reader/RecordLimiter.h"
+
+#include "caliper/common/Attribute.h"
+#include "caliper/common/CaliperMetadataAccessInterface.h"
+
+#include <algorithm>
+#include <mutex>
+
+using namespace cali;
+
+struct RecordLimiter::RecordLimiterImpl {
+    struct HeapItem {
+        std::vector<Variant> sort_values;
+        std::size_t          seq;
+        EntryList            rec;
+    };
+
+    std::size_t                      m_limit;
+    std::vector<QuerySpec::SortSpec> m_sort_specs;
+    std::vector<Attribute>           m_sort_attrs;
+
+    // max-heap w.r.t. output order: the front element is the one to be
+    // evicted next
+    std::vector<HeapItem> m_heap;
+    std::size_t           m_seq;
+    std::mutex            m_lock;
+
+    // Returns true if lhs comes before rhs in the output. Records without
+    // a value for a sort attribute go last; ties keep input order.
+    bool before(const HeapItem& lhs, const HeapItem& rhs) const
+    {
+        for (std::size_t i = 0; i < m_sort_specs.size(); ++i) {
+            const Variant& l = lhs.sort_values[i];
+            const Variant& r = rhs.sort_values[i];
+
+            if (l.empty() != r.empty())
+                return r.empty();
+            if (l == r)
+                continue;
+
+            if (m_sort_specs[i].order == QuerySpec::SortSpec::Descending)
+                return l > r;
+            else
+                return l < r;
+        }
+
+        return lhs.seq < rhs.seq;
+    }
+
+    void update_sort_attributes(CaliperMetadataAccessInterface& db)
+    {
+        for (std::size_t i = 0; i < m_sort_specs.size(); ++i)
+            if (!m_sort_attrs[i])
+                m_sort_attrs[i] = db.get_attribute(m_sort_specs[i].attribute);
+    }
+
+    void add(CaliperMetadataAccessInterface& db, const EntryList& rec)
+    {
+        std::lock_guard<std::mutex> g(m_lock);
+
+        update_sort_attributes(db);
+
+        HeapItem item;
+        item.seq = m_seq++;
+        item.sort_values.reserve(m_sort_attrs.size());
+
+        for (const Attribute& attr : m_sort_attrs) {
+            Variant v;
+
+            if (attr)
+                for (const Entry& e : rec) {
+                    v = e.value(attr);
+                    if (!v.empty())
+                        break;
+                }
+
+            item.sort_values.push_back(v);
+        }
+
+        auto cmp = [this](const HeapItem& lhs, const HeapItem& rhs) {
+            return before(lhs, rhs);
+        };
+
+        if (m_heap.size() < m_limit) {
+            item.rec = rec;
+            m_heap.push_back(std::move(item));
+            std::push_heap(m_heap.begin(), m_heap.end(), cmp);
+        } else if (!m_heap.empty() && before(item, m_heap.front())) {
+            item.rec = rec;
+            std::pop_heap(m_heap.begin(), m_heap.end(), cmp);
+            m_heap.back() = std::move(item);
+            std::push_heap(m_heap.begin(), m_heap.end(), cmp);
+        }
+    }
+
+    void flush(CaliperMetadataAccessInterface& db, SnapshotProcessFn push)
+    {
+        std::sort_heap(m_heap.begin(), m_heap.end(), [this](const HeapItem& lhs, const HeapItem& rhs) {
+            return before(lhs, rhs);
+        });
+
+        for (const HeapItem& item : m_heap)
+            push(db, item.rec);
+
+        m_heap.clear();
+        m_seq = 0;
+    }
+
+    RecordLimiterImpl(const QuerySpec& spec) : m_limit(spec.limit), m_seq(0)
+    {
+        if (spec.sort.selection == QuerySpec::SortSelection::List)
+            m_sort_specs = spec.sort.list;
+
+        m_sort_attrs.assign(m_sort_specs.size(), Attribute());
+        m_heap.reserve(std::min<std::size_t>(m_limit, 4096));
+    }
+};
+
+RecordLimiter::RecordLimiter(const QuerySpec& spec) : mP { new RecordLimiterImpl(spec) }
+{}
+
+RecordLimiter::~RecordLimiter()
+{
+    mP.reset();
+}
+
+bool RecordLimiter::is_active() const
+{
+    return mP->m_limit > 0;
+}
+
+void RecordLimiter::add(CaliperMetadataAccessInterface& db, const EntryList& list)
+{
+    mP->add(db, list);
+}
+
+void RecordLimiter::flush(CaliperMetadataAccessInterface& db, SnapshotProcessFn push)
+{
+    mP->flush(db, push);
+}
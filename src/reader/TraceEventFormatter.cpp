@@ -0,0 +1,490 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+// Write trace records as Google TraceEvent JSON
+
+#include "TraceEventFormatter.h"
+
+#include "caliper/reader/QuerySpec.h"
+
+#include "caliper/common/Attribute.h"
+#include "caliper/common/CaliperMetadataAccessInterface.h"
+#include "caliper/common/Node.h"
+#include "caliper/common/OutputStream.h"
+
+#include "../common/util/format_util.h"
+#include "../common/util/split.hpp"
+
+#include <atomic>
+#include <climits>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace cali;
+
+namespace
+{
+
+// Buffered event data per stream is written out once it exceeds this size
+const std::size_t stream_buffer_limit = 64 * 1024;
+
+enum AttrRole { None, Timestamp, Pid, Tid, EventBegin, EventEnd, ActivityKind, ActivityStart, ActivityDuration, KernelName };
+
+struct AttrInfo {
+    AttrRole    role;
+    int         prio;   // for Timestamp, Pid, Tid: lower value wins
+    uint64_t    factor; // for Timestamp: conversion factor to nanoseconds
+    std::string label;  // for EventBegin/EventEnd: event category; for ActivityKind: tid label
+};
+
+const struct BuiltinAttr {
+    const char* name;
+    AttrRole    role;
+    uint64_t    factor;
+    const char* label;
+} builtin_attrs[] = { { "cupti.timestamp", Timestamp, 1, nullptr },
+                      { "rocm.host.timestamp", Timestamp, 1, nullptr },
+                      { "time.offset.ns", Timestamp, 1, nullptr },
+                      { "time.offset", Timestamp, 1000, nullptr },
+                      { "gputrace.timestamp", Timestamp, 1, nullptr },
+                      { "cupti.activity.kind", ActivityKind, 1, "cuda" },
+                      { "rocm.activity", ActivityKind, 1, "rocm" },
+                      { "cupti.activity.start", ActivityStart, 1, nullptr },
+                      { "rocm.starttime", ActivityStart, 1, nullptr },
+                      { "cupti.activity.duration", ActivityDuration, 1, nullptr },
+                      { "rocm.activity.duration", ActivityDuration, 1, nullptr },
+                      { "cupti.kernel.name", KernelName, 1, nullptr },
+                      { "rocm.kernel.name", KernelName, 1, nullptr } };
+
+/// \brief Append string \a str to \a buf, escaping JSON special characters
+void append_json_esc_string(std::string& buf, const std::string& str)
+{
+    for (char c : str) {
+        if (c == '\n') {
+            buf.append("\\n");
+            continue;
+        }
+        if (c < 0x20)
+            continue;
+        if (c == '\\' || c == '\"')
+            buf.push_back('\\');
+
+        buf.push_back(c);
+    }
+}
+
+/// \brief Append nanosecond value \a ns as microseconds with three decimals
+void append_usec(std::string& buf, int64_t ns)
+{
+    if (ns < 0) {
+        buf.push_back('-');
+        ns = -ns;
+    }
+
+    util::append_int64(buf, ns / 1000);
+
+    int64_t frac = ns % 1000;
+    char    tmp[4] = { '.', static_cast<char>('0' + frac / 100), static_cast<char>('0' + (frac / 10) % 10),
+                       static_cast<char>('0' + frac % 10) };
+
+    buf.append(tmp, 4);
+}
+
+} // namespace
+
+struct TraceEventFormatter::TraceEventFormatterImpl {
+    OutputStream m_os;
+
+    std::vector<std::string> m_pid_attributes;
+    std::vector<std::string> m_tid_attributes;
+
+    /// \brief Event data for one trace stream (process and thread)
+    struct Stream {
+        std::string                                  pid_json;
+        std::string                                  tid_json;
+        std::map<std::string, std::vector<int64_t>> stacks;
+        std::string                                  buf;
+    };
+
+    typedef std::pair<int64_t, std::string> StreamKey;
+
+    /// \brief Attribute info cache and trace streams of one input reader
+    ///   thread
+    ///
+    /// Only the reader thread that owns it uses this, so records are
+    /// processed without locking.
+    struct ThreadData {
+        std::map<cali_id_t, AttrInfo> attr_info;
+        std::map<StreamKey, Stream>   streams;
+    };
+
+    std::map<std::thread::id, ThreadData> m_threads;
+    std::mutex                            m_threads_lock;
+
+    // distinguishes formatter instances in the thread-local cache
+    uint64_t m_instance_id;
+
+    std::mutex m_os_lock;
+    bool       m_began_output = false;
+
+    struct RecordData {
+        int64_t ts      = 0;
+        int     ts_prio = INT_MAX;
+
+        int64_t pid      = 0;
+        int     pid_prio = INT_MAX;
+        int64_t tid      = 0;
+        int     tid_prio = INT_MAX;
+
+        std::vector<const AttrInfo*>                     begin_events;
+        std::vector<std::pair<const AttrInfo*, Variant>> end_events;
+
+        const AttrInfo* activity = nullptr;
+        Variant         activity_kind;
+        Variant         activity_start;
+        Variant         activity_duration;
+        Variant         kernel_name;
+    };
+
+    TraceEventFormatterImpl(OutputStream& os) : m_os(os)
+    {
+        static std::atomic<uint64_t> s_instance_count { 0 };
+        m_instance_id = ++s_instance_count;
+    }
+
+    ThreadData& get_thread_data()
+    {
+        thread_local std::pair<uint64_t, ThreadData*> tl_cache { 0, nullptr };
+
+        if (tl_cache.first == m_instance_id)
+            return *tl_cache.second;
+
+        std::lock_guard<std::mutex> g(m_threads_lock);
+
+        // std::map elements don't move, so we can keep the pointer
+        ThreadData* td = &m_threads[std::this_thread::get_id()];
+        tl_cache       = std::make_pair(m_instance_id, td);
+
+        return *td;
+    }
+
+    void configure(const QuerySpec& spec)
+    {
+        auto it = spec.format.kwargs.find("pid-attributes");
+        if (it != spec.format.kwargs.end())
+            util::split(it->second, ':', std::back_inserter(m_pid_attributes));
+
+        it = spec.format.kwargs.find("tid-attributes");
+        if (it != spec.format.kwargs.end())
+            util::split(it->second, ':', std::back_inserter(m_tid_attributes));
+
+        m_pid_attributes.push_back("mpi.rank");
+        m_tid_attributes.push_back("omp.thread.id");
+        m_tid_attributes.push_back("pthread.id");
+    }
+
+    AttrInfo make_attr_info(const Attribute& attr) const
+    {
+        AttrInfo info { None, 0, 1, std::string() };
+
+        if (!attr)
+            return info;
+
+        std::string name = attr.name();
+
+        if (name.compare(0, 12, "event.begin#") == 0) {
+            info.role  = EventBegin;
+            info.label = name.substr(12);
+            return info;
+        }
+        if (name.compare(0, 10, "event.end#") == 0) {
+            info.role  = EventEnd;
+            info.label = name.substr(10);
+            return info;
+        }
+
+        int prio = 0;
+        for (const BuiltinAttr& b : builtin_attrs) {
+            if (name == b.name) {
+                info.role   = b.role;
+                info.prio   = prio;
+                info.factor = b.factor;
+                if (b.label)
+                    info.label = b.label;
+                return info;
+            }
+            ++prio;
+        }
+
+        for (std::size_t i = 0; i < m_pid_attributes.size(); ++i)
+            if (name == m_pid_attributes[i]) {
+                info.role = Pid;
+                info.prio = static_cast<int>(i);
+                return info;
+            }
+        for (std::size_t i = 0; i < m_tid_attributes.size(); ++i)
+            if (name == m_tid_attributes[i]) {
+                info.role = Tid;
+                info.prio = static_cast<int>(i);
+                return info;
+            }
+
+        return info;
+    }
+
+    const AttrInfo& get_attr_info(ThreadData& td, CaliperMetadataAccessInterface& db, cali_id_t attr_id)
+    {
+        auto it = td.attr_info.find(attr_id);
+
+        if (it == td.attr_info.end())
+            it = td.attr_info.emplace(attr_id, make_attr_info(db.get_attribute(attr_id))).first;
+
+        return it->second;
+    }
+
+    void add_value(const AttrInfo& info, const Variant& val, RecordData& data)
+    {
+        switch (info.role) {
+        case None:
+            break;
+        case Timestamp:
+            if (info.prio < data.ts_prio) {
+                data.ts      = static_cast<int64_t>(val.to_uint() * info.factor);
+                data.ts_prio = info.prio;
+            }
+            break;
+        case Pid:
+            if (info.prio < data.pid_prio) {
+                data.pid      = val.to_int64();
+                data.pid_prio = info.prio;
+            }
+            break;
+        case Tid:
+            if (info.prio < data.tid_prio) {
+                data.tid      = val.to_int64();
+                data.tid_prio = info.prio;
+            }
+            break;
+        case EventBegin:
+            data.begin_events.push_back(&info);
+            break;
+        case EventEnd:
+            data.end_events.push_back(std::make_pair(&info, val));
+            break;
+        case ActivityKind:
+            data.activity      = &info;
+            data.activity_kind = val;
+            break;
+        case ActivityStart:
+            data.activity_start = val;
+            break;
+        case ActivityDuration:
+            data.activity_duration = val;
+            break;
+        case KernelName:
+            data.kernel_name = val;
+            break;
+        }
+    }
+
+    void unpack_record(ThreadData& td, CaliperMetadataAccessInterface& db, const EntryList& rec, RecordData& data)
+    {
+        for (const Entry& e : rec) {
+            if (e.is_reference()) {
+                for (const Node* node = e.node(); node && node->id() != CALI_INV_ID; node = node->parent())
+                    add_value(get_attr_info(td, db, node->attribute()), node->data(), data);
+            } else if (e.is_immediate()) {
+                add_value(get_attr_info(td, db, e.attribute()), e.value(), data);
+            }
+        }
+    }
+
+    Stream& get_stream(ThreadData& td, int64_t pid, int64_t tid, const std::string& tid_label)
+    {
+        StreamKey key(pid, tid_label);
+
+        if (tid_label.empty())
+            util::append_int64(key.second, tid);
+
+        auto it = td.streams.find(key);
+
+        if (it == td.streams.end()) {
+            it = td.streams.emplace(key, Stream()).first;
+
+            util::append_int64(it->second.pid_json, pid);
+
+            if (tid_label.empty())
+                util::append_int64(it->second.tid_json, tid);
+            else
+                it->second.tid_json.append("\"").append(tid_label).append("\"");
+
+            it->second.buf.reserve(stream_buffer_limit + 512);
+        }
+
+        return it->second;
+    }
+
+    void write_buffer(std::string& buf)
+    {
+        if (buf.empty())
+            return;
+
+        std::lock_guard<std::mutex> g(m_os_lock);
+
+        std::ostream* real_os = m_os.stream();
+
+        // all events in the buffer are prefixed with ",\n"
+        if (!m_began_output) {
+            *real_os << "{\"traceEvents\": [\n";
+            real_os->write(buf.data() + 2, buf.size() - 2);
+            m_began_output = true;
+        } else {
+            real_os->write(buf.data(), buf.size());
+        }
+
+        buf.clear();
+    }
+
+    void append_event(
+        Stream&            stream,
+        const std::string& name,
+        const std::string& cat,
+        int64_t            ts,
+        int64_t            dur
+    )
+    {
+        std::string& buf = stream.buf;
+
+        buf.append(",\n{\"name\":\"");
+        append_json_esc_string(buf, name);
+        buf.append("\",\"cat\":\"");
+        append_json_esc_string(buf, cat);
+        buf.append("\",\"ph\":\"X\",\"pid\":");
+        buf.append(stream.pid_json);
+        buf.append(",\"tid\":");
+        buf.append(stream.tid_json);
+        buf.append(",\"ts\":");
+        append_usec(buf, ts);
+        buf.append(",\"dur\":");
+        append_usec(buf, dur);
+        buf.push_back('}');
+
+        if (buf.size() > stream_buffer_limit)
+            write_buffer(buf);
+    }
+
+    void process_record(CaliperMetadataAccessInterface& db, const EntryList& rec)
+    {
+        ThreadData& td = get_thread_data();
+
+        RecordData data;
+        unpack_record(td, db, rec, data);
+
+        if (data.activity) {
+            std::string cat    = data.activity_kind.to_string();
+            Stream&     stream = get_stream(td, data.pid, 0, data.activity->label);
+
+            append_event(
+                stream,
+                data.kernel_name.empty() ? cat : data.kernel_name.to_string(),
+                cat,
+                static_cast<int64_t>(data.activity_start.to_uint()),
+                static_cast<int64_t>(data.activity_duration.to_uint())
+            );
+
+            return;
+        }
+
+        if ((data.begin_events.empty() && data.end_events.empty()) || data.ts_prio == INT_MAX)
+            return;
+
+        Stream& stream = get_stream(td, data.pid, data.tid, std::string());
+
+        for (const auto& p : data.end_events) {
+            std::vector<int64_t>& stack = stream.stacks[p.first->label];
+
+            if (stack.empty()) // skip end events without matching begin
+                continue;
+
+            int64_t begin_ts = stack.back();
+            stack.pop_back();
+
+            append_event(stream, p.second.to_string(), p.first->label, begin_ts, data.ts - begin_ts);
+        }
+
+        for (const AttrInfo* info : data.begin_events)
+            stream.stacks[info->label].push_back(data.ts);
+    }
+
+    std::ostream& write_globals(CaliperMetadataAccessInterface& db, std::ostream& os)
+    {
+        std::vector<Entry>               globals = db.get_globals();
+        std::map<cali_id_t, std::string> global_vals;
+
+        for (const Entry& e : globals)
+            if (e.is_reference())
+                for (const Node* node = e.node(); node && node->id() != CALI_INV_ID; node = node->parent()) {
+                    std::string s = node->data().to_string();
+
+                    if (global_vals[node->attribute()].size() > 0)
+                        s.append("/").append(global_vals[node->attribute()]);
+
+                    global_vals[node->attribute()] = s;
+                }
+            else
+                global_vals[e.attribute()] = e.value().to_string();
+
+        int count = 0;
+        for (auto& p : global_vals) {
+            if (count++ > 0)
+                os << ",\n";
+
+            util::write_json_esc_string(os << '\"', db.get_attribute(p.first).name()) << "\": ";
+            util::write_json_esc_string(os << '\"', p.second) << '\"';
+        }
+
+        return os;
+    }
+
+    void flush(CaliperMetadataAccessInterface& db)
+    {
+        {
+            std::lock_guard<std::mutex> g(m_threads_lock);
+
+            for (auto& t : m_threads)
+                for (auto& p : t.second.streams)
+                    write_buffer(p.second.buf);
+        }
+
+        std::ostream* real_os = m_os.stream();
+
+        if (!m_began_output)
+            *real_os << "{\"traceEvents\": [";
+
+        write_globals(db, *real_os << "\n],\n\"otherData\": {\n") << "\n}\n}" << std::endl;
+    }
+};
+
+TraceEventFormatter::TraceEventFormatter(OutputStream& os, const QuerySpec& spec)
+    : mP { new TraceEventFormatterImpl(os) }
+{
+    mP->configure(spec);
+}
+
+TraceEventFormatter::~TraceEventFormatter()
+{
+    mP.reset();
+}
+
+void TraceEventFormatter::process_record(CaliperMetadataAccessInterface& db, const EntryList& list)
+{
+    mP->process_record(db, list);
+}
+
+void TraceEventFormatter::flush(CaliperMetadataAccessInterface& db, std::ostream&)
+{
+    mP->flush(db);
+}
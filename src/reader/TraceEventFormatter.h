@@ -0,0 +1,43 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+/// \file TraceEventFormatter.h
+/// Google TraceEvent output formatter
+
+#pragma once
+
+#include "Formatter.h"
+
+#include <memory>
+
+namespace cali
+{
+
+class CaliperMetadataAccessInterface;
+class OutputStream;
+struct QuerySpec;
+
+/// \brief Converts trace records into Google TraceEvent JSON
+/// \ingroup ReaderAPI
+///
+/// Matches begin and end events in the input trace records and writes
+/// complete ("X") events. Events are encoded into per-thread buffers
+/// and streamed to the output, so memory use does not depend on the
+/// trace size.
+class TraceEventFormatter : public Formatter
+{
+    struct TraceEventFormatterImpl;
+    std::shared_ptr<TraceEventFormatterImpl> mP;
+
+public:
+
+    TraceEventFormatter(OutputStream& os, const QuerySpec& spec);
+
+    ~TraceEventFormatter();
+
+    void process_record(CaliperMetadataAccessInterface&, const EntryList&);
+
+    void flush(CaliperMetadataAccessInterface&, std::ostream&);
+};
+
+} // namespace cali
@@ -236,6 +236,26 @@ TEST(CalQLParserTest, OrderByClause3)
     EXPECT_STREQ(q.format.formatter.name, "table");
 }
 
+TEST(CalQLParserTest, LimitClause)
+{
+    CalQLParser p("select * order by time desc limit 20 format table");
+
+    EXPECT_FALSE(p.error()) << "Unexpected parse error: " << p.error_msg();
+
+    QuerySpec q = p.spec();
+
+    EXPECT_EQ(q.limit, 20u);
+    ASSERT_EQ(q.sort.list.size(), 1);
+    EXPECT_EQ(q.sort.list[0].attribute, "time");
+    EXPECT_EQ(q.format.opt, QuerySpec::FormatSpec::User);
+
+    EXPECT_EQ(CalQLParser("select *").spec().limit, 0u);
+
+    EXPECT_TRUE(CalQLParser("select * limit").error());
+    EXPECT_TRUE(CalQLParser("select * limit 0").error());
+    EXPECT_TRUE(CalQLParser("select * limit foo").error());
+}
+
 TEST(CalQLParserTest, FormatSpec)
 {
     {
@@ -0,0 +1,85 @@
+#include "caliper/reader/RecordLimiter.h"
+
+#include "caliper/reader/CaliperMetadataDB.h"
+#include "caliper/reader/CalQLParser.h"
+
+#include "caliper/common/Node.h"
+
+#include <gtest/gtest.h>
+
+using namespace cali;
+
+namespace
+{
+
+std::vector<int> run_limiter(const char* query, const std::vector<int>& input)
+{
+    CaliperMetadataDB db;
+    IdMap             idmap;
+
+    Attribute val_attr = db.create_attribute("val", CALI_TYPE_INT, CALI_ATTR_ASVALUE);
+    cali_id_t val_id   = val_attr.id();
+
+    CalQLParser p(query);
+    EXPECT_FALSE(p.error()) << p.error_msg();
+
+    RecordLimiter limiter(p.spec());
+    EXPECT_TRUE(limiter.is_active());
+
+    for (int i : input) {
+        Variant v_val(i);
+        limiter.add(db, db.merge_snapshot(0, nullptr, 1, &val_id, &v_val, idmap));
+    }
+
+    std::vector<int> output;
+
+    limiter.flush(db, [&output, val_attr](CaliperMetadataAccessInterface&, const EntryList& rec) {
+        for (const Entry& e : rec)
+            if (e.attribute() == val_attr.id())
+                output.push_back(e.value().to_int());
+    });
+
+    return output;
+}
+
+} // namespace
+
+TEST(RecordLimiterTest, TopKDescending)
+{
+    std::vector<int> res = run_limiter("order by val desc limit 3", { 4, 8, 1, 9, 3, 8, 7 });
+
+    ASSERT_EQ(res.size(), 3);
+    EXPECT_EQ(res[0], 9);
+    EXPECT_EQ(res[1], 8);
+    EXPECT_EQ(res[2], 8);
+}
+
+TEST(RecordLimiterTest, TopKAscending)
+{
+    std::vector<int> res = run_limiter("order by val limit 2", { 4, 8, 1, 9, 3 });
+
+    ASSERT_EQ(res.size(), 2);
+    EXPECT_EQ(res[0], 1);
+    EXPECT_EQ(res[1], 3);
+}
+
+TEST(RecordLimiterTest, FirstN)
+{
+    std::vector<int> res = run_limiter("limit 2", { 4, 8, 1 });
+
+    ASSERT_EQ(res.size(), 2);
+    EXPECT_EQ(res[0], 4);
+    EXPECT_EQ(res[1], 8);
+
+    res = run_limiter("limit 5", { 4, 8 });
+
+    ASSERT_EQ(res.size(), 2);
+}
+
+TEST(RecordLimiterTest, Inactive)
+{
+    QuerySpec     spec;
+    RecordLimiter limiter(spec);
+
+    EXPECT_FALSE(limiter.is_active());
+}
@@ -0,0 +1,67 @@
+#include "../TraceEventFormatter.h"
+
+#include "caliper/reader/CaliperMetadataDB.h"
+#include "caliper/reader/CalQLParser.h"
+
+#include "caliper/common/OutputStream.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace cali;
+
+TEST(TraceEventFormatter, BeginEndEvents)
+{
+    CaliperMetadataDB db;
+
+    Attribute begin_attr = db.create_attribute("event.begin#region", CALI_TYPE_STRING, CALI_ATTR_ASVALUE);
+    Attribute end_attr   = db.create_attribute("event.end#region", CALI_TYPE_STRING, CALI_ATTR_ASVALUE);
+    Attribute ts_attr    = db.create_attribute("time.offset.ns", CALI_TYPE_UINT, CALI_ATTR_ASVALUE);
+    Attribute tid_attr   = db.create_attribute("mythread", CALI_TYPE_INT, CALI_ATTR_ASVALUE);
+
+    CalQLParser p("format traceevent(tid-attributes=mythread)");
+    ASSERT_FALSE(p.error()) << p.error_msg();
+
+    std::ostringstream os;
+    OutputStream       stream;
+    stream.set_stream(&os);
+
+    TraceEventFormatter formatter(stream, p.spec());
+
+    auto add = [&](const Attribute& attr, const char* name, uint64_t ts, int tid) {
+        std::vector<Entry> rec;
+        rec.push_back(Entry(attr, Variant(name)));
+        rec.push_back(Entry(ts_attr, Variant(ts)));
+        rec.push_back(Entry(tid_attr, Variant(tid)));
+        formatter.process_record(db, rec);
+    };
+
+    add(begin_attr, "outer", 1000, 1);
+    add(begin_attr, "inner", 2500, 1);
+    add(begin_attr, "other", 3000, 2);
+    add(end_attr, "inner", 4000, 1);
+    add(end_attr, "outer", 12345, 1);
+    add(end_attr, "other", 3500, 2);
+    add(end_attr, "unmatched", 5000, 2);
+
+    formatter.flush(db, os);
+
+    std::string res = os.str();
+
+    EXPECT_NE(
+        res.find("{\"name\":\"inner\",\"cat\":\"region\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":2.500,\"dur\":1.500}"),
+        std::string::npos
+    ) << res;
+    EXPECT_NE(
+        res.find("{\"name\":\"outer\",\"cat\":\"region\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":1.000,\"dur\":11.345}"),
+        std::string::npos
+    ) << res;
+    EXPECT_NE(
+        res.find("{\"name\":\"other\",\"cat\":\"region\",\"ph\":\"X\",\"pid\":0,\"tid\":2,\"ts\":3.000,\"dur\":0.500}"),
+        std::string::npos
+    ) << res;
+    EXPECT_EQ(res.find("unmatched"), std::string::npos) << res;
+    EXPECT_EQ(res.find("{\"traceEvents\": [\n{"), 0) << res;
+    EXPECT_NE(res.find("\"otherData\": {"), std::string::npos) << res;
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+// BackgroundSampler class implementation
+
+#include "BackgroundSampler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace cali;
+
+struct BackgroundSampler::BackgroundSamplerImpl {
+    std::size_t               num_values;
+    std::chrono::milliseconds interval;
+    SampleFn                  sample_fn;
+
+    //   Seqlock-protected value cache. The sequence counter is odd while
+    // the sampler thread updates the values. Values are relaxed atomics
+    // so concurrent reads are well-defined.
+    std::atomic<unsigned>                    seq;
+    std::unique_ptr<std::atomic<uint64_t>[]> values;
+    std::atomic<bool>                        valid;
+
+    std::vector<uint64_t> tmp;
+
+    std::atomic<std::size_t> num_failed;
+
+    std::thread             thread;
+    std::mutex              mtx;
+    std::condition_variable cv;
+    bool                    running;
+
+    void sample()
+    {
+        if (!sample_fn(tmp.data())) {
+            ++num_failed;
+            return;
+        }
+
+        unsigned s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t i = 0; i < num_values; ++i)
+            values[i].store(tmp[i], std::memory_order_relaxed);
+
+        seq.store(s + 2, std::memory_order_release);
+        valid.store(true, std::memory_order_release);
+    }
+
+    bool read(uint64_t* out) const
+    {
+        if (!valid.load(std::memory_order_acquire))
+            return false;
+
+        unsigned s1, s2;
+
+        do {
+            s1 = seq.load(std::memory_order_acquire);
+
+            for (std::size_t i = 0; i < num_values; ++i)
+                out[i] = values[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s2 = seq.load(std::memory_order_relaxed);
+        } while ((s1 & 1) || s1 != s2);
+
+        return true;
+    }
+
+    void thread_loop()
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+
+        while (running) {
+            if (cv.wait_for(lk, interval, [this]() { return !running; }))
+                break;
+
+            lk.unlock();
+            sample();
+            lk.lock();
+        }
+    }
+
+    void start()
+    {
+        std::lock_guard<std::mutex> g(mtx);
+
+        if (running)
+            return;
+
+        sample();
+
+        running = true;
+        thread  = std::thread(&BackgroundSamplerImpl::thread_loop, this);
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> g(mtx);
+
+            if (!running)
+                return;
+
+            running = false;
+        }
+
+        cv.notify_all();
+        thread.join();
+    }
+
+    BackgroundSamplerImpl(std::size_t n, unsigned interval_ms, SampleFn fn)
+        : num_values(n),
+          interval(interval_ms),
+          sample_fn(fn),
+          seq(0),
+          values(new std::atomic<uint64_t>[n]),
+          valid(false),
+          tmp(n, 0),
+          num_failed(0),
+          running(false)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            values[i].store(0, std::memory_order_relaxed);
+    }
+};
+
+BackgroundSampler::BackgroundSampler(std::size_t num_values, unsigned interval_ms, SampleFn fn)
+    : mP(new BackgroundSamplerImpl(num_values, interval_ms, fn))
+{}
+
+BackgroundSampler::~BackgroundSampler()
+{
+    mP->stop();
+}
+
+void BackgroundSampler::start()
+{
+    mP->start();
+}
+
+void BackgroundSampler::stop()
+{
+    mP->stop();
+}
+
+bool BackgroundSampler::read(uint64_t* values) const
+{
+    return mP->read(values);
+}
+
+std::size_t BackgroundSampler::num_failed() const
+{
+    return mP->num_failed.load();
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+/// \file BackgroundSampler.h
+/// BackgroundSampler class declaration
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace cali
+{
+
+/// \brief Periodically refreshes a set of metric values on a background thread
+///
+/// For metric providers that are expensive to read (e.g., files in /proc or
+/// sysfs). A background thread calls the sample function at a fixed rate and
+/// stores the values in a seqlock-protected cache. Snapshot callbacks read
+/// the cached values with read(), which does not block and performs no
+/// system calls, so it is safe to use in signal handlers.
+class BackgroundSampler
+{
+    struct BackgroundSamplerImpl;
+    std::unique_ptr<BackgroundSamplerImpl> mP;
+
+public:
+
+    /// \brief Reads the current metric values into the given array. Returns
+    ///   \c false if the values could not be read.
+    typedef std::function<bool(uint64_t*)> SampleFn;
+
+    /// \brief Create a sampler for \a num_values metric values that calls
+    ///   \a fn every \a interval_ms milliseconds.
+    BackgroundSampler(std::size_t num_values, unsigned interval_ms, SampleFn fn);
+
+    /// \brief Stops the background thread
+    ~BackgroundSampler();
+
+    /// \brief Take an initial sample and start the background thread.
+    void start();
+    /// \brief Stop the background thread.
+    void stop();
+
+    /// \brief Copy the most recent values into \a values.
+    ///
+    /// \return \c false if no valid sample is available yet.
+    bool read(uint64_t* values) const;
+
+    /// \brief Number of failed sample function calls
+    std::size_t num_failed() const;
+};
+
+} // namespace cali
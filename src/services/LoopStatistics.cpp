@@ -11,7 +11,8 @@
 #include "caliper/common/Log.h"
 #include "caliper/common/RuntimeConfig.h"
 
-#include <chrono>
+#include "../common/util/clock.h"
+
 #include <vector>
 
 using namespace cali;
@@ -29,13 +30,13 @@ namespace
 
 class LoopStatisticsService
 {
-    using clock = std::chrono::steady_clock;
-
     struct LoopInfo {
-        clock::time_point iter_start_time;
-        uint64_t          num_iterations;
+        uint64_t iter_start_time;
+        uint64_t num_iterations;
     };
 
+    const cali::util::Clock& m_clock;
+
     std::vector<LoopInfo> m_loop_info;
 
     Attribute m_iter_duration_attr;
@@ -44,9 +45,9 @@ class LoopStatisticsService
     void begin_cb(Caliper* c, Channel* channel, const Attribute& attr, const Variant& data)
     {
         if (attr == loop_attr) {
-            m_loop_info.emplace_back(LoopInfo { clock::now(), 0 });
+            m_loop_info.emplace_back(LoopInfo { m_clock.now(), 0 });
         } else if (attr.get(class_iteration_attr).to_bool() && !m_loop_info.empty()) {
-            m_loop_info.back().iter_start_time = clock::now();
+            m_loop_info.back().iter_start_time = m_clock.now();
             m_loop_info.back().num_iterations++;
         }
     }
@@ -60,15 +61,13 @@ class LoopStatisticsService
             c->push_snapshot(channel, SnapshotView(e));
             m_loop_info.pop_back();
         } else if (attr.get(class_iteration_attr).to_bool()) {
-            uint64_t t =
-                std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_loop_info.back().iter_start_time)
-                    .count();
+            uint64_t t = m_clock.to_nsec(m_clock.now() - m_loop_info.back().iter_start_time);
             Entry e { m_iter_duration_attr, Variant(t) };
             c->push_snapshot(channel, SnapshotView(e));
         }
     }
 
-    LoopStatisticsService(Caliper* c, Channel* channel)
+    LoopStatisticsService(Caliper* c, Channel* channel) : m_clock(cali::util::Clock::get())
     {
         m_iter_duration_attr = c->create_attribute(
             "iter.duration.ns",
@@ -10,6 +10,8 @@
 
 #include "caliper/common/Log.h"
 
+#include "../common/util/parse_util.h"
+
 #include <cassert>
 #include <cctype>
 #include <string>
@@ -25,6 +27,13 @@ namespace
 
 std::string get_name_from_spec(const char* name_or_spec)
 {
+    //   Service specs are only fully parsed when the service is used. Try a
+    // quick scan for the name first.
+    std::string name;
+
+    if (util::find_json_toplevel_string(name_or_spec, "name", name))
+        return name;
+
     // try to parse the given string as spec, otherwise return it as-is
     bool ok   = false;
     auto dict = StringConverter(name_or_spec).rec_dict(&ok);
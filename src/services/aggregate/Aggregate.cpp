@@ -19,9 +19,12 @@
 #include "caliper/common/Variant.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <sstream>
+#include <thread>
 
 using namespace aggregate;
 using namespace cali;
@@ -40,22 +43,33 @@ class Aggregate
     // --- Class for the per-thread aggregation database
     //
 
-    //   ThreadDB manages an aggregation DB for one thread.
+    //   ThreadDB manages the aggregation DBs for one thread.
     // All ThreadDBs belonging to a channel are linked so they
     // can be flushed, cleared, and deleted from any thread.
+    //
+    //   The thread records snapshots into the active DB. A flush swaps
+    // the active and spare DBs, merges the swapped-out DB into the
+    // "flushed" DB that holds all data flushed so far, and writes out
+    // the merged DB. This way, the application thread never has to
+    // stop recording while a flush is in progress.
 
     struct ThreadDB {
         //
         // --- members
         //
 
-        std::atomic<bool> stopped;
+        std::atomic<bool> writing;
         std::atomic<bool> retired;
 
         ThreadDB* next = nullptr;
         ThreadDB* prev = nullptr;
 
-        AggregationDB db;
+        AggregationDB db_a;
+        AggregationDB db_b;
+        AggregationDB flushed;
+
+        std::atomic<AggregationDB*> active;
+        AggregationDB*              spare;
 
         void unlink()
         {
@@ -65,7 +79,36 @@ class Aggregate
                 prev->next = next;
         }
 
-        ThreadDB(Caliper* c) : stopped(false), retired(false), db(c) {}
+        void process_snapshot(Caliper* c, SnapshotView rec, const AttributeInfo& info)
+        {
+            writing.store(true);
+            active.load()->process_snapshot(c, rec, info);
+            writing.store(false);
+        }
+
+        /// \brief Make the spare DB the active one and return the previously
+        ///   active DB once the owning thread has stopped writing to it.
+        ///   Must only be called by one thread at a time.
+        AggregationDB* swap_active()
+        {
+            AggregationDB* prev = active.exchange(spare);
+
+            while (writing.load())
+                ;
+
+            spare = prev;
+            return prev;
+        }
+
+        ThreadDB(Caliper* c)
+            : writing(false),
+              retired(false),
+              db_a(c),
+              db_b(c),
+              flushed(c, false),
+              active(&db_a),
+              spare(&db_b)
+        {}
     };
 
     ConfigSet config;
@@ -73,6 +116,8 @@ class Aggregate
     ThreadDB*      tdb_list = nullptr;
     util::spinlock tdb_lock;
 
+    std::mutex flush_mutex;
+
     AttributeInfo            info;
     std::vector<std::string> key_attribute_names;
     std::vector<std::string> aggr_attribute_names;
@@ -81,6 +126,10 @@ class Aggregate
 
     size_t num_dropped_snapshots;
 
+    bool   merge_threads;
+    size_t merge_partitions;
+    bool   clear_unflushed;
+
     ThreadDB* acquire_tdb(Caliper* c, Channel* chn, bool can_alloc)
     {
         //   we store a pointer to the thread-local aggregation DB for this channel
@@ -89,17 +138,32 @@ class Aggregate
         ThreadDB* tdb = static_cast<ThreadDB*>(c->get(tdb_attr).value().get_ptr());
 
         if (!tdb && can_alloc) {
-            tdb = new ThreadDB(c);
+            //   Re-use the DB of a released thread if there is one. Its
+            // contents go into the next flush along with this thread's data.
+            {
+                std::lock_guard<util::spinlock> g(tdb_lock);
+
+                for (ThreadDB* p = tdb_list; p; p = p->next)
+                    if (p->retired.load()) {
+                        p->retired.store(false);
+                        tdb = p;
+                        break;
+                    }
+            }
 
-            c->set(tdb_attr, Variant(cali_make_variant_from_ptr(tdb)));
+            if (!tdb) {
+                tdb = new ThreadDB(c);
 
-            std::lock_guard<util::spinlock> g(tdb_lock);
+                std::lock_guard<util::spinlock> g(tdb_lock);
+
+                if (tdb_list)
+                    tdb_list->prev = tdb;
 
-            if (tdb_list)
-                tdb_list->prev = tdb;
+                tdb->next = tdb_list;
+                tdb_list  = tdb;
+            }
 
-            tdb->next = tdb_list;
-            tdb_list  = tdb;
+            c->set(tdb_attr, Variant(cali_make_variant_from_ptr(tdb)));
         }
 
         return tdb;
@@ -167,15 +231,70 @@ class Aggregate
 
         size_t num_written = 0;
 
+        std::lock_guard<std::mutex> g(flush_mutex);
+
+        std::vector<ThreadDB*> tdbs;
+
         for (; tdb; tdb = tdb->next) {
-            tdb->stopped.store(true);
-            num_written += tdb->db.flush(info, c, proc_fn);
-            tdb->stopped.store(false);
+            AggregationDB* delta = tdb->swap_active();
+
+            tdb->flushed.merge(*delta);
+            delta->clear();
+
+            if (merge_threads)
+                tdbs.push_back(tdb);
+            else
+                num_written += tdb->flushed.flush(info, c, proc_fn);
         }
 
+        if (merge_threads)
+            num_written = flush_merged(c, tdbs, proc_fn);
+
         Log(1).stream() << chn->name() << ": Aggregate: flushed " << num_written << " snapshots." << std::endl;
     }
 
+    //   Merge the per-thread DBs into a single set of records and flush it.
+    // The keys are split into hash partitions which are merged in parallel.
+
+    size_t flush_merged(Caliper* c, const std::vector<ThreadDB*>& tdbs, SnapshotFlushFn proc_fn)
+    {
+        size_t num_partitions = merge_partitions;
+
+        if (num_partitions == 0)
+            num_partitions = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        num_partitions = std::max<size_t>(std::min(num_partitions, tdbs.size()), 1);
+
+        std::vector<std::unique_ptr<AggregationDB>> partitions;
+        partitions.reserve(num_partitions);
+
+        for (size_t p = 0; p < num_partitions; ++p)
+            partitions.emplace_back(new AggregationDB(c, false));
+
+        auto merge_fn = [&tdbs, &partitions, num_partitions](size_t p) {
+            for (const ThreadDB* tdb : tdbs)
+                partitions[p]->merge_partition(tdb->flushed, p, num_partitions);
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(num_partitions - 1);
+
+        for (size_t p = 1; p < num_partitions; ++p)
+            workers.emplace_back(merge_fn, p);
+
+        merge_fn(0);
+
+        for (std::thread& t : workers)
+            t.join();
+
+        size_t num_written = 0;
+
+        for (auto& db : partitions)
+            num_written += db->flush(info, c, proc_fn);
+
+        return num_written;
+    }
+
     void clear_cb(Caliper* c, Channel* chn)
     {
         ThreadDB* tdb = nullptr;
@@ -192,36 +311,43 @@ class Aggregate
         size_t num_dropped    = 0;
         size_t max_hash_len   = 0;
 
+        std::lock_guard<std::mutex> g(flush_mutex);
+
         while (tdb) {
-            tdb->stopped.store(true);
+            //   Swap out the active DB so we can clear it while the thread
+            // continues recording into the spare DB, which is always empty
+            if (clear_unflushed)
+                tdb->swap_active()->clear();
 
-            num_entries += tdb->db.num_entries();
-            num_kernels += tdb->db.num_kernels();
-            bytes_reserved += tdb->db.bytes_reserved();
-            num_dropped += tdb->db.num_dropped();
-            max_hash_len = std::max(max_hash_len, tdb->db.max_hash_len());
+            num_entries += tdb->flushed.num_entries();
+            num_kernels += tdb->flushed.num_kernels();
+            bytes_reserved += tdb->db_a.bytes_reserved() + tdb->db_b.bytes_reserved() + tdb->flushed.bytes_reserved();
+            num_dropped += tdb->flushed.num_dropped();
+            max_hash_len = std::max(max_hash_len, tdb->flushed.max_hash_len());
 
-            tdb->db.clear();
+            tdb->flushed.clear();
 
-            tdb->stopped.store(false);
+            ThreadDB* tmp     = tdb->next;
+            bool      release = false;
 
             if (tdb->retired) {
-                ThreadDB* tmp = tdb->next;
-
-                {
-                    std::lock_guard<util::spinlock> g(tdb_lock);
+                // re-check under the lock: a new thread may have picked it up
+                std::lock_guard<util::spinlock> g(tdb_lock);
 
+                if (tdb->retired) {
                     tdb->unlink();
 
                     if (tdb == tdb_list)
                         tdb_list = tmp;
+
+                    release = true;
                 }
+            }
 
+            if (release)
                 delete tdb;
-                tdb = tmp;
-            } else {
-                tdb = tdb->next;
-            }
+
+            tdb = tmp;
         }
 
         if (Log::verbosity() >= 2) {
@@ -242,8 +368,8 @@ class Aggregate
     {
         ThreadDB* tdb = acquire_tdb(c, chn, !c->is_signal());
 
-        if (tdb && !tdb->stopped.load())
-            tdb->db.process_snapshot(c, rec, info);
+        if (tdb)
+            tdb->process_snapshot(c, rec, info);
         else
             ++num_dropped_snapshots;
     }
@@ -360,6 +486,10 @@ class Aggregate
         key_attribute_names = config.get("key").to_stringlist(",");
         apply_key_config();
 
+        merge_threads    = config.get("merge_threads").to_bool();
+        merge_partitions = config.get("merge_partitions").to_uint();
+        clear_unflushed  = config.get("clear_unflushed").to_bool();
+
         tdb_attr = c->create_attribute(
             std::string("aggregate.tdb.") + std::to_string(chn->id()),
             CALI_TYPE_PTR,
@@ -430,6 +560,24 @@ const char* Aggregate::s_spec = R"json(
    "name"        : "key",
    "description" : "Attributes in the aggregation key (i.e., group by)",
    "type"        : "string"
+  },
+  {
+   "name"        : "merge_threads",
+   "description" : "Merge the per-thread aggregation results into one set of records on flush",
+   "type"        : "bool",
+   "value"       : "false"
+  },
+  {
+   "name"        : "merge_partitions",
+   "description" : "Number of hash partitions (and threads) used to merge thread results. 0: number of CPUs",
+   "type"        : "uint",
+   "value"       : "0"
+  },
+  {
+   "name"        : "clear_unflushed",
+   "description" : "Also discard snapshots recorded since the last flush on clear",
+   "type"        : "bool",
+   "value"       : "true"
   }
  ]
 }
@@ -49,6 +49,37 @@ struct AggregateKernel {
 #endif
     {}
 
+    inline void merge(const AggregateKernel& k)
+    {
+        if (k.count == 0)
+            return;
+        if (count == 0) {
+            *this = k;
+            return;
+        }
+
+        min.min(k.min);
+        max.max(k.max);
+        sum += k.sum;
+        count += k.count;
+
+#ifdef CALIPER_ENABLE_HISTOGRAMS
+        // align both histograms to the larger max exponent, then add bins
+        int hmax = std::max(histogram_max, k.histogram_max);
+        int tmp[CALI_AGG_HISTOGRAM_BINS] = { 0 };
+
+        for (int ii = 0; ii < CALI_AGG_HISTOGRAM_BINS; ii++) {
+            int jj = std::max(ii - (hmax - histogram_max), 0);
+            tmp[jj] += histogram[ii];
+            jj = std::max(ii - (hmax - k.histogram_max), 0);
+            tmp[jj] += k.histogram[ii];
+        }
+
+        std::copy(tmp, tmp + CALI_AGG_HISTOGRAM_BINS, histogram);
+        histogram_max = hmax;
+#endif
+    }
+
     inline void update(const Variant& val)
     {
         Variant::update_minmaxsum(val, min, max, sum);
@@ -87,8 +118,14 @@ struct AggregateKernel {
     }
 };
 
+//   Root node for aggregation key nodes. It is shared between all
+// aggregation DBs so that identical keys map to the same nodes, which
+// allows merging DBs.
+Node aggr_root_node { CALI_INV_ID, CALI_INV_ID, Variant() };
+
 struct AggregateEntry {
     size_t count;
+    size_t slot;
     size_t key_idx;
     size_t key_len;
     size_t kernels_idx;
@@ -99,8 +136,6 @@ struct AggregateEntry {
 } // namespace
 
 struct AggregationDB::AggregationDBImpl {
-    Node m_aggr_root_node;
-
     size_t m_max_hash_len;
 
     std::vector<AggregateEntry>  m_entries;
@@ -114,7 +149,7 @@ struct AggregationDB::AggregationDBImpl {
 
     Node* make_key_node(Caliper* c, SnapshotView rec, const std::vector<Attribute>& ref_key_attrs)
     {
-        Node* key_node = &m_aggr_root_node;
+        Node* key_node = &::aggr_root_node;
 
         for (const Attribute& attr : ref_key_attrs) {
             Entry e = rec.get(attr);
@@ -144,7 +179,7 @@ struct AggregationDB::AggregationDBImpl {
             key_node = c->make_tree_entry(count, node_vec, key_node);
         }
 
-        return key_node == &m_aggr_root_node ? nullptr : key_node;
+        return key_node == &::aggr_root_node ? nullptr : key_node;
     }
 
     AggregateEntry* find_or_create_entry(SnapshotView key, std::size_t hash, std::size_t num_aggr_attrs, bool can_alloc)
@@ -181,6 +216,7 @@ struct AggregationDB::AggregationDBImpl {
         AggregateEntry e;
 
         e.count          = 0;
+        e.slot           = m_entries.size();
         e.key_idx        = key_idx;
         e.key_len        = key_len;
         e.kernels_idx    = kernels_idx;
@@ -255,6 +291,76 @@ struct AggregationDB::AggregationDBImpl {
         }
     }
 
+    static std::size_t key_hash(SnapshotView key)
+    {
+        // must match the hash computation in process_snapshot()
+        std::size_t hash = 0;
+
+        for (const Entry& e : key) {
+            hash += e.node()->id();
+            if (e.is_immediate())
+                hash += e.value().to_uint();
+        }
+
+        return hash;
+    }
+
+    void merge(const AggregationDBImpl& other)
+    {
+        // entry 0 collects the dropped snapshots
+        m_entries[0].count += other.m_entries[0].count;
+
+        for (std::size_t i = 1; i < other.m_entries.size(); ++i) {
+            const AggregateEntry& o = other.m_entries[i];
+
+            if (o.count == 0)
+                continue;
+
+            SnapshotView    key(o.key_len, &other.m_keyents[o.key_idx]);
+            AggregateEntry* e = find_or_create_entry(key, key_hash(key), o.num_kernels, true);
+
+            merge_entry(e, other, o);
+        }
+    }
+
+    void merge_partition(const AggregationDBImpl& other, std::size_t partition, std::size_t num_partitions)
+    {
+        if (partition == 0)
+            m_entries[0].count += other.m_entries[0].count;
+
+        for (std::size_t i = 1; i < other.m_entries.size(); ++i) {
+            const AggregateEntry& o = other.m_entries[i];
+
+            if (o.count == 0)
+                continue;
+
+            SnapshotView key(o.key_len, &other.m_keyents[o.key_idx]);
+            std::size_t  hash = key_hash(key);
+
+            if (hash % num_partitions != partition)
+                continue;
+
+            // all keys in this partition have the same hash remainder, so use
+            // the quotient to spread them over the hash table
+            AggregateEntry* e = find_or_create_entry(key, hash / num_partitions, o.num_kernels, true);
+
+            if (e->count == 0)
+                e->slot = o.slot;
+            else
+                e->slot = std::min(e->slot, o.slot);
+
+            merge_entry(e, other, o);
+        }
+    }
+
+    void merge_entry(AggregateEntry* e, const AggregationDBImpl& other, const AggregateEntry& o)
+    {
+        e->count += o.count;
+
+        for (std::size_t a = 0; a < std::min(e->num_kernels, o.num_kernels); ++a)
+            m_kernels[e->kernels_idx + a].merge(other.m_kernels[o.kernels_idx + a]);
+    }
+
     void clear()
     {
         m_hashmap.assign(m_hashmap.size(), 0);
@@ -303,7 +409,7 @@ struct AggregationDB::AggregationDBImpl {
             }
 
             rec.push_back(Entry(info.count_attr, cali_make_variant_from_uint(entry.count)));
-            rec.push_back(Entry(info.slot_attr, cali_make_variant_from_uint(num_written)));
+            rec.push_back(Entry(info.slot_attr, cali_make_variant_from_uint(entry.slot)));
 
             // --- write snapshot record
             proc_fn(*c, rec);
@@ -313,22 +419,27 @@ struct AggregationDB::AggregationDBImpl {
         return num_written;
     }
 
-    AggregationDBImpl(Caliper* c) : m_aggr_root_node(CALI_INV_ID, CALI_INV_ID, Variant()), m_max_hash_len(0)
+    AggregationDBImpl(Caliper* c, bool reserve)
+        : m_max_hash_len(0)
     {
-        m_kernels.reserve(16384);
-        m_keyents.reserve(16384);
-        m_entries.reserve(4096);
+        if (reserve) {
+            m_kernels.reserve(16384);
+            m_keyents.reserve(16384);
+            m_entries.reserve(4096);
+        }
+
         m_hashmap.assign(8192, static_cast<std::size_t>(0));
 
         Attribute attr =
             c->create_attribute("skipped.records", CALI_TYPE_STRING, CALI_ATTR_DEFAULT | CALI_ATTR_SKIP_EVENTS);
-        Node* node = c->make_tree_entry(attr, Variant("SKIPPED"), &m_aggr_root_node);
+        Node* node = c->make_tree_entry(attr, Variant("SKIPPED"), &::aggr_root_node);
 
         m_keyents.push_back(Entry(node));
 
         AggregateEntry e;
 
         e.count          = 0;
+        e.slot           = 0;
         e.key_idx        = 0;
         e.key_len        = 1;
         e.kernels_idx    = 0;
@@ -343,7 +454,7 @@ struct AggregationDB::AggregationDBImpl {
 // --- AggregationDB public interface
 //
 
-AggregationDB::AggregationDB(Caliper* c) : mP(new AggregationDBImpl(c))
+AggregationDB::AggregationDB(Caliper* c, bool reserve) : mP(new AggregationDBImpl(c, reserve))
 {}
 
 AggregationDB::~AggregationDB()
@@ -356,6 +467,16 @@ void AggregationDB::process_snapshot(Caliper* c, SnapshotView rec, const Attribu
     mP->process_snapshot(c, rec, info);
 }
 
+void AggregationDB::merge(const AggregationDB& other)
+{
+    mP->merge(*other.mP);
+}
+
+void AggregationDB::merge_partition(const AggregationDB& other, std::size_t partition, std::size_t num_partitions)
+{
+    mP->merge_partition(*other.mP, partition, num_partitions);
+}
+
 void AggregationDB::clear()
 {
     mP->clear();
@@ -54,12 +54,27 @@ class AggregationDB
 
 public:
 
-    AggregationDB(cali::Caliper* c);
+    /// \brief Create an aggregation DB.
+    ///
+    /// If \a reserve is \c true, buffer space is pre-allocated so that
+    /// snapshots can be processed in signal handlers.
+    AggregationDB(cali::Caliper* c, bool reserve = true);
 
     ~AggregationDB();
 
     void process_snapshot(cali::Caliper*, cali::SnapshotView, const AttributeInfo&);
 
+    /// \brief Merge the contents of \a other into this DB.
+    void merge(const AggregationDB& other);
+
+    /// \brief Merge the entries of \a other whose key hash falls into
+    ///   partition \a partition out of \a num_partitions into this DB.
+    ///
+    /// Merging different partitions into separate DBs can be done in
+    /// parallel. Merged entries keep the lowest slot number of their
+    /// sources, which preserves the order in which keys were first seen.
+    void merge_partition(const AggregationDB& other, std::size_t partition, std::size_t num_partitions);
+
     void   clear();
     size_t flush(const AttributeInfo&, cali::Caliper*, cali::SnapshotFlushFn);
 
@@ -30,20 +30,22 @@
 // WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
 // ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-// KokkosLookup.cpp
-// Caliper kokkos variable lookup service
+// KokkosTime.cpp
+// Caliper kokkos kernel timing service
 
 #include "caliper/CaliperService.h"
 
 #include "caliper/Caliper.h"
-#include "../../caliper/MemoryPool.h"
 
 #include "caliper/common/Log.h"
-#include "caliper/common/RuntimeConfig.h"
-#include "caliper/Annotation.h"
+#include "caliper/common/Node.h"
 
-#include <iterator>
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include "types.hpp"
 
@@ -54,63 +56,202 @@ namespace
 
 class KokkosTime
 {
-    cali::Annotation kernel_name_annot;
-    cali::Annotation kernel_type_annot;
+    enum KernelType { ParallelFor = 0, ParallelReduce, ParallelScan, Fence, UserRegion, NumKernelTypes };
 
-    KokkosTime(Caliper* c, Channel* chn)
-        : kernel_name_annot("region"), kernel_type_annot("kernel_type", CALI_ATTR_SKIP_EVENTS)
-    {}
+    static const char* s_kernel_type_names[NumKernelTypes];
 
-public:
+    //   A kernel is a (kernel type, name) pair. Its kernel_type/region
+    // context tree nodes are resolved once for every parent path it is
+    // launched under, so a launch only needs a single blackboard update
+    // instead of two context tree lookups with string comparisons.
+    struct Kernel {
+        std::string name;
+        Variant     v_name;
+
+        std::unordered_map<Node*, Node*> paths; // parent path -> region node
+    };
+
+    //   Kernel lookup by name for one kernel type. Kokkos typically passes
+    // the same label pointer for repeated launches of a kernel, so we first
+    // try the pointer (verified with strcmp) and fall back to the name.
+    struct KernelIndex {
+        std::unordered_map<const char*, uint64_t> by_ptr;
+        std::unordered_map<std::string, uint64_t> by_name;
+    };
+
+    static const std::size_t max_ptr_cache_size = 4096;
+
+    Attribute kernel_name_attr;
+    Attribute kernel_type_attr;
+
+    Variant v_kernel_type[NumKernelTypes];
+
+    std::mutex         m_kernels_lock;
+    std::deque<Kernel> m_kernels;
+    KernelIndex        m_index[NumKernelTypes];
 
-    void pushRegion(const char* name, const char* type)
+    unsigned m_num_paths;
+
+    KokkosTime(Caliper* c, Channel* chn) : m_num_paths(0)
     {
-        kernel_type_annot.begin(type);
-        kernel_name_annot.begin(name);
+        kernel_name_attr = c->create_attribute("region", CALI_TYPE_STRING, CALI_ATTR_NESTED);
+        kernel_type_attr = c->create_attribute("kernel_type", CALI_TYPE_STRING, CALI_ATTR_SKIP_EVENTS);
+
+        for (int i = 0; i < NumKernelTypes; ++i)
+            v_kernel_type[i] = Variant(CALI_TYPE_STRING, s_kernel_type_names[i], std::strlen(s_kernel_type_names[i]));
     }
 
-    void popRegion()
+    // must be called with m_kernels_lock held
+    uint64_t find_or_add_kernel(KernelType type, const char* name)
     {
-        kernel_name_annot.end();
-        kernel_type_annot.end();
+        KernelIndex& index = m_index[type];
+
+        {
+            auto it = index.by_ptr.find(name);
+            if (it != index.by_ptr.end() && m_kernels[it->second].name == name)
+                return it->second;
+        }
+
+        uint64_t id = 0;
+        auto     it = index.by_name.find(name);
+
+        if (it != index.by_name.end()) {
+            id = it->second;
+        } else {
+            id = m_kernels.size();
+            m_kernels.emplace_back();
+
+            Kernel& k = m_kernels.back();
+            k.name    = name;
+            k.v_name  = Variant(CALI_TYPE_STRING, k.name.data(), k.name.size());
+
+            index.by_name.emplace(k.name, id);
+        }
+
+        if (index.by_ptr.size() >= max_ptr_cache_size)
+            index.by_ptr.clear();
+
+        index.by_ptr[name] = id;
+
+        return id;
     }
 
-    static void kokkostime_register(Caliper* c, Channel* chn)
+    uint64_t begin_kernel(KernelType type, const char* name)
     {
+        Caliper c;
+
+        Node*    parent = c.get_region_path(kernel_name_attr);
+        Node*    node   = nullptr;
+        Variant  v_name;
+        uint64_t id     = 0;
+
+        {
+            std::lock_guard<std::mutex> g(m_kernels_lock);
 
+            id        = find_or_add_kernel(type, name);
+            Kernel& k = m_kernels[id];
+            v_name    = k.v_name;
+
+            auto it = k.paths.find(parent);
+
+            if (it != k.paths.end()) {
+                node = it->second;
+            } else {
+                node = c.make_tree_entry(kernel_type_attr, v_kernel_type[type], parent);
+                node = c.make_tree_entry(kernel_name_attr, k.v_name, node);
+
+                k.paths.emplace(parent, node);
+                ++m_num_paths;
+            }
+        }
+
+        c.begin_path(kernel_name_attr, v_name, node);
+
+        return id;
+    }
+
+    void end_kernel()
+    {
+        Caliper c;
+
+        Node* node      = c.get_region_path(kernel_name_attr);
+        Node* type_node = node ? node->parent() : nullptr;
+
+        if (!type_node || node->attribute() != kernel_name_attr.id() || type_node->attribute() != kernel_type_attr.id()) {
+            // not a path created by begin_kernel(): let regular end() report the stack error
+            c.end(kernel_name_attr);
+            c.end(kernel_type_attr);
+            return;
+        }
+
+        c.end_path(kernel_name_attr, node, type_node->parent());
+    }
+
+    void finish_cb(Caliper*, Channel* chn)
+    {
+        Log(2).stream() << chn->name() << ": kokkostime: " << m_kernels.size() << " kernels, " << m_num_paths
+                        << " context tree paths" << std::endl;
+    }
+
+public:
+
+    static void kokkostime_register(Caliper* c, Channel* chn)
+    {
         auto* instance = new KokkosTime(c, chn);
-        chn->events().post_init_evt.connect([instance](Caliper* c, Channel* chn) {
+
+        chn->events().post_init_evt.connect([instance](Caliper*, Channel*) {
             kokkosp_callbacks.kokkosp_begin_parallel_for_callback.connect(
-                [&](const char* name, const uint32_t, uint64_t*) { instance->pushRegion(name, "kokkos.parallel_for"); }
+                [instance](const char* name, const uint32_t, uint64_t* kID) {
+                    *kID = instance->begin_kernel(ParallelFor, name);
+                }
             );
             kokkosp_callbacks.kokkosp_begin_parallel_reduce_callback.connect(
-                [&](const char* name, const uint32_t, uint64_t*) {
-                    instance->pushRegion(name, "kokkos.parallel_reduce");
+                [instance](const char* name, const uint32_t, uint64_t* kID) {
+                    *kID = instance->begin_kernel(ParallelReduce, name);
                 }
             );
             kokkosp_callbacks.kokkosp_begin_parallel_scan_callback.connect(
-                [&](const char* name, const uint32_t, uint64_t*) { instance->pushRegion(name, "kokkos.parallel_scan"); }
+                [instance](const char* name, const uint32_t, uint64_t* kID) {
+                    *kID = instance->begin_kernel(ParallelScan, name);
+                }
+            );
+            kokkosp_callbacks.kokkosp_begin_fence_callback.connect(
+                [instance](const char* name, const uint32_t, uint64_t* kID) {
+                    *kID = instance->begin_kernel(Fence, name);
+                }
             );
-            kokkosp_callbacks.kokkosp_begin_fence_callback.connect([&](const char* name, const uint32_t, uint64_t*) {
-                instance->pushRegion(name, "kokkos.fence");
+            kokkosp_callbacks.kokkosp_end_parallel_for_callback.connect([instance](const uint64_t) {
+                instance->end_kernel();
             });
-            kokkosp_callbacks.kokkosp_end_parallel_for_callback.connect([&](const uint64_t) { instance->popRegion(); });
-            kokkosp_callbacks.kokkosp_end_parallel_reduce_callback.connect([&](const uint64_t) {
-                instance->popRegion();
+            kokkosp_callbacks.kokkosp_end_parallel_reduce_callback.connect([instance](const uint64_t) {
+                instance->end_kernel();
             });
-            kokkosp_callbacks.kokkosp_end_parallel_scan_callback.connect([&](const uint64_t) { instance->popRegion(); }
-            );
-            kokkosp_callbacks.kokkosp_end_fence_callback.connect([&](const uint64_t) { instance->popRegion(); });
-            kokkosp_callbacks.kokkosp_push_region_callback.connect([&](const char* regionName) {
-                instance->pushRegion(regionName, "kokkos.user_region");
+            kokkosp_callbacks.kokkosp_end_parallel_scan_callback.connect([instance](const uint64_t) {
+                instance->end_kernel();
+            });
+            kokkosp_callbacks.kokkosp_end_fence_callback.connect([instance](const uint64_t) {
+                instance->end_kernel();
+            });
+            kokkosp_callbacks.kokkosp_push_region_callback.connect([instance](const char* regionName) {
+                instance->begin_kernel(UserRegion, regionName);
             });
-            kokkosp_callbacks.kokkosp_pop_region_callback.connect([&]() { instance->popRegion(); });
+            kokkosp_callbacks.kokkosp_pop_region_callback.connect([instance]() { instance->end_kernel(); });
+        });
+        chn->events().finish_evt.connect([instance](Caliper* c, Channel* chn) {
+            instance->finish_cb(c, chn);
+            delete instance;
         });
-        chn->events().finish_evt.connect([instance](Caliper*, Channel*) { delete instance; });
 
         Log(1).stream() << chn->name() << ": Registered kokkostime service" << std::endl;
     }
 };
+
+const char* KokkosTime::s_kernel_type_names[] = { "kokkos.parallel_for",
+                                                  "kokkos.parallel_reduce",
+                                                  "kokkos.parallel_scan",
+                                                  "kokkos.fence",
+                                                  "kokkos.user_region" };
+
 } // namespace
 
 namespace cali
@@ -3,6 +3,9 @@
 
 #include "caliper/CaliperService.h"
 
+#include "../BackgroundSampler.h"
+#include "../Services.h"
+
 #include "caliper/Caliper.h"
 #include "caliper/SnapshotRecord.h"
 
@@ -14,6 +17,7 @@
 #include <unistd.h>
 
 #include <array>
+#include <memory>
 
 using namespace cali;
 
@@ -46,32 +50,71 @@ class MemstatService
 
     unsigned m_failed;
 
-    void snapshot_cb(Caliper*, SnapshotBuilder& rec)
+    std::unique_ptr<BackgroundSampler> m_sampler;
+
+    // Reads vmsize, vmrss, and data into val
+    bool read_statm(uint64_t* val)
     {
         char    buf[80];
         ssize_t ret = pread(m_fd, buf, sizeof(buf), 0);
 
-        if (ret < 0) {
+        if (ret < 0)
+            return false;
+
+        auto numbers = parse_statm(buf, ret);
+
+        val[0] = numbers[0];
+        val[1] = numbers[1];
+        val[2] = numbers[5];
+
+        return true;
+    }
+
+    void snapshot_cb(Caliper*, SnapshotBuilder& rec)
+    {
+        uint64_t val[3];
+
+        if (m_sampler) {
+            if (!m_sampler->read(val))
+                return;
+        } else if (!read_statm(val)) {
             ++m_failed;
             return;
         }
 
-        auto val = parse_statm(buf, ret);
-
         rec.append(m_vmsize_attr, cali_make_variant_from_uint(val[0]));
         rec.append(m_vmrss_attr, cali_make_variant_from_uint(val[1]));
-        rec.append(m_vmdata_attr, cali_make_variant_from_uint(val[5]));
+        rec.append(m_vmdata_attr, cali_make_variant_from_uint(val[2]));
+    }
+
+    void post_init_cb()
+    {
+        if (m_sampler)
+            m_sampler->start();
     }
 
     void finish_cb(Caliper*, Channel* channel)
     {
+        if (m_sampler) {
+            m_sampler->stop();
+            m_failed += m_sampler->num_failed();
+        }
+
         if (m_failed > 0)
             Log(0).stream() << channel->name() << ": memstat: failed to read /proc/self/statm " << m_failed
                             << " times\n";
     }
 
-    MemstatService(Caliper* c, int fd) : m_fd { fd }, m_failed { 0 }
+    MemstatService(Caliper* c, Channel* channel, int fd) : m_fd { fd }, m_failed { 0 }
     {
+        ConfigSet config = services::init_config_from_spec(channel->config(), s_spec);
+
+        if (config.get("async").to_bool()) {
+            m_sampler.reset(new BackgroundSampler(3, config.get("interval").to_uint(), [this](uint64_t* val) {
+                return read_statm(val);
+            }));
+        }
+
         m_vmsize_attr = c->create_attribute(
             "memstat.vmsize",
             CALI_TYPE_UINT,
@@ -91,6 +134,8 @@ class MemstatService
 
 public:
 
+    static const char* s_spec;
+
     static void memstat_register(Caliper* c, Channel* channel)
     {
         int fd = open("/proc/self/statm", O_RDONLY | O_NONBLOCK);
@@ -100,8 +145,9 @@ public:
             return;
         }
 
-        MemstatService* instance = new MemstatService(c, fd);
+        MemstatService* instance = new MemstatService(c, channel, fd);
 
+        channel->events().post_init_evt.connect([instance](Caliper*, Channel*) { instance->post_init_cb(); });
         channel->events().snapshot.connect([instance](Caliper* c, Channel*, SnapshotView, SnapshotBuilder& rec) {
             instance->snapshot_cb(c, rec);
         });
@@ -115,10 +161,25 @@ public:
     }
 };
 
-const char* memstat_spec = R"json(
+const char* MemstatService::s_spec = R"json(
 {
     "name"        : "memstat",
-    "description" : "Record process memory info from /proc/self/statm"
+    "description" : "Record process memory info from /proc/self/statm",
+    "config"      :
+    [
+        {
+            "name"        : "async",
+            "description" : "Read /proc/self/statm periodically in a background thread instead of in every snapshot",
+            "type"        : "bool",
+            "value"       : "false"
+        },
+        {
+            "name"        : "interval",
+            "description" : "Update interval for async mode in milliseconds",
+            "type"        : "uint",
+            "value"       : "10"
+        }
+    ]
 }
 )json";
 
@@ -127,6 +188,6 @@ const char* memstat_spec = R"json(
 namespace cali
 {
 
-CaliperService memstat_service { ::memstat_spec, ::MemstatService::memstat_register };
+CaliperService memstat_service { ::MemstatService::s_spec, ::MemstatService::memstat_register };
 
 }
\ No newline at end of file
@@ -11,7 +11,8 @@
 #include "caliper/common/Log.h"
 #include "caliper/common/RuntimeConfig.h"
 
-#include <chrono>
+#include "../../common/util/clock.h"
+
 #include <vector>
 
 using namespace cali;
@@ -43,7 +44,8 @@ class LoopMonitor
 
     std::vector<std::string> target_loops;
 
-    std::chrono::high_resolution_clock::time_point last_snapshot_time;
+    const cali::util::Clock& clock;
+    uint64_t           last_snapshot_time;
 
     bool is_target_loop(const Variant& value)
     {
@@ -68,7 +70,7 @@ class LoopMonitor
         num_iterations  = 0;
         ++num_snapshots;
 
-        last_snapshot_time = std::chrono::high_resolution_clock::now();
+        last_snapshot_time = clock.now();
     }
 
     void begin_cb(Caliper* c, Channel* channel, const Attribute& attr, const Variant& value)
@@ -100,8 +102,8 @@ class LoopMonitor
             if (iteration_interval > 0 && num_iterations % iteration_interval == 0)
                 do_snapshot = true;
             if (time_interval > 0) {
-                auto now = std::chrono::high_resolution_clock::now();
-                if (std::chrono::duration<double>(now - last_snapshot_time).count() > time_interval)
+                double t = static_cast<double>(clock.to_nsec(clock.now() - last_snapshot_time)) * 1e-9;
+                if (t > time_interval)
                     do_snapshot = true;
             }
 
@@ -123,7 +125,9 @@ class LoopMonitor
           num_iterations(0),
           num_snapshots(0),
           iteration_interval(0),
-          time_interval(0.0)
+          time_interval(0.0),
+          clock(cali::util::Clock::get()),
+          last_snapshot_time(clock.now())
     {
         Variant v_true(true);
 
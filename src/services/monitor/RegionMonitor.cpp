@@ -10,7 +10,8 @@
 #include "caliper/common/Log.h"
 #include "caliper/common/RuntimeConfig.h"
 
-#include <chrono>
+#include "../../common/util/clock.h"
+
 #include <unordered_map>
 
 using namespace cali;
@@ -25,8 +26,10 @@ class RegionMonitor
         double child_time;
     };
 
-    std::unordered_map<cali_id_t, RegionInfo>                   m_tracking_regions;
-    std::vector<std::chrono::high_resolution_clock::time_point> m_time_stack;
+    std::unordered_map<cali_id_t, RegionInfo> m_tracking_regions;
+    std::vector<uint64_t>                     m_time_stack;
+
+    const cali::util::Clock& m_clock;
 
     double m_min_interval;
     bool   m_measuring;
@@ -47,7 +50,7 @@ class RegionMonitor
         if (!node)
             return;
 
-        m_time_stack.push_back(std::chrono::high_resolution_clock::now());
+        m_time_stack.push_back(m_clock.now());
 
         auto it = m_tracking_regions.find(node->id());
 
@@ -79,11 +82,11 @@ class RegionMonitor
         if (!node)
             return;
 
-        auto now  = std::chrono::high_resolution_clock::now();
-        auto prev = m_time_stack.back();
+        uint64_t now  = m_clock.now();
+        uint64_t prev = m_time_stack.back();
         m_time_stack.pop_back();
 
-        double duration = std::chrono::duration<double>(now - prev).count();
+        double duration = static_cast<double>(m_clock.to_nsec(now - prev)) * 1e-9;
 
         if (duration > m_min_interval) {
             auto it = m_tracking_regions.find(node->id());
@@ -117,7 +120,8 @@ class RegionMonitor
                         << " instances measured." << std::endl;
     }
 
-    RegionMonitor(Caliper*, Channel* channel) : m_measuring(false), m_skip(0), m_num_measured(0)
+    RegionMonitor(Caliper*, Channel* channel)
+        : m_clock(cali::util::Clock::get()), m_measuring(false), m_skip(0), m_num_measured(0)
     {
         ConfigSet config = services::init_config_from_spec(channel->config(), s_spec);
         m_min_interval   = config.get("time_interval").to_double();
@@ -35,6 +35,7 @@ class MpiReport
     QuerySpec   m_local_spec;
     std::string m_filename;
     bool        m_append_to_file;
+    std::string m_compression;
 
     void write_output_cb(Caliper* c, Channel* channel, SnapshotView flush_info)
     {
@@ -69,6 +70,8 @@ class MpiReport
                 stream.set_mode(OutputStream::Mode::Append);
             if (!m_filename.empty())
                 stream.set_filename(m_filename.c_str(), *c, std::vector<Entry>(flush_info.begin(), flush_info.end()));
+
+            stream.set_compression(m_compression.c_str());
         }
 
         collective_flush(stream, *c, *channel, flush_info, m_local_spec, m_cross_spec, comm);
@@ -91,8 +94,18 @@ class MpiReport
         });
     }
 
-    MpiReport(const QuerySpec& cross_spec, const QuerySpec& local_spec, const std::string& filename, bool append)
-        : m_cross_spec(cross_spec), m_local_spec(local_spec), m_filename(filename), m_append_to_file(append)
+    MpiReport(
+        const QuerySpec&   cross_spec,
+        const QuerySpec&   local_spec,
+        const std::string& filename,
+        bool               append,
+        const std::string& compression
+    )
+        : m_cross_spec(cross_spec),
+          m_local_spec(local_spec),
+          m_filename(filename),
+          m_append_to_file(append),
+          m_compression(compression)
     {}
 
 public:
@@ -120,7 +133,8 @@ public:
             cross_parser.spec(),
             local_parser.spec(),
             config.get("filename").to_string(),
-            config.get("append").to_bool()
+            config.get("append").to_bool(),
+            config.get("compression").to_string()
         );
 
         chn->events().write_output_evt.connect([instance](Caliper* c, Channel* chn, SnapshotView info) {
@@ -154,6 +168,11 @@ const char* MpiReport::s_spec = R"json(
   "description": "Append to file instead of overwriting",
   "type": "bool",
   "value": "false"
+ },{
+  "name": "compression",
+  "description": "Compression format (none, gzip, zstd). Default: based on file name suffix.",
+  "type": "string",
+  "value": "auto"
  },{
   "name": "config",
   "description": "CalQL query for cross-process aggregation and formatting",
@@ -6,10 +6,18 @@
 #include "caliper/Caliper.h"
 #include "caliper/SnapshotRecord.h"
 
+#include "caliper/common/Log.h"
+
+#include "../../common/util/spinlock.hpp"
+
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <functional>
 #include <mutex>
 #include <numeric>
 #include <unordered_map>
+#include <vector>
 
 using namespace cali;
 
@@ -33,6 +41,11 @@ struct MpiTracing::MpiTracingImpl {
     Attribute comm_list_attr;
     Attribute comm_size_attr;
 
+    Attribute min_msg_size_attr;
+    Attribute max_msg_size_attr;
+    Attribute avg_msg_size_attr;
+    Attribute msg_table_attr;
+
     // --- MPI object mappings
     //
 
@@ -50,16 +63,195 @@ struct MpiTracing::MpiTracingImpl {
         Node* comm_node;
     };
 
+    //   Open-addressing hash table for the in-flight requests. Slots are
+    // re-used, so tracking a request doesn't allocate memory once the table
+    // has grown to the program's number of outstanding requests.
+    class RequestTable
+    {
+        struct Slot {
+            MPI_Request req;
+            bool        used;
+            RequestInfo info;
+        };
+
+        std::vector<Slot> m_slots;
+        std::size_t       m_num_used;
+        unsigned          m_shift;
+
+        std::size_t home(MPI_Request req) const
+        {
+            // Fibonacci hashing: request handles are often sequential
+            // integers or aligned pointers
+            return static_cast<std::size_t>(
+                (static_cast<uint64_t>(std::hash<MPI_Request>()(req)) * 0x9E3779B97F4A7C15ull) >> m_shift
+            );
+        }
+
+        std::size_t find_slot(MPI_Request req) const
+        {
+            std::size_t mask = m_slots.size() - 1;
+            std::size_t i    = home(req);
+
+            while (m_slots[i].used && !(m_slots[i].req == req))
+                i = (i + 1) & mask;
+
+            return i;
+        }
+
+        void grow()
+        {
+            std::vector<Slot> old(2 * m_slots.size());
+            old.swap(m_slots);
+            --m_shift;
+
+            for (const Slot& slot : old)
+                if (slot.used)
+                    m_slots[find_slot(slot.req)] = slot;
+        }
+
+    public:
+
+        void insert(MPI_Request req, const RequestInfo& info)
+        {
+            if (2 * (m_num_used + 1) > m_slots.size())
+                grow();
+
+            Slot& slot = m_slots[find_slot(req)];
+
+            if (!slot.used)
+                ++m_num_used;
+
+            slot.req  = req;
+            slot.used = true;
+            slot.info = info;
+        }
+
+        RequestInfo* find(MPI_Request req)
+        {
+            Slot& slot = m_slots[find_slot(req)];
+            return slot.used ? &slot.info : nullptr;
+        }
+
+        void erase(MPI_Request req)
+        {
+            std::size_t mask = m_slots.size() - 1;
+            std::size_t i    = find_slot(req);
+
+            if (!m_slots[i].used)
+                return;
+
+            //   Move later entries of the probe sequence into the hole so
+            // that lookups never need tombstones
+            for (std::size_t j = (i + 1) & mask; m_slots[j].used; j = (j + 1) & mask) {
+                std::size_t h = home(m_slots[j].req);
+
+                if (((j - h) & mask) >= ((j - i) & mask)) {
+                    m_slots[i] = m_slots[j];
+                    i          = j;
+                }
+            }
+
+            m_slots[i].used = false;
+            --m_num_used;
+        }
+
+        RequestTable() : m_slots(128), m_num_used(0), m_shift(64 - 7) {}
+    };
+
     std::atomic<int> comm_id;
 
-    // We hope that whatever MPI_Comm and MPI_Request is is default-hashable.
+    // We hope that whatever MPI_Comm is is default-hashable.
     // So far it works ...
 
     std::unordered_map<MPI_Comm, cali::Node*> comm_map; ///< Communicator map
     std::mutex                                comm_map_lock;
 
-    std::unordered_map<MPI_Request, RequestInfo> req_map;
-    std::mutex                                   req_map_lock;
+    RequestTable req_map;
+    std::mutex   req_map_lock;
+
+    //   Datatype size cache: a small direct-mapped hash table indexed by
+    // the datatype handle. Derived datatypes can be freed and their handles
+    // re-used, so the MPI_Type_free wrapper invalidates their entry.
+    struct TypeSizeSlot {
+        ::util::spinlock lock;
+
+        MPI_Datatype type { MPI_DATATYPE_NULL };
+        int          size { 0 };
+        bool         valid { false };
+    };
+
+    static constexpr std::size_t num_type_size_slots = 64;
+
+    TypeSizeSlot type_sizes[num_type_size_slots];
+
+    TypeSizeSlot& type_size_slot(MPI_Datatype type)
+    {
+        // datatype handles are often aligned pointers: mix the bits
+        uint64_t h = static_cast<uint64_t>(std::hash<MPI_Datatype>()(type)) * 0x9E3779B97F4A7C15ull;
+        return type_sizes[(h >> 32) % num_type_size_slots];
+    }
+
+    // --- Message aggregation
+    //
+
+    //   In aggregate mode, point-to-point messages are accumulated in
+    // per-thread tables keyed by direction, peer, tag, communicator, and
+    // the context tree nodes on the blackboard, instead of creating a
+    // snapshot for each message. The tables are written out as records at
+    // flush time.
+    struct MsgKey {
+        static const int max_nodes = 8;
+
+        int   op;
+        int   peer;
+        int   tag;
+        Node* comm_node;
+        int   n;
+        Node* nodes[max_nodes];
+
+        bool operator== (const MsgKey& other) const
+        {
+            return op == other.op && peer == other.peer && tag == other.tag && comm_node == other.comm_node
+                   && n == other.n && std::equal(nodes, nodes + n, other.nodes);
+        }
+    };
+
+    struct MsgKeyHash {
+        std::size_t operator() (const MsgKey& key) const
+        {
+            std::size_t h = static_cast<std::size_t>(key.op);
+
+            h = h * 31 + static_cast<std::size_t>(key.peer);
+            h = h * 31 + static_cast<std::size_t>(key.tag);
+            h = h * 31 + std::hash<Node*>()(key.comm_node);
+
+            for (int i = 0; i < key.n; ++i)
+                h = h * 31 + std::hash<Node*>()(key.nodes[i]);
+
+            return h;
+        }
+    };
+
+    struct MsgCounter {
+        uint64_t count;
+        uint64_t bytes;
+        int      min_size;
+        int      max_size;
+    };
+
+    struct MsgTable {
+        // protects counters against concurrent flushes
+        ::util::spinlock lock;
+
+        std::unordered_map<MsgKey, MsgCounter, MsgKeyHash> counters;
+
+        MsgTable* next { nullptr };
+    };
+
+    bool aggregate_msgs;
+
+    MsgTable*  msg_tables;
+    std::mutex msg_tables_lock;
 
     // --- initialization
     //
@@ -108,13 +300,67 @@ struct MpiTracing::MpiTracingImpl {
             *(a->ptr) = c->create_attribute(a->name, a->type, a->prop);
     }
 
+    void init_aggregation(Caliper* c, Channel* chn)
+    {
+        aggregate_msgs = true;
+
+        // same result attributes as the aggregate service would produce
+        const int prop = CALI_ATTR_ASVALUE | CALI_ATTR_SCOPE_THREAD | CALI_ATTR_SKIP_EVENTS;
+
+        min_msg_size_attr = c->create_attribute("min#mpi.msg.size", CALI_TYPE_INT, prop);
+        max_msg_size_attr = c->create_attribute("max#mpi.msg.size", CALI_TYPE_INT, prop);
+        avg_msg_size_attr = c->create_attribute("avg#mpi.msg.size", CALI_TYPE_DOUBLE, prop);
+
+        msg_table_attr = c->create_attribute(
+            std::string("mpi.msg.table.") + std::to_string(chn->id()),
+            CALI_TYPE_PTR,
+            CALI_ATTR_SCOPE_THREAD | CALI_ATTR_ASVALUE | CALI_ATTR_SKIP_EVENTS | CALI_ATTR_HIDDEN
+        );
+    }
+
     void init_mpi(Caliper* c, Channel* chn)
     {
-        req_map.reserve(100);
         comm_map.reserve(100);
 
-        make_comm_entry(c, MPI_COMM_WORLD);
-        make_comm_entry(c, MPI_COMM_SELF);
+        {
+            std::lock_guard<std::mutex> g(comm_map_lock);
+
+            comm_map[MPI_COMM_WORLD] = make_comm_entry(c, MPI_COMM_WORLD);
+            comm_map[MPI_COMM_SELF]  = make_comm_entry(c, MPI_COMM_SELF);
+        }
+    }
+
+    int type_size(MPI_Datatype type)
+    {
+        TypeSizeSlot& slot = type_size_slot(type);
+
+        {
+            std::lock_guard<::util::spinlock> g(slot.lock);
+
+            if (slot.valid && slot.type == type)
+                return slot.size;
+        }
+
+        int size = 0;
+        PMPI_Type_size(type, &size);
+
+        std::lock_guard<::util::spinlock> g(slot.lock);
+
+        slot.type  = type;
+        slot.size  = size;
+        slot.valid = true;
+
+        return size;
+    }
+
+    void type_free(MPI_Datatype type)
+    {
+        TypeSizeSlot& slot = type_size_slot(type);
+
+        std::lock_guard<::util::spinlock> g(slot.lock);
+
+        if (slot.type == type)
+            slot.valid = false;
     }
 
     // --- MPI object lookup
@@ -173,11 +419,131 @@ struct MpiTracing::MpiTracingImpl {
         return node;
     }
 
+    // --- message aggregation
+    //
+
+    MsgTable* acquire_msg_table(Caliper* c)
+    {
+        //   we store a pointer to the thread-local message table for this
+        // channel on the thread's blackboard
+
+        MsgTable* table = static_cast<MsgTable*>(c->get(msg_table_attr).value().get_ptr());
+
+        if (!table) {
+            table = new MsgTable;
+
+            {
+                std::lock_guard<std::mutex> g(msg_tables_lock);
+
+                table->next = msg_tables;
+                msg_tables  = table;
+            }
+
+            c->set(msg_table_attr, Variant(cali_make_variant_from_ptr(table)));
+        }
+
+        return table;
+    }
+
+    void aggregate_msg(Caliper* c, int op, int peer, int tag, int size, Node* comm_node)
+    {
+        MsgTable* table = acquire_msg_table(c);
+
+        FixedSizeSnapshotRecord<16> rec;
+        c->pull_context(rec.builder());
+
+        MsgKey key;
+        key.op        = op;
+        key.peer      = peer;
+        key.tag       = tag;
+        key.comm_node = comm_node;
+        key.n         = 0;
+
+        SnapshotView view = rec.view();
+
+        for (const Entry& e : view)
+            if (e.is_reference() && key.n < MsgKey::max_nodes)
+                key.nodes[key.n++] = e.node();
+
+        std::lock_guard<::util::spinlock> g(table->lock);
+
+        MsgCounter& counter = table->counters[key];
+
+        if (counter.count == 0) {
+            counter.min_size = size;
+            counter.max_size = size;
+        } else {
+            counter.min_size = std::min(counter.min_size, size);
+            counter.max_size = std::max(counter.max_size, size);
+        }
+
+        ++counter.count;
+        counter.bytes += static_cast<uint64_t>(size);
+    }
+
+    void flush_msgs(Caliper* c, Channel* channel, SnapshotFlushFn proc_fn)
+    {
+        std::vector<Entry> rec;
+        std::size_t        num_records = 0;
+
+        std::lock_guard<std::mutex> g(msg_tables_lock);
+
+        for (MsgTable* table = msg_tables; table; table = table->next) {
+            std::lock_guard<::util::spinlock> gt(table->lock);
+
+            for (const auto& p : table->counters) {
+                const MsgKey&     key     = p.first;
+                const MsgCounter& counter = p.second;
+
+                rec.clear();
+
+                for (int i = 0; i < key.n; ++i)
+                    rec.push_back(Entry(key.nodes[i]));
+
+                rec.push_back(Entry(key.comm_node));
+
+                bool is_send = (key.op == RequestInfo::Send);
+
+                rec.push_back(Entry(is_send ? msg_dst_attr : msg_src_attr, Variant(key.peer)));
+                rec.push_back(Entry(msg_tag_attr, Variant(key.tag)));
+                rec.push_back(
+                    Entry(is_send ? send_count_attr : recv_count_attr, cali_make_variant_from_int64(counter.count))
+                );
+                rec.push_back(Entry(msg_size_attr, cali_make_variant_from_int64(counter.bytes)));
+                rec.push_back(Entry(min_msg_size_attr, Variant(counter.min_size)));
+                rec.push_back(Entry(max_msg_size_attr, Variant(counter.max_size)));
+                rec.push_back(
+                    Entry(avg_msg_size_attr, Variant(static_cast<double>(counter.bytes) / counter.count))
+                );
+
+                proc_fn(*c, rec);
+                ++num_records;
+            }
+        }
+
+        Log(1).stream() << channel->name() << ": mpi: Flushed " << num_records << " message records" << std::endl;
+    }
+
+    void clear_msgs()
+    {
+        std::lock_guard<std::mutex> g(msg_tables_lock);
+
+        for (MsgTable* table = msg_tables; table; table = table->next) {
+            std::lock_guard<::util::spinlock> gt(table->lock);
+            table->counters.clear();
+        }
+    }
+
     // --- point-to-point
     //
 
     void push_send_event(Caliper* c, Channel* channel, int size, int dest, int tag, cali::Node* comm_node)
     {
+        if (aggregate_msgs) {
+            aggregate_msg(c, RequestInfo::Send, dest, tag, size, comm_node);
+            return;
+        }
+
         const Entry data[] = { { comm_node },
                                { msg_dst_attr, Variant(dest) },
                                { msg_tag_attr, Variant(tag) },
@@ -207,17 +573,20 @@ struct MpiTracing::MpiTracingImpl {
         info.count         = count;
         info.type          = type;
         info.comm_node     = lookup_comm(c, comm);
-
-        PMPI_Type_size(type, &info.size);
-        info.size *= count;
+        info.size          = type_size(type) * count;
 
         std::lock_guard<std::mutex> g(req_map_lock);
 
-        req_map[*req] = info;
+        req_map.insert(*req, info);
     }
 
     void push_recv_event(Caliper* c, Channel* channel, int src, int size, int tag, Node* comm_node)
     {
+        if (aggregate_msgs) {
+            aggregate_msg(c, RequestInfo::Recv, src, tag, size, comm_node);
+            return;
+        }
+
         const Entry data[] = { { comm_node },
                                { msg_src_attr, Variant(src) },
                                { msg_tag_attr, Variant(tag) },
@@ -229,8 +598,7 @@ struct MpiTracing::MpiTracingImpl {
 
     void handle_recv(Caliper* c, Channel* chn, MPI_Datatype type, MPI_Comm comm, MPI_Status* status)
     {
-        int size = 0;
-        PMPI_Type_size(type, &size);
+        int size  = type_size(type);
         int count = 0;
         PMPI_Get_count(status, type, &count);
 
@@ -257,10 +625,11 @@ struct MpiTracing::MpiTracingImpl {
         info.type          = type;
         info.count         = count;
         info.comm_node     = lookup_comm(c, comm);
+        info.size          = 0;
 
         std::lock_guard<std::mutex> g(req_map_lock);
 
-        req_map[*req] = info;
+        req_map.insert(*req, info);
     }
 
     void handle_recv_init(
@@ -287,7 +656,7 @@ struct MpiTracing::MpiTracingImpl {
 
         std::lock_guard<std::mutex> g(req_map_lock);
 
-        req_map[*req] = info;
+        req_map.insert(*req, info);
     }
 
     void handle_start(Caliper* c, Channel* chn, int nreq, MPI_Request* reqs)
@@ -295,12 +664,12 @@ struct MpiTracing::MpiTracingImpl {
         for (int i = 0; i < nreq; ++i) {
             std::lock_guard<std::mutex> g(req_map_lock);
 
-            auto it = req_map.find(reqs[i]);
+            const RequestInfo* info_p = req_map.find(reqs[i]);
 
-            if (it == req_map.end())
+            if (!info_p)
                 continue;
 
-            RequestInfo info = it->second;
+            RequestInfo info = *info_p;
 
             if (info.op == RequestInfo::Send)
                 push_send_event(c, chn, info.size, info.target, info.tag, info.comm_node);
@@ -312,16 +681,15 @@ struct MpiTracing::MpiTracingImpl {
         for (int i = 0; i < nreq; ++i) {
             std::lock_guard<std::mutex> g(req_map_lock);
 
-            auto it = req_map.find(reqs[i]);
+            const RequestInfo* info_p = req_map.find(reqs[i]);
 
-            if (it == req_map.end())
+            if (!info_p)
                 continue;
 
-            RequestInfo info = it->second;
+            RequestInfo info = *info_p;
 
             if (info.op == RequestInfo::Recv) {
-                int size = 0;
-                PMPI_Type_size(info.type, &size);
+                int size  = type_size(info.type);
                 int count = 0;
                 PMPI_Get_count(statuses + i, info.type, &count);
 
@@ -329,7 +697,7 @@ struct MpiTracing::MpiTracingImpl {
             }
 
             if (!info.is_persistent)
-                req_map.erase(it);
+                req_map.erase(reqs[i]);
         }
     }
 
@@ -365,7 +733,16 @@ struct MpiTracing::MpiTracingImpl {
     // --- constructor
     //
 
-    MpiTracingImpl() : comm_id(0) {}
+    MpiTracingImpl() : comm_id(0), aggregate_msgs(false), msg_tables(nullptr) {}
+
+    ~MpiTracingImpl()
+    {
+        while (msg_tables) {
+            MsgTable* tmp = msg_tables->next;
+            delete msg_tables;
+            msg_tables = tmp;
+        }
+    }
 };
 
 MpiTracing::MpiTracing() : mP(new MpiTracingImpl)
@@ -376,9 +753,20 @@ MpiTracing::~MpiTracing()
     mP.reset();
 }
 
-void MpiTracing::init(Caliper* c, Channel* chn)
+void MpiTracing::init(Caliper* c, Channel* chn, bool aggregate_msgs)
 {
     mP->init_attributes(c);
+
+    if (aggregate_msgs) {
+        mP->init_aggregation(c, chn);
+
+        MpiTracingImpl* impl = mP.get();
+
+        chn->events().flush_evt.connect([impl](Caliper* c, Channel* chn, SnapshotView, SnapshotFlushFn proc_fn) {
+            impl->flush_msgs(c, chn, proc_fn);
+        });
+        chn->events().clear_evt.connect([impl](Caliper*, Channel*) { impl->clear_msgs(); });
+    }
 }
 
 void MpiTracing::init_mpi(Caliper* c, Channel* chn)
@@ -388,11 +776,7 @@ void MpiTracing::init_mpi(Caliper* c, Channel* chn)
 
 void MpiTracing::handle_send(Caliper* c, Channel* chn, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm)
 {
-    int size = 0;
-    PMPI_Type_size(type, &size);
-    size *= count;
-
-    mP->push_send_event(c, chn, size, dest, tag, mP->lookup_comm(c, comm));
+    mP->push_send_event(c, chn, mP->type_size(type) * count, dest, tag, mP->lookup_comm(c, comm));
 }
 
 void MpiTracing::handle_send_init(
@@ -466,10 +850,14 @@ void MpiTracing::request_free(Caliper*, Channel*, MPI_Request* req)
     mP->request_free(req);
 }
 
+void MpiTracing::type_free(MPI_Datatype type)
+{
+    mP->type_free(type);
+}
+
 void MpiTracing::handle_12n(Caliper* c, Channel* chn, int count, MPI_Datatype type, int root, MPI_Comm comm)
 {
-    int size = 0;
-    PMPI_Type_size(type, &size);
+    int size = mP->type_size(type);
     int rank = 0;
     PMPI_Comm_rank(comm, &rank);
 
@@ -478,8 +866,7 @@ void MpiTracing::handle_12n(Caliper* c, Channel* chn, int count, MPI_Datatype ty
 
 void MpiTracing::handle_n21(Caliper* c, Channel* chn, int count, MPI_Datatype type, int root, MPI_Comm comm)
 {
-    int size = 0;
-    PMPI_Type_size(type, &size);
+    int size = mP->type_size(type);
     int rank = 0;
     PMPI_Comm_rank(comm, &rank);
 
@@ -488,10 +875,7 @@ void MpiTracing::handle_n21(Caliper* c, Channel* chn, int count, MPI_Datatype ty
 
 void MpiTracing::handle_n2n(Caliper* c, Channel* chn, int count, MPI_Datatype type, MPI_Comm comm)
 {
-    int size = 0;
-    PMPI_Type_size(type, &size);
-
-    mP->push_coll_event(c, chn, Coll_NxN, count * size, 0, mP->lookup_comm(c, comm));
+    mP->push_coll_event(c, chn, Coll_NxN, count * mP->type_size(type), 0, mP->lookup_comm(c, comm));
 }
 
 void MpiTracing::handle_barrier(Caliper* c, Channel* chn, MPI_Comm comm)
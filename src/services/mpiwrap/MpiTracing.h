@@ -29,7 +29,7 @@ public:
 
     ~MpiTracing();
 
-    void init(Caliper* c, Channel* chn);
+    void init(Caliper* c, Channel* chn, bool aggregate_msgs);
     void init_mpi(Caliper* c, Channel* chn);
 
     // --- point-to-point
@@ -82,6 +82,10 @@ public:
 
     void request_free(Caliper* c, Channel* chn, MPI_Request* req);
 
+    /// \brief Drop the cached size of datatype \a type, which is about
+    ///   to be freed
+    void type_free(MPI_Datatype type);
+
     // --- collectives
 
     void handle_12n(Caliper* c, Channel* chn, int count, MPI_Datatype type, int root, MPI_Comm comm);
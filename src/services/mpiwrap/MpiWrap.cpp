@@ -50,6 +50,11 @@ const char* mpi_service_spec = R"json(
     "type": "bool",
     "value": "false"
   },
+  { "name": "msg_aggregation",
+    "description": "Aggregate point-to-point messages by peer, tag, and communicator instead of tracing each message",
+    "type": "bool",
+    "value": "false"
+  },
   { "name": "msg_pattern",
     "description": "Enable message pattern analysis",
     "type": "bool",
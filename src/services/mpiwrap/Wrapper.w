@@ -135,8 +135,9 @@ struct MpiWrapperConfig
         {
             setup_filter(cfg.get("whitelist").to_string(), cfg.get("blacklist").to_string());
 
-            enable_msg_tracing = cfg.get("msg_tracing").to_bool();
-            enable_msg_pattern = cfg.get("msg_pattern").to_bool();
+            enable_msg_aggregation = cfg.get("msg_aggregation").to_bool();
+            enable_msg_tracing     = cfg.get("msg_tracing").to_bool() || enable_msg_aggregation;
+            enable_msg_pattern     = cfg.get("msg_pattern").to_bool();
         }
 
     ~MpiWrapperConfig()
@@ -150,6 +151,7 @@ struct MpiWrapperConfig
     Channel     channel;
 
     bool        enable_msg_tracing;
+    bool        enable_msg_aggregation;
     MpiTracing  tracing;
 
     bool        enable_msg_pattern;
@@ -923,6 +925,29 @@ post_init_cb(Caliper* c, Channel* channel)
 #endif
 }{{endfn}}
 
+{{fn func MPI_Type_free}}{
+#ifndef CALIPER_MPIWRAP_USE_GOTCHA
+    if (::enable_wrapper) {
+#endif
+        Caliper c;
+        ::push_mpifn(&c, ::{{func}}_wrap_count > 0, "{{func}}");
+
+        // MPI can re-use the handle, so drop its cached size. We need to
+        // do this whether or not MPI_Type_free is enabled in the filter.
+        for (MpiWrapperConfig* mwc = MpiWrapperConfig::get_wrapper_config(); mwc; mwc = mwc->next)
+            if (mwc->enable_msg_tracing)
+                mwc->tracing.type_free(*{{0}});
+
+        {{callfn}}
+
+        ::pop_mpifn(&c, ::{{func}}_wrap_count > 0);
+#ifndef CALIPER_MPIWRAP_USE_GOTCHA
+    } else {
+        {{callfn}}
+    }
+#endif
+}{{endfn}}
+
 //
 // --- Collectives
 //
@@ -1361,7 +1386,7 @@ post_init_cb(Caliper* c, Channel* channel)
     MPI_Send_init MPI_Bsend_init MPI_Rsend_init MPI_Ssend_init
     MPI_Recv MPI_Irecv MPI_Recv_init
     MPI_Sendrecv MPI_Sendrecv_replace
-    MPI_Start MPI_Startall MPI_Request_free
+    MPI_Start MPI_Startall MPI_Request_free MPI_Type_free
     MPI_Wait MPI_Waitall MPI_Waitany MPI_Waitsome
     MPI_Test MPI_Testall MPI_Testany MPI_Testsome
     MPI_Barrier
@@ -1431,7 +1456,7 @@ void mpiwrap_init(Caliper* c, Channel* chn, ConfigSet& cfg)
     mwc->mpi_events.mpi_init_evt.connect(::mpi_init_cb);
 
     if (mwc->enable_msg_tracing)
-        mwc->tracing.init(c, chn);
+        mwc->tracing.init(c, chn, mwc->enable_msg_aggregation);
 
    if (mwc->enable_msg_pattern) {
         mwc->pattern.init(c, chn);
@@ -1474,6 +1499,12 @@ void mpiwrap_init(Caliper* c, Channel* chn, ConfigSet& cfg)
     ::MPI_Init_thread_is_wrapped = true;
     ::MPI_Finalize_is_wrapped    = true;
 
+    // message tracing needs MPI_Type_free to invalidate its datatype size cache
+    if (mwc->enable_msg_tracing && !::MPI_Type_free_is_wrapped) {
+        bindings.push_back(wrap_MPI_Type_free_binding);
+        ::MPI_Type_free_is_wrapped = true;
+    }
+
     {{forallfn name MPI_Init MPI_Init_thread MPI_Finalize}}
     if (mwc->enable_{{name}} && !::{{name}}_is_wrapped) {
         bindings.push_back(wrap_{{name}}_binding);
@@ -4,13 +4,27 @@
 #include "caliper/Caliper.h"
 
 #include "caliper/CaliperService.h"
+#include "caliper/SnapshotRecord.h"
+
+#include "../Services.h"
 
 #include "caliper/common/Log.h"
+#include "caliper/common/Node.h"
+#include "caliper/common/RuntimeConfig.h"
 #include "caliper/common/StringConverter.h"
 
+#include "../../common/util/clock.h"
+#include "../../common/util/spinlock.hpp"
+
 #include <omp-tools.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 using namespace cali;
 
@@ -61,9 +75,297 @@ Attribute state_attr;
 Attribute proc_id_attr;
 Attribute thread_id_attr;
 Attribute num_threads_attr;
+Attribute sync_duration_attr;
+Attribute sync_count_attr;
 
 unsigned int num_skipped { 0 };
 
+//
+// --- Pre-resolved work and sync region nodes
+//
+
+const int num_work_kinds = 9;
+const int num_sync_kinds = 11;
+
+const char* work_region_names[num_work_kinds] = { "UNKNOWN",         "loop",         "sections",
+                                                  "single_executor", "single_other", "workshare",
+                                                  "distribute",      "taskloop",     "scope" };
+
+const char* sync_region_names[num_sync_kinds] = {
+    "UNKNOWN",      "barrier",   "barrier_implicit", "barrier_explicit",           "barrier_implementation",
+    "taskwait",     "taskgroup", "reduction",        "barrier_implicit_workshare", "barrier_implicit_parallel",
+    "barrier_teams"
+};
+
+Variant work_values[num_work_kinds];
+Variant sync_values[num_sync_kinds];
+
+// Work and sync region nodes at the context tree root, created at initialization
+Node* work_nodes[num_work_kinds];
+Node* sync_nodes[num_sync_kinds];
+
+//   Per-thread cache of the work/sync region node for each kind under the
+// most recently used parent path. OpenMP threads typically hit the same
+// construct under the same path over and over, so most begin events only
+// need a single blackboard update.
+struct RegionNodeCache {
+    Node* parent[num_work_kinds + num_sync_kinds];
+    Node* node[num_work_kinds + num_sync_kinds];
+};
+
+thread_local RegionNodeCache region_node_cache;
+
+void begin_region(Caliper& c, const Attribute& attr, int idx, const Variant& value, Node* root_node)
+{
+    Node*            parent = c.get_region_path(attr);
+    RegionNodeCache& cache  = region_node_cache;
+    Node*            node   = cache.node[idx];
+
+    if (!node || cache.parent[idx] != parent) {
+        node              = parent ? c.make_tree_entry(attr, value, parent) : root_node;
+        cache.parent[idx] = parent;
+        cache.node[idx]   = node;
+    }
+
+    c.begin_path(attr, value, node);
+}
+
+void end_region(Caliper& c, const Attribute& attr)
+{
+    Node* node = c.get_region_path(attr);
+
+    if (node && node->attribute() == attr.id())
+        c.end_path(attr, node, node->parent());
+    else
+        c.end(attr); // not our region: let end() report the stack error
+}
+
+//
+// --- Aggregated sync region times
+//
+
+bool aggregate_sync { false };
+
+//   In aggregate_sync mode, the time spent in sync regions is accumulated
+// in per-thread tables keyed by the sync region kind and the context tree
+// nodes on the blackboard, instead of beginning/ending omp.sync regions.
+// Each ompt channel has its own set of tables, which are written out as
+// records at flush time.
+//   The key holds up to max_nodes context nodes. Deeper contexts are
+// truncated and counted in num_truncated_sync_keys.
+struct SyncKey {
+    static const int max_nodes = 8;
+
+    int   kind;
+    int   n;
+    Node* nodes[max_nodes];
+
+    bool operator== (const SyncKey& other) const
+    {
+        return kind == other.kind && n == other.n && std::equal(nodes, nodes + n, other.nodes);
+    }
+};
+
+struct SyncKeyHash {
+    std::size_t operator() (const SyncKey& key) const
+    {
+        std::size_t h = static_cast<std::size_t>(key.kind);
+
+        for (int i = 0; i < key.n; ++i)
+            h = h * 31 + std::hash<Node*>()(key.nodes[i]);
+
+        return h;
+    }
+};
+
+struct SyncCounter {
+    uint64_t count;
+    uint64_t ticks;
+};
+
+struct SyncTable {
+    // protects counters against concurrent flushes
+    ::util::spinlock lock;
+
+    std::unordered_map<SyncKey, SyncCounter, SyncKeyHash> counters;
+
+    SyncTable* next { nullptr };
+};
+
+/// \brief The sync tables of one ompt channel
+struct SyncChannel {
+    //   we store a pointer to the thread-local sync table for this channel
+    // on the thread's blackboard
+    Attribute table_attr;
+
+    // cleared when the channel is finished
+    std::atomic<bool> active { true };
+
+    SyncTable* tables { nullptr };
+    std::mutex tables_lock;
+
+    SyncTable* acquire_table(Caliper& c)
+    {
+        SyncTable* table = static_cast<SyncTable*>(c.get(table_attr).value().get_ptr());
+
+        if (!table) {
+            table = new SyncTable;
+
+            {
+                std::lock_guard<std::mutex> g(tables_lock);
+
+                table->next = tables;
+                tables      = table;
+            }
+
+            c.set(table_attr, Variant(cali_make_variant_from_ptr(table)));
+        }
+
+        return table;
+    }
+};
+
+//   The OMPT callbacks are shared by all ompt channels. Channels are added
+// to the fixed-size sync_channels array and never removed, so the callbacks
+// can iterate over it without locking.
+const int max_sync_channels = 16;
+
+SyncChannel*     sync_channels[max_sync_channels];
+std::atomic<int> num_sync_channels { 0 };
+std::mutex       sync_channels_lock;
+
+std::atomic<unsigned> num_truncated_sync_keys { 0 };
+
+// the sync region currently open on this thread
+struct SyncState {
+    int      kind { -1 };
+    uint64_t start { 0 };
+};
+
+thread_local SyncState sync_state;
+
+void begin_sync_counter(int kind)
+{
+    sync_state.kind  = kind;
+    sync_state.start = cali::util::Clock::get().now();
+}
+
+void end_sync_counter(Caliper& c)
+{
+    if (sync_state.kind < 0)
+        return;
+
+    uint64_t ticks = cali::util::Clock::get().now() - sync_state.start;
+
+    FixedSizeSnapshotRecord<16> rec;
+    c.pull_context(rec.builder());
+
+    SyncKey key;
+    key.kind = sync_state.kind;
+    key.n    = 0;
+
+    SnapshotView view = rec.view();
+    bool         truncated = rec.builder().skipped() > 0;
+
+    for (const Entry& e : view)
+        if (e.is_reference()) {
+            if (key.n < SyncKey::max_nodes)
+                key.nodes[key.n++] = e.node();
+            else
+                truncated = true;
+        }
+
+    if (truncated)
+        ++num_truncated_sync_keys;
+
+    sync_state.kind = -1;
+
+    int n = num_sync_channels.load(std::memory_order_acquire);
+
+    for (int i = 0; i < n; ++i) {
+        SyncChannel* sc = sync_channels[i];
+
+        if (!sc->active.load(std::memory_order_relaxed))
+            continue;
+
+        SyncTable* table = sc->acquire_table(c);
+
+        std::lock_guard<::util::spinlock> g(table->lock);
+
+        SyncCounter& counter = table->counters[key];
+        ++counter.count;
+        counter.ticks += ticks;
+    }
+}
+
+void flush_sync_counters(Caliper* c, Channel* channel, SyncChannel* sc, SnapshotFlushFn proc_fn)
+{
+    const cali::util::Clock& clock = cali::util::Clock::get();
+
+    std::vector<Entry> rec;
+    std::size_t        num_records = 0;
+
+    std::lock_guard<std::mutex> g(sc->tables_lock);
+
+    for (SyncTable* table = sc->tables; table; table = table->next) {
+        std::lock_guard<::util::spinlock> gt(table->lock);
+
+        for (const auto& p : table->counters) {
+            rec.clear();
+
+            for (int i = 0; i < p.first.n; ++i)
+                rec.push_back(Entry(p.first.nodes[i]));
+
+            rec.push_back(Entry(sync_nodes[p.first.kind]));
+            rec.push_back(Entry(sync_duration_attr, cali_make_variant_from_uint(clock.to_nsec(p.second.ticks))));
+            rec.push_back(Entry(sync_count_attr, cali_make_variant_from_uint(p.second.count)));
+
+            proc_fn(*c, rec);
+            ++num_records;
+        }
+    }
+
+    Log(1).stream() << channel->name() << ": ompt: Flushed " << num_records << " sync region records" << std::endl;
+}
+
+void clear_sync_counters(SyncChannel* sc)
+{
+    std::lock_guard<std::mutex> g(sc->tables_lock);
+
+    for (SyncTable* table = sc->tables; table; table = table->next) {
+        std::lock_guard<::util::spinlock> gt(table->lock);
+        table->counters.clear();
+    }
+}
+
+/// \brief Set up the sync tables for \a channel. Returns \c nullptr if
+///   there are too many ompt channels.
+SyncChannel* register_sync_channel(Caliper* c, Channel* channel)
+{
+    std::lock_guard<std::mutex> g(sync_channels_lock);
+
+    int n = num_sync_channels.load();
+
+    if (n >= max_sync_channels) {
+        Log(0).stream() << channel->name() << ": ompt: too many ompt channels, not aggregating sync regions"
+                        << std::endl;
+        return nullptr;
+    }
+
+    SyncChannel* sc = new SyncChannel;
+
+    sc->table_attr = c->create_attribute(
+        std::string("omp.sync.table.") + std::to_string(channel->id()),
+        CALI_TYPE_PTR,
+        CALI_ATTR_SCOPE_THREAD | CALI_ATTR_ASVALUE | CALI_ATTR_SKIP_EVENTS | CALI_ATTR_HIDDEN
+    );
+
+    sync_channels[n] = sc;
+    num_sync_channels.store(n + 1, std::memory_order_release);
+
+    return sc;
+}
+
 //
 // --- The OMPT callbacks
 //
@@ -167,14 +469,7 @@ void cb_implicit_task(
 
 void cb_work(int wstype, ompt_scope_endpoint_t endpoint, ompt_data_t*, ompt_data_t*, uint64_t, const void*)
 {
-    const char* work_region_names[] = { "UNKNOWN",         "loop",         "sections",
-                                        "single_executor", "single_other", "workshare",
-                                        "distribute",      "taskloop",     "scope" };
-
-    const char* name = "UNKNOWN";
-
-    if (wstype > 0 && wstype <= 8)
-        name = work_region_names[wstype];
+    int kind = (wstype > 0 && wstype < num_work_kinds) ? wstype : 0;
 
     Caliper c;
 
@@ -184,24 +479,16 @@ void cb_work(int wstype, ompt_scope_endpoint_t endpoint, ompt_data_t*, ompt_data
     }
 
     if (endpoint == ompt_scope_begin) {
-        c.begin(work_attr, name);
+        begin_region(c, work_attr, kind, work_values[kind], work_nodes[kind]);
     } else if (endpoint == ompt_scope_end) {
-        c.end(work_attr);
+        end_region(c, work_attr);
     }
 }
 
 void cb_sync_region(int kind, ompt_scope_endpoint_t endpoint, ompt_data_t*, ompt_data_t*, const void*)
 {
-    const char* sync_region_names[] = {
-        "UNKNOWN",      "barrier",   "barrier_implicit", "barrier_explicit",           "barrier_implementation",
-        "taskwait",     "taskgroup", "reduction",        "barrier_implicit_workshare", "barrier_implicit_parallel",
-        "barrier_teams"
-    };
-
-    const char* name = "UNKNOWN";
-
-    if (kind > 0 && kind <= 10)
-        name = sync_region_names[kind];
+    if (kind <= 0 || kind >= num_sync_kinds)
+        kind = 0;
 
     Caliper c;
 
@@ -210,10 +497,17 @@ void cb_sync_region(int kind, ompt_scope_endpoint_t endpoint, ompt_data_t*, ompt
         return;
     }
 
-    if (endpoint == ompt_scope_begin)
-        c.begin(sync_attr, Variant(name));
-    else if (endpoint == ompt_scope_end)
-        c.end(sync_attr);
+    if (aggregate_sync) {
+        if (endpoint == ompt_scope_begin)
+            begin_sync_counter(kind);
+        else if (endpoint == ompt_scope_end)
+            end_sync_counter(c);
+    } else {
+        if (endpoint == ompt_scope_begin)
+            begin_region(c, sync_attr, num_work_kinds + kind, sync_values[kind], sync_nodes[kind]);
+        else if (endpoint == ompt_scope_end)
+            end_region(c, sync_attr);
+    }
 }
 
 //
@@ -307,6 +601,35 @@ void create_attributes(Caliper* c)
         CALI_TYPE_INT,
         CALI_ATTR_SCOPE_THREAD | CALI_ATTR_UNALIGNED | CALI_ATTR_SKIP_EVENTS
     );
+
+    Attribute unit_attr = c->create_attribute("time.unit", CALI_TYPE_STRING, CALI_ATTR_SKIP_EVENTS);
+    Variant   nsec_val  = Variant("nsec");
+
+    sync_duration_attr = c->create_attribute(
+        "omp.sync.duration.ns",
+        CALI_TYPE_UINT,
+        CALI_ATTR_ASVALUE | CALI_ATTR_SKIP_EVENTS | CALI_ATTR_AGGREGATABLE,
+        1,
+        &unit_attr,
+        &nsec_val
+    );
+    sync_count_attr = c->create_attribute(
+        "omp.sync.count",
+        CALI_TYPE_UINT,
+        CALI_ATTR_ASVALUE | CALI_ATTR_SKIP_EVENTS | CALI_ATTR_AGGREGATABLE
+    );
+}
+
+void create_region_nodes(Caliper* c)
+{
+    for (int i = 0; i < num_work_kinds; ++i) {
+        work_values[i] = Variant(work_region_names[i]);
+        work_nodes[i]  = c->make_tree_entry(work_attr, work_values[i]);
+    }
+    for (int i = 0; i < num_sync_kinds; ++i) {
+        sync_values[i] = Variant(sync_region_names[i]);
+        sync_nodes[i]  = c->make_tree_entry(sync_attr, sync_values[i]);
+    }
 }
 
 int num_ompt_channels = 0;
@@ -314,6 +637,11 @@ int num_ompt_channels = 0;
 void pre_finish_cb(Caliper*, Channel* channel)
 {
     if (--num_ompt_channels == 0) {
+        if (num_truncated_sync_keys.load() > 0)
+            Log(1).stream() << channel->name() << ": ompt: " << num_truncated_sync_keys.load()
+                            << " sync region contexts were truncated to " << SyncKey::max_nodes
+                            << " context nodes" << std::endl;
+
         Log(1).stream() << channel->name() << ": Finalizing OMPT" << std::endl;
 
         if (api.finalize_tool)
@@ -327,13 +655,35 @@ void pre_finish_cb(Caliper*, Channel* channel)
     }
 }
 
+const char* ompt_spec = R"json(
+{
+"name": "ompt",
+"description": "Record OpenMP regions and thread information using the OpenMP tools interface",
+"config":
+[
+ {
+  "name": "aggregate_sync",
+  "type": "bool",
+  "description": "Accumulate time in OpenMP synchronization regions in per-thread counters instead of creating omp.sync regions",
+  "value": "false"
+ }
+]}
+)json";
+
 void register_ompt_service(Caliper* c, Channel* channel)
 {
     static bool is_initialized = false;
 
+    ConfigSet config = services::init_config_from_spec(channel->config(), ompt_spec);
+
     if (!is_initialized) {
         is_initialized = true;
+        aggregate_sync = config.get("aggregate_sync").to_bool();
         create_attributes(c);
+        create_region_nodes(c);
+    } else if (config.get("aggregate_sync").to_bool() != aggregate_sync) {
+        Log(0).stream() << channel->name() << ": ompt: aggregate_sync setting differs from first ompt channel, using "
+                        << (aggregate_sync ? "true" : "false") << std::endl;
     }
 
     ++num_ompt_channels;
@@ -341,8 +691,18 @@ void register_ompt_service(Caliper* c, Channel* channel)
     channel->events().post_init_evt.connect(post_init_cb);
     channel->events().pre_finish_evt.connect(pre_finish_cb);
 
+    SyncChannel* sc = aggregate_sync ? register_sync_channel(c, channel) : nullptr;
+
+    if (sc) {
+        channel->events().flush_evt.connect([sc](Caliper* c, Channel* channel, SnapshotView, SnapshotFlushFn proc_fn) {
+            flush_sync_counters(c, channel, sc, proc_fn);
+        });
+        channel->events().clear_evt.connect([sc](Caliper*, Channel*) { clear_sync_counters(sc); });
+        channel->events().pre_finish_evt.connect([sc](Caliper*, Channel*) { sc->active.store(false); });
+    }
+
     Log(1).stream() << channel->name() << ": "
-                    << "Registered OMPT service" << std::endl;
+                    << "Registered OMPT service" << (aggregate_sync ? " (aggregating sync regions)" : "") << std::endl;
 }
 
 } // namespace
@@ -370,6 +730,6 @@ ompt_start_tool_result_t* ompt_start_tool(unsigned omp_version, const char* runt
 namespace cali
 {
 
-CaliperService ompt_service { "ompt", ::register_ompt_service };
+CaliperService ompt_service { ::ompt_spec, ::register_ompt_service };
 
 }
@@ -43,6 +43,11 @@ const char* spec = R"json(
   "name": "directory",
   "type": "string",
   "description": "Directory to write .cali files to."
+ },{
+  "name": "compression",
+  "type": "string",
+  "description": "Compression format (none, gzip, zstd). Default: based on file name suffix.",
+  "value": "auto"
  }
 ]}
 )json";
@@ -61,6 +66,7 @@ void write_output_cb(Caliper* c, Channel* chn, SnapshotView flush_info)
 
     OutputStream stream;
     stream.set_filename(filename.c_str(), *c, std::vector<Entry>(flush_info.begin(), flush_info.end()));
+    stream.set_compression(cfg.get("compression").to_string().c_str());
 
     CaliWriter writer(stream);
 
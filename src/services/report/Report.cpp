@@ -60,6 +60,8 @@ class Report
         if (config.get("append").to_bool() == true)
             stream.set_mode(OutputStream::Mode::Append);
 
+        stream.set_compression(config.get("compression").to_string().c_str());
+
         CaliperMetadataDB db;
         QueryProcessor    queryP(spec, stream);
 
@@ -114,6 +116,11 @@ const char* Report::s_spec = R"json(
   "type": "bool",
   "description": "Append to file instead of overwriting",
   "value": "false"
+ },{
+  "name": "compression",
+  "type": "string",
+  "description": "Compression format (none, gzip, zstd). Default: based on file name suffix.",
+  "value": "auto"
  },{
   "name": "config",
   "type": "string"
@@ -0,0 +1,602 @@
+// Copyright (c) 2015-2024, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+// ShmRing service: writes packed snapshots into per-thread ring buffers in
+// a shared-memory segment for processing by a separate consumer process
+
+#include "caliper/CaliperService.h"
+
+#include "../Services.h"
+
+#include "ShmRingFormat.h"
+
+#include "caliper/Caliper.h"
+#include "caliper/SnapshotRecord.h"
+
+#include "caliper/common/Log.h"
+#include "caliper/common/Node.h"
+#include "caliper/common/RuntimeConfig.h"
+
+#include "../../common/CompressedSnapshotRecord.h"
+#include "../../common/util/spinlock.hpp"
+#include "../../common/util/vlenc.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace cali;
+
+namespace
+{
+
+class ShmRingService
+{
+    // Messages are encoded into a per-thread scratch buffer before they
+    // are copied into the ring
+    static const size_t s_max_message_size = 64 * 1024;
+
+    // Max. number of new nodes in a message we can roll back if the
+    // message doesn't fit into the ring
+    static const size_t s_max_rollback = 256;
+
+    struct ThreadRing {
+        uint32_t             index;
+        shmring::RingHeader* hdr;
+        unsigned char*       data;
+        std::atomic<bool>    retired;
+        ThreadRing*          next;
+
+        //   Bitmap of the node IDs we have written into this ring. It
+        // persists when the ring is re-used by another thread, since the
+        // consumer still has the nodes.
+        std::vector<uint64_t> written;
+
+        cali_id_t new_nodes[s_max_rollback];
+        size_t    num_new_nodes;
+
+        unsigned char buf[s_max_message_size];
+
+        ThreadRing(uint32_t i, shmring::RingHeader* h, unsigned char* d)
+            : index(i), hdr(h), data(d), retired(false), next(nullptr), num_new_nodes(0)
+        {}
+
+        bool is_written(cali_id_t id) const { return (written[id / 64] >> (id % 64)) & 1; }
+
+        void mark(cali_id_t id)
+        {
+            written[id / 64] |= (uint64_t(1) << (id % 64));
+
+            if (num_new_nodes < s_max_rollback)
+                new_nodes[num_new_nodes] = id;
+
+            ++num_new_nodes;
+        }
+
+        void rollback()
+        {
+            if (num_new_nodes > s_max_rollback) {
+                // too many to undo: just write all nodes again
+                std::fill(written.begin(), written.end(), uint64_t(0));
+            } else {
+                for (size_t i = 0; i < num_new_nodes; ++i)
+                    written[new_nodes[i] / 64] &= ~(uint64_t(1) << (new_nodes[i] % 64));
+            }
+
+            num_new_nodes = 0;
+        }
+    };
+
+    std::string m_path;
+    int         m_fd;
+
+    // keep the segment at exit if no consumer attached
+    bool m_keep_unattached;
+
+    void*                   m_segment;
+    size_t                  m_segment_size;
+    shmring::SegmentHeader* m_header;
+
+    uint32_t m_num_rings;
+    uint64_t m_ring_size;
+
+    Attribute m_ring_attr;
+
+    ThreadRing*    m_ring_list;
+    uint32_t       m_num_used;
+    util::spinlock m_ring_lock;
+
+    std::atomic<unsigned> m_num_sent;
+    std::atomic<unsigned> m_num_full;
+    std::atomic<unsigned> m_num_no_ring;
+    std::atomic<unsigned> m_num_skipped;
+
+    ThreadRing* acquire_ring(Caliper* c, bool can_alloc)
+    {
+        //   we store a pointer to the thread's ring for this channel on the
+        // thread's blackboard
+
+        ThreadRing* ring = static_cast<ThreadRing*>(c->get(m_ring_attr).value().get_ptr());
+
+        if (!ring && can_alloc) {
+            std::lock_guard<util::spinlock> g(m_ring_lock);
+
+            // re-use a released thread's ring if there is one
+            for (ThreadRing* p = m_ring_list; p; p = p->next)
+                if (p->retired.load()) {
+                    p->retired.store(false);
+                    ring = p;
+                    break;
+                }
+
+            if (!ring && m_num_used < m_num_rings) {
+                uint32_t i = m_num_used++;
+
+                ring = new ThreadRing(
+                    i,
+                    shmring::ring_header(m_segment, i),
+                    shmring::ring_data(m_segment, m_num_rings, m_ring_size, i)
+                );
+
+                ring->next  = m_ring_list;
+                m_ring_list = ring;
+
+                m_header->num_used.store(m_num_used, std::memory_order_release);
+            }
+
+            if (ring)
+                c->set(m_ring_attr, Variant(cali_make_variant_from_ptr(ring)));
+        }
+
+        return ring;
+    }
+
+    // Append node items for node \a id and all nodes it depends on that
+    // haven't been written into \a ring yet. Mirrors CaliWriter's node
+    // output.
+    bool write_node(Caliper* c, ThreadRing* ring, cali_id_t id, size_t& pos, bool can_grow)
+    {
+        if (id < 11) // the consumer has the hard-coded metadata nodes
+            return true;
+
+        if (id / 64 >= ring->written.size()) {
+            if (!can_grow)
+                return false;
+
+            ring->written.resize(std::max<size_t>(2 * ring->written.size(), id / 64 + 1), 0);
+        }
+
+        if (ring->is_written(id))
+            return true;
+
+        Node* node = c->node(id);
+
+        if (!node)
+            return true;
+
+        if (!write_node(c, ring, node->attribute(), pos, can_grow))
+            return false;
+
+        Node*     parent    = node->parent();
+        cali_id_t parent_id = CALI_INV_ID;
+
+        if (parent && parent->id() != CALI_INV_ID) {
+            if (!write_node(c, ring, parent->id(), pos, can_grow))
+                return false;
+
+            parent_id = parent->id();
+        }
+
+        Variant        data = node->data();
+        cali_attr_type type = data.type();
+
+        const unsigned char* str = nullptr;
+        size_t               len = 0;
+
+        if (type == CALI_TYPE_STRING) {
+            str = static_cast<const unsigned char*>(data.data());
+            len = data.size();
+
+            // don't send the terminating NUL character
+            if (len > 0 && str[len - 1] == '\0')
+                --len;
+        } else if (type == CALI_TYPE_USR || type == CALI_TYPE_PTR) {
+            // the consumer can't use these: it will get an empty USR value
+            type = CALI_TYPE_USR;
+        }
+
+        if (pos + 1 + 5 * 10 + len > s_max_message_size)
+            return false;
+
+        unsigned char* b = ring->buf;
+
+        b[pos++] = shmring::NodeItem;
+        pos += vlenc_u64(id, b + pos);
+        pos += vlenc_u64(parent_id == CALI_INV_ID ? 0 : parent_id + 1, b + pos);
+        pos += vlenc_u64(node->attribute(), b + pos);
+        pos += vlenc_u64(static_cast<uint64_t>(type), b + pos);
+
+        if (type == CALI_TYPE_STRING) {
+            pos += vlenc_u64(len, b + pos);
+            std::memcpy(b + pos, str, len);
+            pos += len;
+        } else if (type != CALI_TYPE_USR) {
+            pos += data.pack(b + pos);
+        }
+
+        ring->mark(id);
+
+        return true;
+    }
+
+    static bool is_sent(const Entry& e)
+    {
+        if (e.is_reference())
+            return true;
+        if (!e.is_immediate())
+            return false;
+
+        cali_attr_type type = e.value().type();
+
+        return !(type == CALI_TYPE_STRING || type == CALI_TYPE_USR || type == CALI_TYPE_PTR);
+    }
+
+    // Append an item of the given kind with the entries in \a rec
+    template <class EntryList>
+    bool write_record(
+        Caliper*          c,
+        ThreadRing*       ring,
+        shmring::ItemKind kind,
+        const EntryList&  rec,
+        size_t&           pos,
+        bool              can_grow
+    )
+    {
+        for (const Entry& e : rec)
+            if (is_sent(e))
+                if (!write_node(c, ring, e.is_reference() ? e.node()->id() : e.attribute(), pos, can_grow))
+                    return false;
+
+        if (pos + 3 > s_max_message_size)
+            return false;
+
+        ring->buf[pos++] = kind;
+
+        //   The record clears its buffer up front, so only give it as much
+        // space as the entries can possibly need
+        size_t max_len = std::min<size_t>(s_max_message_size - pos, 2 + 30 * rec.size());
+
+        CompressedSnapshotRecord crec(max_len, ring->buf + pos);
+
+        //   Encode blockwise so we can filter out the entries we don't send
+        // without copying the whole record
+        const size_t blocksize = 8;
+
+        const Node* nodes[blocksize];
+        cali_id_t   attrs[blocksize];
+        Variant     vals[blocksize];
+        size_t      nn = 0;
+        size_t      ni = 0;
+
+        for (const Entry& e : rec) {
+            if (!is_sent(e))
+                continue;
+
+            if (e.is_reference()) {
+                nodes[nn] = e.node();
+
+                if (++nn == blocksize) {
+                    crec.append(nn, nodes);
+                    nn = 0;
+                }
+            } else {
+                attrs[ni] = e.attribute();
+                vals[ni]  = e.value();
+
+                if (++ni == blocksize) {
+                    crec.append(ni, attrs, vals);
+                    ni = 0;
+                }
+            }
+        }
+
+        crec.append(nn, nodes);
+        crec.append(ni, attrs, vals);
+
+        if (crec.num_skipped() > 0 || crec.needed_len() > max_len)
+            return false;
+
+        pos += crec.size();
+
+        return true;
+    }
+
+    template <class EntryList>
+    void push_record(Caliper* c, ThreadRing* ring, shmring::ItemKind kind, const EntryList& rec, bool can_grow)
+    {
+        size_t pos          = 0;
+        ring->num_new_nodes = 0;
+
+        if (!write_record(c, ring, kind, rec, pos, can_grow)) {
+            ring->rollback();
+            ++m_num_skipped;
+            return;
+        }
+
+        if (!shmring::push(ring->hdr, ring->data, m_ring_size, ring->buf, static_cast<uint32_t>(pos))) {
+            ring->rollback();
+            ++m_num_full;
+            return;
+        }
+
+        ++m_num_sent;
+    }
+
+    void process_snapshot_cb(Caliper* c, SnapshotView rec)
+    {
+        bool        can_alloc = !c->is_signal();
+        ThreadRing* ring      = acquire_ring(c, can_alloc);
+
+        if (!ring) {
+            ++m_num_no_ring;
+            return;
+        }
+
+        push_record(c, ring, shmring::SnapshotItem, rec, can_alloc);
+    }
+
+    void release_thread_cb(Caliper* c)
+    {
+        ThreadRing* ring = acquire_ring(c, false);
+
+        if (ring)
+            ring->retired.store(true);
+    }
+
+    void finish_cb(Caliper* c, Channel* channel)
+    {
+        //   Ring 0 was reserved for the globals: use it from this thread
+        // and then tell the consumer we're done
+        ThreadRing* ring = new ThreadRing(
+            0,
+            shmring::ring_header(m_segment, 0),
+            shmring::ring_data(m_segment, m_num_rings, m_ring_size, 0)
+        );
+
+        push_record(c, ring, shmring::GlobalsItem, c->get_globals(*channel), true);
+        delete ring;
+
+        m_header->finished.store(1, std::memory_order_release);
+
+        unsigned num_dropped = m_num_full.load() + m_num_no_ring.load() + m_num_skipped.load();
+
+        Log(1).stream() << channel->name() << ": shmring: Wrote " << m_num_sent.load() << " records, dropped "
+                        << num_dropped << " (" << m_num_full.load() << " ring full, " << m_num_no_ring.load()
+                        << " no free ring, " << m_num_skipped.load() << " too large)" << std::endl;
+
+        if (m_header->attached.load(std::memory_order_acquire) == 0) {
+            //   Without a consumer, the segment would hold on to its tmpfs
+            // memory until someone removes it
+            if (m_keep_unattached) {
+                Log(1).stream() << channel->name() << ": shmring: No consumer attached, leaving " << m_path
+                                << " for later processing" << std::endl;
+            } else {
+                Log(1).stream() << channel->name() << ": shmring: No consumer attached, removing " << m_path
+                                << std::endl;
+
+                if (unlink(m_path.c_str()) != 0)
+                    Log(0).perror(errno, ("shmring: unlink " + m_path + ": ").c_str()) << std::endl;
+            }
+        }
+
+        for (ThreadRing* p = m_ring_list; p;) {
+            ThreadRing* tmp = p->next;
+            delete p;
+            p = tmp;
+        }
+
+        m_ring_list = nullptr;
+    }
+
+    ShmRingService(
+        Caliper*           c,
+        Channel*           channel,
+        const std::string& path,
+        int                fd,
+        bool               keep_unattached,
+        void*              segment,
+        size_t             segment_size,
+        uint32_t           num_rings,
+        uint64_t           ring_size
+    )
+        : m_path { path },
+          m_fd { fd },
+          m_keep_unattached { keep_unattached },
+          m_segment { segment },
+          m_segment_size { segment_size },
+          m_header { static_cast<shmring::SegmentHeader*>(segment) },
+          m_num_rings { num_rings },
+          m_ring_size { ring_size },
+          m_ring_list { nullptr },
+          m_num_used { 1 },
+          m_num_sent { 0 },
+          m_num_full { 0 },
+          m_num_no_ring { 0 },
+          m_num_skipped { 0 }
+    {
+        m_ring_lock.unlock();
+
+        m_ring_attr = c->create_attribute(
+            std::string("shmring.ring.") + std::to_string(channel->id()),
+            CALI_TYPE_PTR,
+            CALI_ATTR_SCOPE_THREAD | CALI_ATTR_ASVALUE | CALI_ATTR_SKIP_EVENTS | CALI_ATTR_HIDDEN
+        );
+    }
+
+    ~ShmRingService()
+    {
+        munmap(m_segment, m_segment_size);
+        close(m_fd);
+    }
+
+public:
+
+    static const char* s_spec;
+
+    static void create(Caliper* c, Channel* channel)
+    {
+        ConfigSet cfg = services::init_config_from_spec(channel->config(), s_spec);
+
+        uint64_t ring_size   = cfg.get("buffer_size").to_uint() * 1024;
+        uint64_t max_threads = cfg.get("max_threads").to_uint();
+
+        if (ring_size < 64 * 1024 || (ring_size & (ring_size - 1)) != 0) {
+            Log(0).stream() << channel->name() << ": shmring: buffer_size must be a power of two and at least 64 KiB"
+                            << std::endl;
+            return;
+        }
+        if (max_threads < 1 || max_threads > 4096) {
+            Log(0).stream() << channel->name() << ": shmring: Invalid max_threads value " << max_threads << std::endl;
+            return;
+        }
+
+        uint32_t num_rings = static_cast<uint32_t>(max_threads) + 1;
+        size_t   size      = shmring::segment_size(num_rings, ring_size);
+
+        std::string name = std::string(shmring::file_prefix) + std::to_string(getpid()) + "-"
+                           + std::to_string(channel->id());
+        std::string dir  = cfg.get("directory").to_string();
+        std::string path = dir + "/" + name;
+        //   Create the segment under a temporary name and rename it when it
+        // is set up so consumers never see a partially initialized segment
+        std::string tmp_path = dir + "/." + name;
+
+        int fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+        if (fd < 0) {
+            Log(0).perror(errno, ("shmring: open " + tmp_path + ": ").c_str()) << std::endl;
+            return;
+        }
+
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            Log(0).perror(errno, "shmring: ftruncate: ") << std::endl;
+            close(fd);
+            unlink(tmp_path.c_str());
+            return;
+        }
+
+        void* segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (segment == MAP_FAILED) {
+            Log(0).perror(errno, "shmring: mmap: ") << std::endl;
+            close(fd);
+            unlink(tmp_path.c_str());
+            return;
+        }
+
+        shmring::SegmentHeader* hdr = new (segment) shmring::SegmentHeader;
+
+        std::memcpy(hdr->magic, shmring::magic, sizeof(hdr->magic));
+        hdr->version   = shmring::version;
+        hdr->num_rings = num_rings;
+        hdr->ring_size = ring_size;
+        hdr->pid       = static_cast<uint64_t>(getpid());
+        hdr->num_used.store(1);
+        hdr->finished.store(0);
+        hdr->attached.store(0);
+
+        for (uint32_t i = 0; i < num_rings; ++i) {
+            shmring::RingHeader* ring = new (shmring::ring_header(segment, i)) shmring::RingHeader;
+
+            ring->write_pos.store(0);
+            ring->num_dropped.store(0);
+            ring->read_pos.store(0);
+        }
+
+        if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+            Log(0).perror(errno, ("shmring: rename " + path + ": ").c_str()) << std::endl;
+            munmap(segment, size);
+            close(fd);
+            unlink(tmp_path.c_str());
+            return;
+        }
+
+        ShmRingService* instance = new ShmRingService(
+            c,
+            channel,
+            path,
+            fd,
+            cfg.get("keep_unattached").to_bool(),
+            segment,
+            size,
+            num_rings,
+            ring_size
+        );
+
+        channel->events().process_snapshot.connect(
+            [instance](Caliper* c, Channel*, SnapshotView, SnapshotView rec) {
+                instance->process_snapshot_cb(c, rec);
+            }
+        );
+        channel->events().release_thread_evt.connect([instance](Caliper* c, Channel*) {
+            instance->release_thread_cb(c);
+        });
+        channel->events().finish_evt.connect([instance](Caliper* c, Channel* channel) {
+            instance->finish_cb(c, channel);
+            delete instance;
+        });
+
+        Log(1).stream() << channel->name() << ": Registered shmring service, writing to " << path << std::endl;
+    }
+};
+
+const char* ShmRingService::s_spec = R"json(
+{
+ "name"        : "shmring",
+ "description" : "Write snapshots into shared-memory ring buffers for an external consumer",
+ "config"      :
+ [
+  {
+   "name"        : "directory",
+   "description" : "Directory for the shared-memory segment",
+   "type"        : "string",
+   "value"       : "/dev/shm"
+  },
+  {
+   "name"        : "buffer_size",
+   "description" : "Size of each thread's ring buffer in KiB (a power of two)",
+   "type"        : "uint",
+   "value"       : "2048"
+  },
+  {
+   "name"        : "max_threads",
+   "description" : "Max. number of threads that can write snapshots",
+   "type"        : "uint",
+   "value"       : "16"
+  },
+  {
+   "name"        : "keep_unattached",
+   "description" : "Keep the segment at exit if no consumer attached to it, for a consumer started later",
+   "type"        : "bool",
+   "value"       : "false"
+  }
+ ]
+}
+)json";
+
+} // namespace
+
+namespace cali
+{
+
+CaliperService shmring_service { ::ShmRingService::s_spec, ::ShmRingService::create };
+
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2015-2024, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+/// \file ShmRingFormat.h
+/// Shared-memory layout and ring buffer protocol of the shmring service
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace cali
+{
+
+namespace shmring
+{
+
+//   The shmring service creates one shared-memory segment per channel and
+// process, named "<directory>/caliper-shmring-<pid>-<channel id>". The
+// segment holds a header followed by a number of single-producer,
+// single-consumer ring buffers. Ring 0 is reserved for the process-wide
+// data that is written at the end (globals); each application thread
+// claims one of the other rings.
+//
+//   The rings carry messages with a 4-byte length (host byte order)
+// followed by the message payload. A payload is a sequence of items, each
+// starting with a one-byte item kind. Unless noted otherwise, integers are
+// variable-length encoded (see vlenc.h):
+//
+//   NodeItem      id parent+1 (0 = root) attribute type value
+//                 where value is the string length and characters for
+//                 STRING nodes, and the packed Variant otherwise
+//   SnapshotItem  CompressedSnapshotRecord
+//   GlobalsItem   CompressedSnapshotRecord with the global entries
+//
+// Node items precede the first item in the same ring that references
+// them. Immediate entries with string or pointer values are not sent.
+
+const char     magic[8]      = { 'C', 'A', 'L', 'I', 'R', 'I', 'N', 'G' };
+const uint32_t version       = 1;
+const char     file_prefix[] = "caliper-shmring-";
+
+const size_t header_size = 4096;
+
+enum ItemKind : unsigned char { NodeItem = 'N', SnapshotItem = 'S', GlobalsItem = 'G' };
+
+struct SegmentHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t num_rings;
+    uint64_t ring_size; ///< data bytes per ring, a power of two
+    uint64_t pid;
+
+    std::atomic<uint32_t> num_used; ///< number of rings in use
+    std::atomic<uint32_t> finished; ///< the producer has written its last message
+    std::atomic<uint32_t> attached; ///< a consumer has attached to the segment
+};
+
+struct RingHeader {
+    alignas(64) std::atomic<uint64_t> write_pos; ///< updated by the producer
+    std::atomic<uint64_t> num_dropped;           ///< messages that didn't fit
+    alignas(64) std::atomic<uint64_t> read_pos;  ///< updated by the consumer
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shmring needs address-free 64-bit atomics");
+
+inline size_t ring_data_offset(uint32_t num_rings)
+{
+    size_t s = header_size + num_rings * sizeof(RingHeader);
+    return (s + header_size - 1) / header_size * header_size;
+}
+
+inline size_t segment_size(uint32_t num_rings, uint64_t ring_size)
+{
+    return ring_data_offset(num_rings) + num_rings * ring_size;
+}
+
+inline RingHeader* ring_header(void* segment, uint32_t ring)
+{
+    return reinterpret_cast<RingHeader*>(static_cast<unsigned char*>(segment) + header_size) + ring;
+}
+
+inline unsigned char* ring_data(void* segment, uint32_t num_rings, uint64_t ring_size, uint32_t ring)
+{
+    return static_cast<unsigned char*>(segment) + ring_data_offset(num_rings) + ring * ring_size;
+}
+
+inline void copy_in(unsigned char* data, uint64_t ring_size, uint64_t pos, const void* src, size_t len)
+{
+    size_t p = pos & (ring_size - 1);
+    size_t n = std::min<size_t>(len, ring_size - p);
+
+    std::memcpy(data + p, src, n);
+    std::memcpy(data, static_cast<const unsigned char*>(src) + n, len - n);
+}
+
+inline void copy_out(const unsigned char* data, uint64_t ring_size, uint64_t pos, void* dst, size_t len)
+{
+    size_t p = pos & (ring_size - 1);
+    size_t n = std::min<size_t>(len, ring_size - p);
+
+    std::memcpy(dst, data + p, n);
+    std::memcpy(static_cast<unsigned char*>(dst) + n, data, len - n);
+}
+
+/// \brief Append a message to the ring. Never blocks; returns \c false if
+///   the message doesn't fit. Must only be called by the ring's producer.
+inline bool push(RingHeader* hdr, unsigned char* data, uint64_t ring_size, const unsigned char* msg, uint32_t len)
+{
+    uint64_t w = hdr->write_pos.load(std::memory_order_relaxed);
+    uint64_t r = hdr->read_pos.load(std::memory_order_acquire);
+
+    if (w - r + sizeof(len) + len > ring_size) {
+        hdr->num_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    copy_in(data, ring_size, w, &len, sizeof(len));
+    copy_in(data, ring_size, w + sizeof(len), msg, len);
+
+    hdr->write_pos.store(w + sizeof(len) + len, std::memory_order_release);
+
+    return true;
+}
+
+} // namespace shmring
+
+} // namespace cali
@@ -0,0 +1,568 @@
+// Copyright (c) 2015-2024, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+// Telemetry service: periodically sends aggregated region profiles to a
+// local collector process through a Unix domain socket
+
+#include "caliper/CaliperService.h"
+
+#include "../Services.h"
+
+#include "TelemetryFormat.h"
+
+#include "caliper/Caliper.h"
+#include "caliper/ChannelController.h"
+#include "caliper/ConfigManager.h"
+#include "caliper/SnapshotRecord.h"
+
+#include "caliper/common/Log.h"
+#include "caliper/common/Node.h"
+#include "caliper/common/RuntimeConfig.h"
+
+#include "../../common/util/vlenc.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace cali;
+
+namespace
+{
+
+inline uint64_t get_timestamp_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Encodes flushed records into telemetry messages (see TelemetryFormat.h)
+
+class MessageEncoder
+{
+    struct AttributeInfo {
+        uint64_t       index;
+        cali_attr_type type;
+    };
+
+    std::vector<unsigned char> m_attr_buf;
+    std::vector<unsigned char> m_node_buf;
+    std::vector<unsigned char> m_rec_buf;
+
+    std::unordered_map<cali_id_t, AttributeInfo> m_attrs;
+    // node id -> node table index + 1, or 0 for nodes that aren't sent
+    std::unordered_map<cali_id_t, uint64_t> m_nodes;
+
+    uint64_t m_num_attrs;
+    uint64_t m_num_nodes;
+    uint64_t m_num_records;
+
+    static void put_u64(std::vector<unsigned char>& buf, uint64_t val)
+    {
+        unsigned char tmp[10];
+        size_t        n = vlenc_u64(val, tmp);
+        buf.insert(buf.end(), tmp, tmp + n);
+    }
+
+    static void put_value(std::vector<unsigned char>& buf, cali_attr_type type, const Variant& val)
+    {
+        switch (type) {
+        case CALI_TYPE_STRING:
+            {
+                const unsigned char* ptr = static_cast<const unsigned char*>(val.data());
+                size_t               len = val.size();
+
+                // don't send the terminating NUL character
+                if (len > 0 && ptr[len - 1] == '\0')
+                    --len;
+
+                put_u64(buf, len);
+                buf.insert(buf.end(), ptr, ptr + len);
+            }
+            break;
+        case CALI_TYPE_INT:
+            put_u64(buf, telemetry::zigzag_encode(val.to_int64()));
+            break;
+        case CALI_TYPE_UINT:
+        case CALI_TYPE_ADDR:
+            put_u64(buf, val.to_uint());
+            break;
+        case CALI_TYPE_TYPE:
+            put_u64(buf, static_cast<uint64_t>(val.to_attr_type()));
+            break;
+        case CALI_TYPE_BOOL:
+            put_u64(buf, val.to_bool() ? 1 : 0);
+            break;
+        case CALI_TYPE_DOUBLE:
+            {
+                double   d    = val.to_double();
+                uint64_t bits = 0;
+                std::memcpy(&bits, &d, sizeof(bits));
+
+                for (int i = 0; i < 8; ++i)
+                    buf.push_back(static_cast<unsigned char>(bits >> (8 * i)));
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    static bool is_supported(const Attribute& attr)
+    {
+        // globals don't change and would only add to the message size
+        if (attr.is_hidden() || attr.is_global())
+            return false;
+
+        switch (attr.type()) {
+        case CALI_TYPE_STRING:
+        case CALI_TYPE_INT:
+        case CALI_TYPE_UINT:
+        case CALI_TYPE_ADDR:
+        case CALI_TYPE_TYPE:
+        case CALI_TYPE_BOOL:
+        case CALI_TYPE_DOUBLE:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    const AttributeInfo* find_or_add_attribute(CaliperMetadataAccessInterface& db, cali_id_t id)
+    {
+        auto it = m_attrs.find(id);
+
+        if (it != m_attrs.end())
+            return it->second.type == CALI_TYPE_INV ? nullptr : &it->second;
+
+        Attribute attr = db.get_attribute(id);
+
+        if (!attr || !is_supported(attr)) {
+            m_attrs.emplace(id, AttributeInfo { 0, CALI_TYPE_INV });
+            return nullptr;
+        }
+
+        AttributeInfo info { m_num_attrs++, attr.type() };
+        std::string   name = attr.name();
+
+        put_u64(m_attr_buf, static_cast<uint64_t>(attr.type()));
+        put_u64(m_attr_buf, static_cast<uint64_t>(attr.properties()));
+        put_u64(m_attr_buf, name.size());
+        m_attr_buf.insert(m_attr_buf.end(), name.begin(), name.end());
+
+        return &(m_attrs.emplace(id, info).first->second);
+    }
+
+    // Returns the node table index + 1, or 0 if neither the node nor any
+    // of its parents are sent
+
+    uint64_t find_or_add_node(CaliperMetadataAccessInterface& db, const Node* node)
+    {
+        if (!node || node->id() == CALI_INV_ID)
+            return 0;
+
+        auto it = m_nodes.find(node->id());
+
+        if (it != m_nodes.end())
+            return it->second;
+
+        uint64_t             parent = find_or_add_node(db, node->parent());
+        const AttributeInfo* info   = find_or_add_attribute(db, node->attribute());
+
+        //   Nodes with unsupported attributes are skipped, and their
+        // children are attached to the closest parent that is sent.
+
+        uint64_t ret = parent;
+
+        if (info) {
+            put_u64(m_node_buf, parent);
+            put_u64(m_node_buf, info->index);
+            put_value(m_node_buf, info->type, node->data());
+
+            ret = ++m_num_nodes;
+        }
+
+        m_nodes.emplace(node->id(), ret);
+
+        return ret;
+    }
+
+    void clear_tables()
+    {
+        m_attr_buf.clear();
+        m_node_buf.clear();
+        m_rec_buf.clear();
+        m_attrs.clear();
+        m_nodes.clear();
+        m_num_attrs   = 0;
+        m_num_nodes   = 0;
+        m_num_records = 0;
+    }
+
+public:
+
+    MessageEncoder() : m_num_attrs(0), m_num_nodes(0), m_num_records(0) {}
+
+    void append_record(CaliperMetadataAccessInterface& db, const std::vector<Entry>& rec)
+    {
+        std::vector<uint64_t>                                 refs;
+        std::vector<std::pair<const AttributeInfo*, Variant>> imms;
+
+        refs.reserve(rec.size());
+        imms.reserve(rec.size());
+
+        for (const Entry& e : rec) {
+            if (e.is_reference()) {
+                uint64_t idx = find_or_add_node(db, e.node());
+                if (idx > 0)
+                    refs.push_back(idx - 1);
+            } else if (e.is_immediate()) {
+                const AttributeInfo* info = find_or_add_attribute(db, e.attribute());
+                if (info)
+                    imms.push_back(std::make_pair(info, e.value()));
+            }
+        }
+
+        put_u64(m_rec_buf, refs.size());
+        for (uint64_t idx : refs)
+            put_u64(m_rec_buf, idx);
+
+        put_u64(m_rec_buf, imms.size());
+        for (const auto& p : imms) {
+            put_u64(m_rec_buf, p.first->index);
+            put_value(m_rec_buf, p.first->type, p.second);
+        }
+
+        ++m_num_records;
+    }
+
+    size_t size() const { return m_attr_buf.size() + m_node_buf.size() + m_rec_buf.size(); }
+
+    /// \brief Write the message with the given header fields into \a msg
+    ///   and reset the encoder for the next message.
+    void finish(
+        unsigned                    flags,
+        uint64_t                    pid,
+        uint64_t                    seq,
+        uint64_t                    fragment,
+        uint64_t                    timestamp_us,
+        uint64_t                    interval_us,
+        std::vector<unsigned char>& msg
+    )
+    {
+        msg.clear();
+        msg.reserve(size() + 80);
+
+        msg.insert(msg.end(), telemetry::magic, telemetry::magic + 4);
+        msg.push_back(telemetry::version);
+
+        put_u64(msg, flags);
+        put_u64(msg, pid);
+        put_u64(msg, seq);
+        put_u64(msg, fragment);
+        put_u64(msg, timestamp_us);
+        put_u64(msg, interval_us);
+
+        put_u64(msg, m_num_attrs);
+        msg.insert(msg.end(), m_attr_buf.begin(), m_attr_buf.end());
+        put_u64(msg, m_num_nodes);
+        msg.insert(msg.end(), m_node_buf.begin(), m_node_buf.end());
+        put_u64(msg, m_num_records);
+        msg.insert(msg.end(), m_rec_buf.begin(), m_rec_buf.end());
+
+        clear_tables();
+    }
+};
+
+class TelemetryService
+{
+    static const char* s_profile_spec;
+
+    // Messages are split when they grow larger than this
+    static const size_t s_max_message_size = 32 * 1024;
+
+    ConfigManager::ChannelPtr m_profile;
+
+    int         m_fd;
+    sockaddr_un m_addr;
+
+    std::chrono::microseconds m_interval;
+
+    std::thread             m_thread;
+    std::mutex              m_thread_mutex;
+    std::condition_variable m_thread_cv;
+    bool                    m_stop;
+
+    std::mutex                 m_publish_mutex;
+    MessageEncoder             m_encoder;
+    std::vector<unsigned char> m_msg;
+
+    uint64_t m_pid;
+    uint64_t m_seq;
+    uint64_t m_last_timestamp_us;
+
+    unsigned m_num_sent;
+    unsigned m_num_dropped;
+    size_t   m_bytes_sent;
+    int      m_last_errno;
+
+    void send_message()
+    {
+        ssize_t ret = sendto(
+            m_fd,
+            m_msg.data(),
+            m_msg.size(),
+            MSG_DONTWAIT | MSG_NOSIGNAL,
+            reinterpret_cast<const sockaddr*>(&m_addr),
+            sizeof(m_addr)
+        );
+
+        if (ret < 0) {
+            //   Never block the application: messages are dropped if there
+            // is no collector or it can't keep up.
+            int err = errno;
+
+            if (err != m_last_errno && err != ENOENT && err != ECONNREFUSED && err != EAGAIN)
+                Log(1).perror(err, "telemetry: sendto: ") << std::endl;
+
+            m_last_errno = err;
+            ++m_num_dropped;
+        } else {
+            m_last_errno = 0;
+            m_bytes_sent += static_cast<size_t>(ret);
+            ++m_num_sent;
+        }
+    }
+
+    void publish(Caliper* c, bool final)
+    {
+        std::lock_guard<std::mutex> g(m_publish_mutex);
+
+        uint64_t timestamp   = get_timestamp_us();
+        uint64_t interval_us = timestamp - m_last_timestamp_us;
+        uint64_t fragment    = 0;
+
+        m_last_timestamp_us = timestamp;
+
+        Channel prof_chn = m_profile->channel();
+
+        c->flush(&prof_chn, SnapshotView(), [&](CaliperMetadataAccessInterface& db, const std::vector<Entry>& rec) {
+            m_encoder.append_record(db, rec);
+
+            if (m_encoder.size() >= s_max_message_size) {
+                m_encoder.finish(0, m_pid, m_seq, fragment++, timestamp, interval_us, m_msg);
+                send_message();
+            }
+        });
+
+        c->clear(&prof_chn);
+
+        unsigned flags = telemetry::LastFragment | (final ? telemetry::FinalInterval : 0);
+
+        m_encoder.finish(flags, m_pid, m_seq, fragment, timestamp, interval_us, m_msg);
+        send_message();
+
+        ++m_seq;
+    }
+
+    void thread_loop()
+    {
+        Caliper c;
+
+        auto next = std::chrono::steady_clock::now() + m_interval;
+
+        std::unique_lock<std::mutex> lk(m_thread_mutex);
+
+        while (!m_thread_cv.wait_until(lk, next, [this]() { return m_stop; })) {
+            lk.unlock();
+            publish(&c, false);
+            lk.lock();
+
+            next += m_interval;
+        }
+    }
+
+    void stop_thread()
+    {
+        {
+            std::lock_guard<std::mutex> g(m_thread_mutex);
+            m_stop = true;
+        }
+
+        m_thread_cv.notify_all();
+
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    void post_init_cb(Caliper*, Channel*)
+    {
+        m_profile->start();
+        m_last_timestamp_us = get_timestamp_us();
+        m_thread            = std::thread(&TelemetryService::thread_loop, this);
+    }
+
+    void pre_finish_cb(Caliper* c, Channel*)
+    {
+        stop_thread();
+        publish(c, true);
+    }
+
+    void finish_cb(Caliper*, Channel* channel)
+    {
+        Log(1).stream() << channel->name() << ": telemetry: Sent " << m_num_sent << " messages (" << m_bytes_sent
+                        << " bytes), dropped " << m_num_dropped << " messages" << std::endl;
+    }
+
+    TelemetryService(ConfigManager::ChannelPtr prof, int fd, const sockaddr_un& addr, std::chrono::microseconds interval)
+        : m_profile { prof },
+          m_fd { fd },
+          m_addr(addr),
+          m_interval { interval },
+          m_stop { false },
+          m_pid { static_cast<uint64_t>(getpid()) },
+          m_seq { 0 },
+          m_last_timestamp_us { 0 },
+          m_num_sent { 0 },
+          m_num_dropped { 0 },
+          m_bytes_sent { 0 },
+          m_last_errno { 0 }
+    {}
+
+    ~TelemetryService() { close(m_fd); }
+
+public:
+
+    static const char* s_spec;
+
+    static void create(Caliper* c, Channel* channel)
+    {
+        ConfigSet cfg = services::init_config_from_spec(channel->config(), s_spec);
+
+        std::string path = cfg.get("socket").to_string();
+
+        if (path.empty()) {
+            Log(0).stream() << channel->name() << ": telemetry: No socket path given (set CALI_TELEMETRY_SOCKET)\n";
+            return;
+        }
+
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+
+        if (path.size() >= sizeof(addr.sun_path)) {
+            Log(0).stream() << channel->name() << ": telemetry: Socket path " << path << " is too long\n";
+            return;
+        }
+
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+        double interval_sec = cfg.get("interval").to_double();
+
+        if (!(interval_sec > 0.0)) {
+            Log(0).stream() << channel->name() << ": telemetry: Invalid interval " << interval_sec << "\n";
+            return;
+        }
+
+        std::string profile_cfg_str = "telemetry.profile";
+        std::string profile_opts    = cfg.get("profile_options").to_string();
+        if (profile_opts.size() > 0)
+            profile_cfg_str.append("(").append(profile_opts).append(")");
+
+        ConfigManager mgr;
+        mgr.add_config_spec(s_profile_spec);
+        mgr.add(profile_cfg_str.c_str());
+
+        if (mgr.error()) {
+            Log(0).stream() << channel->name() << ": telemetry: Profile config error: " << mgr.error_msg() << "\n";
+            return;
+        }
+
+        auto profile = mgr.get_channel("telemetry.profile");
+        if (!profile) {
+            Log(0).stream() << channel->name() << ": telemetry: Cannot create profile channel\n";
+            return;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+        if (fd < 0) {
+            Log(0).perror(errno, "telemetry: socket: ") << std::endl;
+            return;
+        }
+
+        auto interval = std::chrono::microseconds(static_cast<long long>(interval_sec * 1e6));
+
+        TelemetryService* instance = new TelemetryService(profile, fd, addr, interval);
+
+        channel->events().post_init_evt.connect([instance](Caliper* c, Channel* channel) {
+            instance->post_init_cb(c, channel);
+        });
+        channel->events().pre_finish_evt.connect([instance](Caliper* c, Channel* channel) {
+            instance->pre_finish_cb(c, channel);
+        });
+        channel->events().finish_evt.connect([instance](Caliper* c, Channel* channel) {
+            instance->finish_cb(c, channel);
+            delete instance;
+        });
+
+        Log(1).stream() << channel->name() << ": Registered telemetry service, sending to " << path << "\n";
+    }
+};
+
+const char* TelemetryService::s_profile_spec = R"json(
+{
+ "name"        : "telemetry.profile",
+ "description" : "Runtime profile for the telemetry service",
+ "categories"  : [ "region", "metric", "event" ],
+ "services"    : [ "aggregate", "event", "timer" ],
+ "config":
+ {
+   "CALI_CHANNEL_FLUSH_ON_EXIT"      : "false",
+   "CALI_EVENT_ENABLE_SNAPSHOT_INFO" : "false",
+   "CALI_AGGREGATE_KEY"              : "*,mpi.rank",
+   "CALI_AGGREGATE_CLEAR_UNFLUSHED"  : "false"
+ }
+}
+)json";
+
+const char* TelemetryService::s_spec = R"json(
+{
+ "name"        : "telemetry",
+ "description" : "Periodically send region profiles to a local collector through a Unix domain socket",
+ "config"      :
+ [
+  { "name"        : "socket",
+    "type"        : "string",
+    "description" : "Path of the collector's Unix domain datagram socket"
+  },
+  { "name"        : "interval",
+    "type"        : "double",
+    "description" : "Interval between profile messages in seconds",
+    "value"       : "1.0"
+  },
+  { "name"        : "profile_options",
+    "type"        : "string",
+    "description" : "Extra config options for the sub-profile"
+  }
+ ]
+}
+)json";
+
+} // namespace
+
+namespace cali
+{
+
+CaliperService telemetry_service { ::TelemetryService::s_spec, ::TelemetryService::create };
+
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2015-2024, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+/// \file TelemetryFormat.h
+/// Message format of the telemetry service
+
+#pragma once
+
+#include <cstdint>
+
+namespace cali
+{
+
+namespace telemetry
+{
+
+//   The telemetry service sends one or more datagram messages per
+// interval. Each message is self-contained so that a consumer can start
+// reading at any point and lost messages don't affect later ones.
+//
+//   Unless noted otherwise, integers are variable-length encoded
+// (see vlenc.h). A message has the following layout:
+//
+//   magic[4] version[1] flags
+//   pid sequence fragment timestamp_us interval_us
+//   num_attributes { type properties name_len name[name_len] }...
+//   num_nodes      { parent attribute value }...
+//   num_records    { num_refs { node }... num_imm { attribute value }... }...
+//
+// Attributes and nodes are referenced by their index in the message's
+// attribute and node tables. Node parents are stored as index+1, with 0
+// referring to the root. Parents always precede their children.
+//
+//   Values are encoded according to the attribute type:
+//
+//   STRING            length followed by the characters (no terminating NUL)
+//   INT               zigzag-encoded integer
+//   UINT, ADDR, TYPE  integer
+//   BOOL              integer (0 or 1)
+//   DOUBLE            8-byte IEEE 754 bit pattern in little-endian order
+//
+// Attributes of any other type are not sent.
+
+const unsigned char magic[4] = { 'C', 'A', 'L', 'T' };
+const unsigned char version  = 1;
+
+enum Flags {
+    /// \brief Last message of an interval
+    LastFragment = 1,
+    /// \brief Last interval: the sending process is about to exit
+    FinalInterval = 2
+};
+
+inline uint64_t zigzag_encode(int64_t val)
+{
+    return (static_cast<uint64_t>(val) << 1) ^ static_cast<uint64_t>(val >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t val)
+{
+    return static_cast<int64_t>(val >> 1) ^ -static_cast<int64_t>(val & 1);
+}
+
+} // namespace telemetry
+
+} // namespace cali
@@ -14,13 +14,14 @@
 #include "caliper/common/RuntimeConfig.h"
 #include "caliper/common/Log.h"
 
+#include "../../common/util/clock.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <chrono>
 #include <map>
 #include <mutex>
-#include <ratio>
 #include <string>
-#include <type_traits>
 #include <vector>
 
 using namespace cali;
@@ -31,21 +32,51 @@ namespace
 
 class TimerService
 {
+    //   The attribute ID -> stack slot table is a directory of lazily
+    // allocated blocks. Attributes with IDs beyond its range use the
+    // dynamic stacks.
+    static const unsigned slot_block_size = 256;
+    static const unsigned max_slot_blocks = 4096;
+
+    struct TimerStack {
+        std::vector<uint64_t> data;
+        unsigned              depth;
+
+        TimerStack() : depth(0) {}
+    };
+
     //   This keeps per-thread per-channel timer data, which we can look up
     // on the thread-local blackboard
     struct TimerInfo {
         // The timestamp of the last snapshot on this channel+thread
         uint64_t prev_snapshot_timestamp;
 
-        // A per-attribute stack of timestamps for computing inclusive times
-        std::map<cali_id_t, std::vector<uint64_t>> inclusive_timer_stack;
+        //   Per-attribute stacks of timestamps for computing inclusive times,
+        // indexed by the attribute's stack slot. A stack's memory is
+        // allocated on first use and grows as needed; in signal contexts,
+        // where we can't allocate, the depth is tracked beyond the
+        // capacity to keep begin/end pairs consistent.
+        std::vector<TimerStack> stacks;
+
+        // Stacks for attributes that didn't get a slot
+        std::map<cali_id_t, std::vector<uint64_t>> dynamic_stacks;
 
-        TimerInfo() : prev_snapshot_timestamp(0) {}
+        TimerInfo(unsigned num_slots) : prev_snapshot_timestamp(0), stacks(num_slots) {}
+
+        void reset()
+        {
+            prev_snapshot_timestamp = 0;
+
+            for (TimerStack& stack : stacks)
+                stack.depth = 0;
+
+            dynamic_stacks.clear();
+        }
     };
 
-    using clock = std::chrono::steady_clock;
+    const cali::util::Clock& clock;
 
-    chrono::time_point<clock> tstart;
+    uint64_t tstart;
 
     Attribute timeoffs_attr;
     Attribute timerinfo_attr;
@@ -56,36 +87,140 @@ class TimerService
 
     // Keeps all created timer info objects so we can delete them later
     std::vector<TimerInfo*> info_obj_list;
+    // Timer info objects of released threads, to be re-used by new threads
+    std::vector<TimerInfo*> retired_info_objs;
     std::mutex              info_obj_mutex;
+    unsigned                num_info_objs_reused { 0 };
 
     bool record_inclusive_duration;
 
     Attribute begin_evt_attr;
     Attribute end_evt_attr;
 
+    //   Maps attribute IDs to their inclusive timer stack slot (slot + 1;
+    // 0 means no slot). Slots are assigned when attributes are created, so
+    // snapshot_cb() only reads the table.
+    std::atomic<std::atomic<unsigned>*> slot_blocks[max_slot_blocks];
+    unsigned                            num_stack_slots;
+    unsigned                            max_stack_slots;
+    unsigned                            stack_depth;
+    std::mutex                          stack_slot_mutex;
+
     int n_stack_errors { 0 };
+    int n_stack_overflows { 0 };
+    int n_stack_slot_overflows { 0 };
+
+    void assign_stack_slot(const Attribute& attr)
+    {
+        if (attr.skip_events() || attr.is_global() || attr.is_hidden())
+            return;
+
+        cali_id_t block = attr.id() / slot_block_size;
+
+        std::lock_guard<std::mutex> g(stack_slot_mutex);
+
+        if (find_stack_slot(attr.id()) >= 0)
+            return;
+
+        if (block >= max_slot_blocks || num_stack_slots >= max_stack_slots) {
+            if (n_stack_slot_overflows++ == 0)
+                Log(1).stream() << "timer: No inclusive timer stack slot for " << attr.name()
+                                << ", using slower dynamic stacks" << std::endl;
+            return;
+        }
+
+        std::atomic<unsigned>* slots = slot_blocks[block].load();
+
+        if (!slots) {
+            slots = new std::atomic<unsigned>[slot_block_size];
+
+            for (unsigned i = 0; i < slot_block_size; ++i)
+                slots[i].store(0);
+
+            slot_blocks[block].store(slots, std::memory_order_release);
+        }
+
+        slots[attr.id() % slot_block_size].store(++num_stack_slots, std::memory_order_release);
+    }
+
+    int find_stack_slot(cali_id_t attr_id) const
+    {
+        cali_id_t block = attr_id / slot_block_size;
+
+        if (block >= max_slot_blocks)
+            return -1;
+
+        const std::atomic<unsigned>* slots = slot_blocks[block].load(std::memory_order_acquire);
+
+        if (!slots)
+            return -1;
+
+        return static_cast<int>(slots[attr_id % slot_block_size].load(std::memory_order_acquire)) - 1;
+    }
+
+    void push_timestamp(Caliper* c, TimerStack& stack, uint64_t nsec)
+    {
+        if (stack.depth >= stack.data.size()) {
+            if (c->is_signal()) {
+                // can't allocate memory here
+                ++n_stack_overflows;
+                ++stack.depth;
+                return;
+            }
+
+            stack.data.resize(std::max<std::size_t>(2 * stack.data.size(), stack_depth));
+        }
+
+        stack.data[stack.depth++] = nsec;
+    }
 
     TimerInfo* acquire_timerinfo(Caliper* c)
     {
         TimerInfo* ti = static_cast<TimerInfo*>(c->get(timerinfo_attr).value().get_ptr());
 
         if (!ti && !c->is_signal()) {
-            ti = new TimerInfo;
+            {
+                std::lock_guard<std::mutex> g(info_obj_mutex);
 
-            c->set(timerinfo_attr, Variant(cali_make_variant_from_ptr(ti)));
+                if (!retired_info_objs.empty()) {
+                    ti = retired_info_objs.back();
+                    retired_info_objs.pop_back();
+                    ++num_info_objs_reused;
+                }
+            }
 
-            std::lock_guard<std::mutex> g(info_obj_mutex);
+            if (!ti) {
+                ti = new TimerInfo(record_inclusive_duration ? max_stack_slots : 0);
+
+                std::lock_guard<std::mutex> g(info_obj_mutex);
+
+                info_obj_list.push_back(ti);
+            }
 
-            info_obj_list.push_back(ti);
+            c->set(timerinfo_attr, Variant(cali_make_variant_from_ptr(ti)));
         }
 
         return ti;
     }
 
+    void release_thread_cb(Caliper* c, Channel*)
+    {
+        TimerInfo* ti = static_cast<TimerInfo*>(c->get(timerinfo_attr).value().get_ptr());
+
+        if (!ti)
+            return;
+
+        // keep the stacks' memory for the next thread
+        ti->reset();
+
+        std::lock_guard<std::mutex> g(info_obj_mutex);
+
+        retired_info_objs.push_back(ti);
+    }
+
     void snapshot_cb(Caliper* c, Channel* chn, SnapshotView info, SnapshotBuilder& rec)
     {
-        auto     now  = clock::now();
-        uint64_t nsec = chrono::duration_cast<chrono::nanoseconds>(now - tstart).count();
+        uint64_t nsec = clock.to_nsec(clock.now() - tstart);
 
         rec.append(offset_attr, Variant(nsec));
 
@@ -97,7 +232,7 @@ class TimerService
         rec.append(snapshot_duration_attr, cali_make_variant_from_uint(nsec - ti->prev_snapshot_timestamp));
         ti->prev_snapshot_timestamp = nsec;
 
-        if (record_inclusive_duration && !info.empty() && !c->is_signal()) {
+        if (record_inclusive_duration && !info.empty()) {
             Entry event = info.get(begin_evt_attr);
 
             if (event.empty())
@@ -106,25 +241,52 @@ class TimerService
                 return;
 
             cali_id_t evt_attr_id = event.value().to_id();
+            int       slot        = find_stack_slot(evt_attr_id);
+
+            if (slot < 0) {
+                if (!c->is_signal())
+                    update_dynamic_stack(ti, event.attribute(), evt_attr_id, nsec, rec);
+
+                return;
+            }
+
+            TimerStack& stack = ti->stacks[slot];
 
             if (event.attribute() == begin_evt_attr.id()) {
                 // begin event: push current timestamp onto the inclusive timer stack
-                ti->inclusive_timer_stack[evt_attr_id].push_back(nsec);
+                push_timestamp(c, stack, nsec);
             } else if (event.attribute() == end_evt_attr.id()) {
                 // end event: fetch begin timestamp from inclusive timer stack
-                auto stack_it = ti->inclusive_timer_stack.find(evt_attr_id);
-
-                if (stack_it == ti->inclusive_timer_stack.end() || stack_it->second.empty()) {
+                if (stack.depth == 0) {
                     ++n_stack_errors;
                     return;
                 }
 
-                rec.append(inclusive_duration_attr, cali_make_variant_from_uint(nsec - stack_it->second.back()));
-                stack_it->second.pop_back();
+                --stack.depth;
+
+                if (stack.depth < stack.data.size())
+                    rec.append(inclusive_duration_attr, cali_make_variant_from_uint(nsec - stack.data[stack.depth]));
             }
         }
     }
 
+    void update_dynamic_stack(TimerInfo* ti, cali_id_t evt_id, cali_id_t attr_id, uint64_t nsec, SnapshotBuilder& rec)
+    {
+        std::vector<uint64_t>& stack = ti->dynamic_stacks[attr_id];
+
+        if (evt_id == begin_evt_attr.id()) {
+            stack.push_back(nsec);
+        } else if (evt_id == end_evt_attr.id()) {
+            if (stack.empty()) {
+                ++n_stack_errors;
+                return;
+            }
+
+            rec.append(inclusive_duration_attr, cali_make_variant_from_uint(nsec - stack.back()));
+            stack.pop_back();
+        }
+    }
+
     void post_init_cb(Caliper* c, Channel* chn)
     {
         // Find begin/end event snapshot event info attributes
@@ -142,21 +304,42 @@ class TimerService
             record_inclusive_duration = false;
         }
 
+        if (record_inclusive_duration)
+            for (const Attribute& attr : c->get_all_attributes())
+                assign_stack_slot(attr);
+
         // Initialize timer info on this thread
         acquire_timerinfo(c);
     }
 
     void finish_cb(Caliper*, Channel* chn)
     {
+        Log(2).stream() << chn->name() << ": timer: " << info_obj_list.size() << " thread timer info objects created, "
+                        << num_info_objs_reused << " reused." << std::endl;
+
         if (n_stack_errors > 0)
             Log(1).stream() << chn->name() << ": timestamp: Encountered " << n_stack_errors
                             << " inclusive time stack errors!" << std::endl;
+        if (n_stack_overflows > 0)
+            Log(1).stream() << chn->name() << ": timestamp: " << n_stack_overflows
+                            << " regions in signal contexts exceeded the inclusive timer stack capacity,"
+                               " their inclusive times were not recorded. Increase CALI_TIMER_INCLUSIVE_STACK_DEPTH."
+                            << std::endl;
+        if (n_stack_slot_overflows > 0)
+            Log(1).stream() << chn->name() << ": timestamp: " << n_stack_slot_overflows
+                            << " attributes exceeded the inclusive timer stack slots (" << max_stack_slots
+                            << ") and used dynamic stacks. Increase CALI_TIMER_INCLUSIVE_STACK_SLOTS." << std::endl;
     }
 
-    TimerService(Caliper* c, Channel* chn) : tstart(clock::now())
+    TimerService(Caliper* c, Channel* chn, const ConfigSet& config)
+        : clock(cali::util::Clock::get(config.get("tsc").to_bool())), tstart(clock.now()), num_stack_slots(0)
     {
-        ConfigSet config          = services::init_config_from_spec(chn->config(), s_spec);
         record_inclusive_duration = config.get("inclusive_duration").to_bool();
+        max_stack_slots           = config.get("inclusive_stack_slots").to_uint();
+        stack_depth               = std::max(1u, static_cast<unsigned>(config.get("inclusive_stack_depth").to_uint()));
+
+        for (auto& block : slot_blocks)
+            block.store(nullptr);
 
         Attribute unit_attr = c->create_attribute("time.unit", CALI_TYPE_STRING, CALI_ATTR_SKIP_EVENTS);
         Variant   nsec_val  = Variant("nsec");
@@ -198,6 +381,9 @@ class TimerService
 
         for (TimerInfo* ti : info_obj_list)
             delete ti;
+
+        for (auto& block : slot_blocks)
+            delete[] block.load();
     }
 
 public:
@@ -206,10 +392,18 @@ public:
 
     static void timer_register(Caliper* c, Channel* chn)
     {
-        TimerService* instance = new TimerService(c, chn);
+        ConfigSet     config   = services::init_config_from_spec(chn->config(), s_spec);
+        TimerService* instance = new TimerService(c, chn, config);
 
         chn->events().post_init_evt.connect([instance](Caliper* c, Channel* chn) { instance->post_init_cb(c, chn); });
         chn->events().create_thread_evt.connect([instance](Caliper* c, Channel*) { instance->acquire_timerinfo(c); });
+        chn->events().release_thread_evt.connect([instance](Caliper* c, Channel* chn) {
+            instance->release_thread_cb(c, chn);
+        });
+        chn->events().create_attr_evt.connect([instance](Caliper*, Channel*, const Attribute& attr) {
+            if (instance->record_inclusive_duration)
+                instance->assign_stack_slot(attr);
+        });
         chn->events().snapshot.connect([instance](Caliper* c, Channel* chn, SnapshotView info, SnapshotBuilder& rec) {
             instance->snapshot_cb(c, chn, info, rec);
         });
@@ -218,7 +412,8 @@ public:
             delete instance;
         });
 
-        Log(1).stream() << chn->name() << ": Registered timer service" << endl;
+        Log(1).stream() << chn->name() << ": Registered timer service"
+                        << (instance->clock.is_tsc() ? " (using TSC clock)" : "") << endl;
     }
 
 }; // class TimerService
@@ -234,6 +429,24 @@ const char* TimerService::s_spec = R"json(
   "type": "bool",
   "description": "Record inclusive duration of begin/end regions",
   "value": "false"
+ },
+ {
+  "name": "inclusive_stack_slots",
+  "type": "uint",
+  "description": "Number of region attributes with indexed inclusive timer stacks; others use slower dynamic stacks",
+  "value": "64"
+ },
+ {
+  "name": "inclusive_stack_depth",
+  "type": "uint",
+  "description": "Initial capacity of the inclusive timer stacks. Stacks grow as needed outside of signal contexts",
+  "value": "32"
+ },
+ {
+  "name": "tsc",
+  "type": "bool",
+  "description": "Read timestamps from the CPU timestamp counter if the CPU has an invariant TSC",
+  "value": "true"
  }
 ]}
 )json";
@@ -0,0 +1,338 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+#include "SpillFile.h"
+
+#include "TraceBufferChunk.h"
+
+#include "caliper/common/Log.h"
+
+#include <condition_variable>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace trace;
+using namespace cali;
+
+namespace
+{
+
+bool write_all(int fd, const unsigned char* buf, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t ret = pwrite(fd, buf, size, offset);
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        buf += ret;
+        size -= ret;
+        offset += ret;
+    }
+
+    return true;
+}
+
+bool read_all(int fd, unsigned char* buf, size_t size, off_t offset)
+{
+    while (size > 0) {
+        ssize_t ret = pread(fd, buf, size, offset);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+
+        buf += ret;
+        size -= ret;
+        offset += ret;
+    }
+
+    return true;
+}
+
+} // namespace
+
+struct SpillFile::SpillFileImpl {
+    struct Segment {
+        off_t  offset;
+        size_t size;
+        size_t nrec;
+    };
+
+    int       fd;
+    RecycleFn recycle_fn;
+
+    std::thread             writer;
+    std::mutex              mtx;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    bool                    running;
+
+    // fixed-size ring buffer of chunks waiting to be written
+    TraceBufferChunk* queue[max_pending];
+    size_t            queue_head;
+    size_t            queue_size;
+
+    // chunks submitted and chunks written (or failed) so far
+    size_t num_submitted;
+    size_t num_completed;
+
+    std::vector<Segment> segments;
+    off_t                end_offset;
+
+    // number of leading segments written out by the last flush
+    size_t num_flushed;
+
+    size_t num_errors;
+
+    void writer_loop()
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+
+        while (true) {
+            work_cv.wait(lk, [this]() { return queue_size > 0 || !running; });
+
+            if (queue_size == 0)
+                break;
+
+            TraceBufferChunk* chunk = queue[queue_head];
+            queue_head              = (queue_head + 1) % max_pending;
+            --queue_size;
+
+            Segment seg { end_offset, chunk->used(), chunk->num_records() };
+            end_offset += seg.size;
+
+            lk.unlock();
+
+            bool ok = write_all(fd, chunk->data(), seg.size, seg.offset);
+
+            if (!ok)
+                Log(0).stream() << "Trace: error writing spill file: " << std::strerror(errno) << std::endl;
+
+            recycle_fn(chunk);
+
+            lk.lock();
+
+            if (ok)
+                segments.push_back(seg);
+            else
+                ++num_errors;
+
+            ++num_completed;
+            done_cv.notify_all();
+        }
+    }
+
+    // must be called with mtx held and room in the queue
+    void enqueue(TraceBufferChunk* chunk)
+    {
+        queue[(queue_head + queue_size) % max_pending] = chunk;
+        ++queue_size;
+        ++num_submitted;
+        work_cv.notify_one();
+    }
+
+    bool submit(TraceBufferChunk* chunk)
+    {
+        //   Don't wait for the writer thread: it holds the lock only
+        // briefly, and the caller will drop the snapshot if we fail
+        std::unique_lock<std::mutex> lk(mtx, std::try_to_lock);
+
+        if (!lk.owns_lock() || !running || queue_size >= max_pending)
+            return false;
+
+        enqueue(chunk);
+        return true;
+    }
+
+    void submit_wait(TraceBufferChunk* chunk)
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+
+        done_cv.wait(lk, [this]() { return queue_size < max_pending; });
+
+        if (running) {
+            enqueue(chunk);
+        } else {
+            lk.unlock();
+            recycle_fn(chunk);
+        }
+    }
+
+    /// \brief Wait until the chunks submitted before the call have been
+    ///   written. Chunks that other threads submit in the meantime don't
+    ///   hold us up.
+    void sync(std::unique_lock<std::mutex>& lk)
+    {
+        size_t target = num_submitted;
+        done_cv.wait(lk, [this, target]() { return num_completed >= target; });
+    }
+
+    size_t flush(Caliper* c, SnapshotFlushFn proc_fn, TraceBufferChunk* scratch)
+    {
+        std::vector<Segment> segs;
+
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            sync(lk);
+            segs        = segments;
+            num_flushed = segs.size();
+        }
+
+        size_t num_written = 0;
+
+        for (const Segment& seg : segs) {
+            unsigned char* buf = scratch->assign(seg.size, seg.nrec);
+
+            if (!buf || !read_all(fd, buf, seg.size, seg.offset)) {
+                Log(0).stream() << "Trace: error reading spill file" << std::endl;
+                scratch->reset();
+                continue;
+            }
+
+            num_written += scratch->flush(c, proc_fn);
+            scratch->reset();
+        }
+
+        return num_written;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> g(mtx);
+
+        //   Segments are appended in file order, so the flushed ones are
+        // at the front. If newer segments remain, the flushed ones' disk
+        // space is released by punching holes where supported.
+        if (num_flushed == segments.size() && queue_size == 0 && num_completed == num_submitted) {
+            segments.clear();
+            end_offset = 0;
+
+            if (ftruncate(fd, 0) != 0)
+                Log(1).stream() << "Trace: could not truncate spill file: " << std::strerror(errno) << std::endl;
+        } else if (num_flushed > 0) {
+#ifdef FALLOC_FL_PUNCH_HOLE
+            const Segment& last = segments[num_flushed - 1];
+            off_t          len  = last.offset + static_cast<off_t>(last.size) - segments.front().offset;
+
+            fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, segments.front().offset, len);
+#endif
+            segments.erase(segments.begin(), segments.begin() + num_flushed);
+        }
+
+        num_flushed = 0;
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> g(mtx);
+
+            if (!running)
+                return;
+
+            running = false;
+        }
+
+        work_cv.notify_all();
+        writer.join();
+    }
+
+    SpillFileImpl(const std::string& dir, RecycleFn fn)
+        : fd(-1),
+          recycle_fn(fn),
+          running(false),
+          queue_head(0),
+          queue_size(0),
+          num_submitted(0),
+          num_completed(0),
+          end_offset(0),
+          num_flushed(0),
+          num_errors(0)
+    {
+        std::string path = dir;
+
+        if (path.empty()) {
+            const char* tmpdir = std::getenv("TMPDIR");
+            path               = (tmpdir && *tmpdir) ? tmpdir : "/tmp";
+        }
+
+        path.append("/cali-trace-spill-XXXXXX");
+
+        std::vector<char> tmpl(path.begin(), path.end());
+        tmpl.push_back('\0');
+
+        fd = mkstemp(tmpl.data());
+
+        if (fd < 0) {
+            Log(0).stream() << "Trace: could not create spill file " << path << ": " << std::strerror(errno)
+                            << std::endl;
+            return;
+        }
+
+        // the file is only accessed through fd, and goes away when we exit
+        unlink(tmpl.data());
+
+        running = true;
+        writer  = std::thread(&SpillFileImpl::writer_loop, this);
+    }
+
+    ~SpillFileImpl()
+    {
+        stop();
+
+        for (size_t i = 0; i < queue_size; ++i)
+            delete queue[(queue_head + i) % max_pending];
+
+        if (fd >= 0)
+            close(fd);
+    }
+};
+
+SpillFile::SpillFile(const std::string& dir, RecycleFn recycle) : mP(new SpillFileImpl(dir, recycle))
+{}
+
+SpillFile::~SpillFile()
+{}
+
+bool SpillFile::is_open() const
+{
+    return mP->fd >= 0;
+}
+
+bool SpillFile::submit(TraceBufferChunk* chunk)
+{
+    return mP->submit(chunk);
+}
+
+void SpillFile::submit_wait(TraceBufferChunk* chunk)
+{
+    mP->submit_wait(chunk);
+}
+
+size_t SpillFile::flush(Caliper* c, SnapshotFlushFn proc_fn, TraceBufferChunk* scratch)
+{
+    return mP->flush(c, proc_fn, scratch);
+}
+
+void SpillFile::clear()
+{
+    mP->clear();
+}
+
+SpillFile::Stats SpillFile::stats() const
+{
+    std::lock_guard<std::mutex> g(mP->mtx);
+    return { mP->segments.size(), static_cast<size_t>(mP->end_offset), mP->num_errors };
+}
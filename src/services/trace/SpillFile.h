@@ -0,0 +1,76 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+#pragma once
+
+#include "caliper/Caliper.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace trace
+{
+
+class TraceBufferChunk;
+
+/// \brief Temporary file that holds trace buffer chunks spilled from memory
+///
+/// Full chunks are written verbatim, in their packed form, by a background
+/// thread. The records reference context tree node ids, which remain valid
+/// for the lifetime of the process, so no metadata needs to be written. The
+/// file is unlinked right after it is created and disappears when the
+/// process exits. The writer thread is started when the file is created,
+/// so submitting chunks doesn't create threads or allocate memory.
+class SpillFile
+{
+    struct SpillFileImpl;
+    std::unique_ptr<SpillFileImpl> mP;
+
+public:
+
+    /// \brief Called with a chunk once it has been written to the file
+    typedef std::function<void(TraceBufferChunk*)> RecycleFn;
+
+    /// \brief Create a spill file in directory \a dir. If \a dir is empty,
+    ///   use $TMPDIR or /tmp.
+    SpillFile(const std::string& dir, RecycleFn recycle);
+
+    ~SpillFile();
+
+    bool is_open() const;
+
+    /// \brief Max number of chunks waiting to be written
+    static constexpr size_t max_pending = 4;
+
+    /// \brief Queue \a chunk for writing. Takes ownership of the chunk and
+    ///   hands it to the recycle function after it has been written.
+    ///
+    /// Does not block. Returns \c false and leaves the chunk with the
+    /// caller if the queue is full or busy.
+    bool submit(TraceBufferChunk* chunk);
+
+    /// \brief Queue \a chunk for writing, and wait for room in the queue
+    ///   if it is full. Not for use in the snapshot path.
+    void submit_wait(TraceBufferChunk* chunk);
+
+    /// \brief Read back all spilled chunks into \a scratch and flush them
+    ///   through \a proc_fn. Returns the number of records flushed.
+    ///
+    /// Waits until all chunks submitted before the call have been written.
+    size_t flush(cali::Caliper* c, cali::SnapshotFlushFn proc_fn, TraceBufferChunk* scratch);
+
+    /// \brief Discard the chunks written out by the last flush(). Chunks
+    ///   spilled after that are kept.
+    void clear();
+
+    struct Stats {
+        size_t chunks;
+        size_t bytes;
+        size_t errors;
+    };
+
+    Stats stats() const;
+};
+
+} // namespace trace
@@ -8,6 +8,7 @@
 
 #include "../Services.h"
 
+#include "SpillFile.h"
 #include "TraceBufferChunk.h"
 
 #include "caliper/Caliper.h"
@@ -21,6 +22,7 @@
 
 #include <atomic>
 #include <cstring>
+#include <memory>
 #include <mutex>
 
 using namespace trace;
@@ -31,17 +33,31 @@ namespace
 
 class Trace
 {
-    enum BufferPolicy { Flush, Grow, Stop };
+    enum BufferPolicy { Flush, Grow, Stop, Spill };
 
     struct TraceBuffer {
         std::atomic<bool> stopped;
+        std::atomic<bool> writing;
         std::atomic<bool> retired;
 
         TraceBufferChunk* chunks;
         TraceBuffer*      next;
         TraceBuffer*      prev;
 
-        TraceBuffer(size_t s) : stopped(false), retired(false), chunks(new TraceBufferChunk(s)), next(0), prev(0) {}
+        TraceBuffer(TraceBufferChunk* chunk)
+            : stopped(false), writing(false), retired(false), chunks(chunk), next(0), prev(0)
+        {}
+
+        /// \brief Stop recording and wait until the owning thread has
+        ///   stopped writing to the chunks. Writers then drop snapshots
+        ///   until the buffer is started again.
+        void stop()
+        {
+            stopped.store(true);
+
+            while (writing.load())
+                ;
+        }
 
         ~TraceBuffer() { delete chunks; }
 
@@ -57,19 +73,75 @@ class Trace
     BufferPolicy policy     = BufferPolicy::Grow;
     size_t       buffersize = 2 * 1024 * 1024;
 
+    util::HugePages hugepages      = util::HugePages::None;
+    bool            delta_encoding = true;
+
     size_t dropped_snapshots = 0;
 
     unsigned num_acquired = 0;
     unsigned num_released = 0;
     unsigned num_retired  = 0;
+    unsigned num_reused   = 0;
 
     Attribute tbuf_attr;
 
     TraceBuffer*   tbuf_list = nullptr;
     util::spinlock tbuf_lock;
 
+    //   Cleared trace buffer chunks are kept in a free list for re-use
+    // instead of being deleted
+    TraceBufferChunk* free_chunks = nullptr;
+    util::spinlock    free_chunks_lock;
+
+    std::unique_ptr<SpillFile> spill_file;
+
+    // snapshots dropped because no chunk could be spilled
+    std::atomic<size_t> spill_dropped;
+
     std::mutex flush_lock;
 
+    /// \brief Get an empty chunk from the free list, or allocate a new one
+    TraceBufferChunk* get_chunk()
+    {
+        {
+            std::lock_guard<util::spinlock> g(free_chunks_lock);
+
+            if (free_chunks) {
+                TraceBufferChunk* chunk = free_chunks;
+                free_chunks             = chunk->reset();
+                return chunk;
+            }
+        }
+
+        return new TraceBufferChunk(buffersize, hugepages, delta_encoding);
+    }
+
+    /// \brief Get an empty chunk from the free list, or \c nullptr if the
+    ///   free list is empty. Does not allocate memory.
+    TraceBufferChunk* get_free_chunk()
+    {
+        std::lock_guard<util::spinlock> g(free_chunks_lock);
+
+        TraceBufferChunk* chunk = free_chunks;
+
+        if (chunk)
+            free_chunks = chunk->reset();
+
+        return chunk;
+    }
+
+    /// \brief Put the chunk list \a chunks on the free list
+    void recycle_chunks(TraceBufferChunk* chunks)
+    {
+        if (!chunks)
+            return;
+
+        std::lock_guard<util::spinlock> g(free_chunks_lock);
+
+        chunks->append(free_chunks);
+        free_chunks = chunks;
+    }
+
     TraceBuffer* acquire_tbuf(Caliper* c, Channel* chn, bool can_alloc)
     {
         //   we store a pointer to the thread-local trace buffer for this channel
@@ -78,19 +150,39 @@ class Trace
         TraceBuffer* tbuf = static_cast<TraceBuffer*>(c->get(tbuf_attr).value().get_ptr());
 
         if (!tbuf && can_alloc) {
-            tbuf = new TraceBuffer(buffersize);
+            // re-use a released thread's trace buffer if there is one
+            {
+                std::lock_guard<util::spinlock> g(tbuf_lock);
+
+                for (TraceBuffer* p = tbuf_list; p; p = p->next)
+                    if (p->retired.load()) {
+                        p->retired.store(false);
+                        tbuf = p;
+                        ++num_reused;
+                        break;
+                    }
+            }
 
-            c->set(tbuf_attr, Variant(cali_make_variant_from_ptr(tbuf)));
+            if (!tbuf) {
+                // leave the spill policy's spare chunks for handle_overflow()
+                TraceBufferChunk* chunk = policy == BufferPolicy::Spill
+                                              ? new TraceBufferChunk(buffersize, hugepages, delta_encoding)
+                                              : get_chunk();
 
-            std::lock_guard<util::spinlock> g(tbuf_lock);
+                tbuf = new TraceBuffer(chunk);
+
+                std::lock_guard<util::spinlock> g(tbuf_lock);
 
-            if (tbuf_list)
-                tbuf_list->prev = tbuf;
+                if (tbuf_list)
+                    tbuf_list->prev = tbuf;
 
-            tbuf->next = tbuf_list;
-            tbuf_list  = tbuf;
+                tbuf->next = tbuf_list;
+                tbuf_list  = tbuf;
 
-            ++num_acquired;
+                ++num_acquired;
+            }
+
+            c->set(tbuf_attr, Variant(cali_make_variant_from_ptr(tbuf)));
         }
 
         return tbuf;
@@ -106,7 +198,7 @@ class Trace
 
         case BufferPolicy::Grow:
             {
-                TraceBufferChunk* newchunk = new TraceBufferChunk(buffersize);
+                TraceBufferChunk* newchunk = get_chunk();
 
                 if (!newchunk) {
                     Log(0).stream() << "Trace: error: unable to allocate new trace buffer. Recording stopped."
@@ -125,7 +217,40 @@ class Trace
             {
                 Log(1).stream() << chn->name() << ": Trace buffer full: flushing." << std::endl;
 
+                // flush_cb stops our own buffer too, so don't hold it
+                tbuf->writing.store(false);
                 c->flush_and_write(chn, SnapshotView());
+                tbuf->writing.store(true);
+
+                return tbuf->stopped.load() ? 0 : tbuf;
+            }
+
+        case BufferPolicy::Spill:
+            {
+                //   Swap in a spare chunk and hand the full one to the
+                // spill file's writer thread. We must not block or allocate
+                // memory here, so if there is no spare chunk, the writer
+                // queue is full, or we're in a signal handler, we drop the
+                // snapshot and keep the full chunk.
+                if (c->is_signal()) {
+                    ++spill_dropped;
+                    return 0;
+                }
+
+                TraceBufferChunk* spare = get_free_chunk();
+
+                if (!spare) {
+                    ++spill_dropped;
+                    return 0;
+                }
+
+                if (!spill_file->submit(tbuf->chunks)) {
+                    recycle_chunks(spare);
+                    ++spill_dropped;
+                    return 0;
+                }
+
+                tbuf->chunks = spare;
 
                 return tbuf;
             }
@@ -139,17 +264,29 @@ class Trace
     {
         TraceBuffer* tbuf = acquire_tbuf(c, chn, !c->is_signal());
 
-        if (!tbuf || tbuf->stopped.load()) {
+        if (!tbuf) {
             ++dropped_snapshots;
             return;
         }
 
-        if (!tbuf->chunks->fits(rec))
-            tbuf = handle_overflow(c, chn, tbuf);
-        if (!tbuf)
+        //   Flush and clear set the stopped flag and then wait for the
+        // writing flag to be cleared before they touch the chunks
+        tbuf->writing.store(true);
+
+        if (tbuf->stopped.load()) {
+            tbuf->writing.store(false);
+            ++dropped_snapshots;
             return;
+        }
+
+        TraceBuffer* wbuf = tbuf;
 
-        tbuf->chunks->save_snapshot(rec);
+        if (!wbuf->chunks->fits(rec))
+            wbuf = handle_overflow(c, chn, wbuf);
+        if (wbuf)
+            wbuf->chunks->save_snapshot(rec);
+
+        tbuf->writing.store(false);
     }
 
     void flush_cb(Caliper* c, Channel* chn, SnapshotFlushFn proc_fn)
@@ -166,14 +303,39 @@ class Trace
 
         size_t num_written = 0;
 
-        for (; tbuf; tbuf = tbuf->next) {
-            // Stop tracing while we flush: writers won't block
-            // but just drop the snapshot
+        if (spill_file) {
+            //   Hand the in-memory chunks to the spill file too, so all
+            // data recorded up to now is in the spill file and the flushed
+            // segments can be removed on clear. Each buffer is stopped
+            // while we swap out its chunk.
+            for (; tbuf; tbuf = tbuf->next) {
+                tbuf->stop();
 
-            tbuf->stopped.store(true);
+                if (tbuf->chunks->num_records() > 0) {
+                    TraceBufferChunk* full = tbuf->chunks;
+                    tbuf->chunks           = get_chunk();
 
-            num_written += tbuf->chunks->flush(c, proc_fn);
-            tbuf->stopped.store(false);
+                    spill_file->submit_wait(full);
+                }
+
+                tbuf->stopped.store(false);
+            }
+
+            // SpillFile::flush() waits until all chunks submitted so far
+            // have been written
+            TraceBufferChunk* scratch = get_chunk();
+            num_written += spill_file->flush(c, proc_fn, scratch);
+            recycle_chunks(scratch);
+        } else {
+            for (; tbuf; tbuf = tbuf->next) {
+                // Stop tracing while we flush: writers won't block
+                // but just drop the snapshot
+
+                tbuf->stop();
+
+                num_written += tbuf->chunks->flush(c, proc_fn);
+                tbuf->stopped.store(false);
+            }
         }
 
         Log(1).stream() << chn->name() << ": Trace: Flushed " << num_written << " snapshots." << std::endl;
@@ -191,10 +353,19 @@ class Trace
             tbuf = tbuf_list;
         }
 
-        TraceBufferChunk::UsageInfo aggregate_info { 0, 0, 0 };
+        TraceBufferChunk::UsageInfo aggregate_info { 0, 0, 0, 0 };
+
+        SpillFile::Stats spill_stats { 0, 0, 0 };
+
+        //   Only the segments written out by the last flush are removed.
+        // Chunks spilled since then are kept for the next flush.
+        if (spill_file) {
+            spill_stats = spill_file->stats();
+            spill_file->clear();
+        }
 
         while (tbuf) {
-            tbuf->stopped.store(true);
+            tbuf->stop();
 
             // Accumulate usage statistics before they're reset
             TraceBufferChunk::UsageInfo info = tbuf->chunks->info();
@@ -202,40 +373,58 @@ class Trace
             aggregate_info.nchunks += info.nchunks;
             aggregate_info.reserved += info.reserved;
             aggregate_info.used += info.used;
+            aggregate_info.huge += info.huge;
 
-            tbuf->chunks->reset();
+            recycle_chunks(tbuf->chunks->reset());
 
             tbuf->stopped.store(false);
 
-            if (tbuf->retired.load()) {
-                // delete retired thread's trace buffer
-                TraceBuffer* tmp = tbuf->next;
+            TraceBuffer* tmp     = tbuf->next;
+            bool         release = false;
 
-                {
-                    std::lock_guard<util::spinlock> g(tbuf_lock);
+            if (tbuf->retired.load()) {
+                // delete retired thread's trace buffer, unless a new thread
+                // has picked it up in the meantime
+                std::lock_guard<util::spinlock> g(tbuf_lock);
 
+                if (tbuf->retired.load()) {
                     tbuf->unlink();
 
                     if (tbuf == tbuf_list)
                         tbuf_list = tmp;
 
                     ++num_released;
+                    release = true;
                 }
+            }
 
+            if (release) {
+                recycle_chunks(tbuf->chunks);
+                tbuf->chunks = nullptr;
                 delete tbuf;
-                tbuf = tmp;
-            } else {
-                tbuf = tbuf->next;
             }
+
+            tbuf = tmp;
         }
 
         if (Log::verbosity() > 1) {
             unitfmt_result bytes_reserved = unitfmt(aggregate_info.reserved, unitfmt_bytes);
             unitfmt_result bytes_used     = unitfmt(aggregate_info.used, unitfmt_bytes);
+            unitfmt_result bytes_huge     = unitfmt(aggregate_info.huge, unitfmt_bytes);
 
             Log(2).stream() << chn->name() << ": Trace: " << bytes_reserved.val << " " << bytes_reserved.symbol
                             << " reserved, " << bytes_used.val << " " << bytes_used.symbol << " used, "
-                            << aggregate_info.nchunks << " chunks." << std::endl;
+                            << aggregate_info.nchunks << " chunks, " << bytes_huge.val << " " << bytes_huge.symbol
+                            << " in huge pages." << std::endl;
+
+            if (spill_file) {
+                unitfmt_result bytes_spilled = unitfmt(spill_stats.bytes, unitfmt_bytes);
+
+                Log(2).stream() << chn->name() << ": Trace: " << spill_stats.chunks << " chunks ("
+                                << bytes_spilled.val << " " << bytes_spilled.symbol << ") spilled to disk, "
+                                << spill_stats.errors << " write errors, " << spill_dropped.load()
+                                << " snapshots dropped." << std::endl;
+            }
         }
     }
 
@@ -243,7 +432,8 @@ class Trace
     {
         const std::map<std::string, BufferPolicy> polmap { { "grow", BufferPolicy::Grow },
                                                            { "flush", BufferPolicy::Flush },
-                                                           { "stop", BufferPolicy::Stop } };
+                                                           { "stop", BufferPolicy::Stop },
+                                                           { "spill", BufferPolicy::Spill } };
 
         auto it = polmap.find(polname);
 
@@ -276,20 +466,52 @@ class Trace
     {
         if (dropped_snapshots > 0)
             Log(1).stream() << chn->name() << ": Trace: dropped " << dropped_snapshots << " snapshots." << std::endl;
+        if (spill_dropped.load() > 0)
+            Log(1).stream() << chn->name() << ": Trace: dropped " << spill_dropped.load()
+                            << " snapshots because no chunk could be spilled." << std::endl;
         if (Log::verbosity() >= 2)
             Log(2).stream() << chn->name() << ": Trace: " << num_acquired << " thread trace buffers acquired, "
-                            << num_retired << " retired, " << num_released << " released." << std::endl;
+                            << num_retired << " retired, " << num_reused << " reused, " << num_released
+                            << " released." << std::endl;
     }
 
-    Trace(Caliper* c, Channel* chn) : dropped_snapshots(0)
+    Trace(Caliper* c, Channel* chn) : dropped_snapshots(0), spill_dropped(0)
     {
         tbuf_lock.unlock();
+        free_chunks_lock.unlock();
         flush_lock.unlock();
 
         ConfigSet cfg = services::init_config_from_spec(chn->config(), s_spec);
 
         init_overflow_policy(cfg.get("buffer_policy").to_string());
-        buffersize = cfg.get("buffer_size").to_uint() * 1024 * 1024;
+        buffersize     = cfg.get("buffer_size").to_uint() * 1024 * 1024;
+        delta_encoding = cfg.get("delta_encoding").to_bool();
+
+        bool        ok  = true;
+        std::string str = cfg.get("hugepages").to_string();
+        hugepages       = util::parse_hugepages(str, &ok);
+
+        if (!ok)
+            Log(0).stream() << chn->name() << ": Trace: error: unknown huge page policy \"" << str << "\"" << std::endl;
+
+        if (policy == BufferPolicy::Spill) {
+            spill_file.reset(new SpillFile(cfg.get("spill_directory").to_string(), [this](TraceBufferChunk* chunk) {
+                recycle_chunks(chunk);
+            }));
+
+            if (!spill_file->is_open()) {
+                Log(0).stream() << chn->name() << ": Trace: cannot spill to disk, using \"grow\" buffer policy"
+                                << std::endl;
+                spill_file.reset();
+                policy = BufferPolicy::Grow;
+            } else {
+                //   Pre-allocate spare chunks to swap in for full ones in the
+                // snapshot path: enough for every chunk the writer can hold
+                // (the queued ones plus the one being written)
+                for (size_t i = 0; i <= SpillFile::max_pending; ++i)
+                    recycle_chunks(new TraceBufferChunk(buffersize, hugepages, delta_encoding));
+            }
+        }
 
         tbuf_attr = c->create_attribute(
             std::string("trace.tbuf.") + std::to_string(chn->id()),
@@ -304,6 +526,9 @@ public:
 
     ~Trace()
     {
+        // stop the spill file writer before releasing the chunks
+        spill_file.reset();
+
         // clear all trace buffers
         for (TraceBuffer *tbuf = tbuf_list, *tmp = nullptr; tbuf; tbuf = tmp) {
             tmp = tbuf->next;
@@ -311,6 +536,8 @@ public:
         }
 
         tbuf_list = nullptr;
+
+        delete free_chunks;
     }
 
     static void trace_register(Caliper* c, Channel* chn)
@@ -357,9 +584,23 @@ const char* Trace::s_spec = R"json(
   "value": "2"
  },{
   "name": "buffer_policy",
-  "description": "What to do when the buffer is full ('flush', 'stop', 'grow')",
+  "description": "What to do when the buffer is full ('flush', 'stop', 'grow', 'spill')",
   "type": "string",
   "value": "grow"
+ },{
+  "name": "delta_encoding",
+  "description": "Encode trace records as differences to the previous record to save buffer space",
+  "type": "bool",
+  "value": "true"
+ },{
+  "name": "spill_directory",
+  "description": "Directory for the temporary file used by the 'spill' buffer policy. Default: $TMPDIR or /tmp",
+  "type": "string"
+ },{
+  "name": "hugepages",
+  "description": "Huge page policy for trace buffers ('none', 'thp', 'explicit')",
+  "type": "string",
+  "value": "none"
  }
 ]}
 )json";
@@ -11,12 +11,57 @@
 
 #include "../../common/util/vlenc.h"
 
+#include <new>
+
 using namespace trace;
 using namespace cali;
 
+namespace
+{
+
+//   Delta encoding entry tags. The lower two bits select the operation, the
+// upper bits hold the index of the matching entry in the dictionary.
+// Delta operations are followed by the zigzag-encoded difference.
+enum DeltaOp : uint64_t {
+    SameEntry  = 0, // unchanged from dictionary entry
+    NodeDelta  = 1, // reference entry with the same attribute, node id difference follows
+    ValueDelta = 2, // immediate entry of same attribute and type, value difference follows
+    FullEntry  = 3  // packed entry follows
+};
+
+inline uint64_t zigzag_enc(uint64_t d)
+{
+    return (d << 1) ^ (0 - (d >> 63));
+}
+
+inline uint64_t zigzag_dec(uint64_t z)
+{
+    return (z >> 1) ^ (0 - (z & 1));
+}
+
+inline bool is_match(const Entry& e, const Entry& prev)
+{
+    if (e.is_reference())
+        return prev.is_reference() && e.node()->attribute() == prev.node()->attribute();
+
+    return e.node() == prev.node()
+           && e.value().c_variant().type_and_size == prev.value().c_variant().type_and_size;
+}
+
+} // namespace
+
+TraceBufferChunk::TraceBufferChunk(size_t s, util::HugePages hugepages, bool delta)
+    : m_size(s), m_pos(0), m_nrec(0), m_block(util::page_alloc(s, hugepages)), m_delta(delta), m_dict_size(0), m_next(0)
+{
+    if (!m_block.ptr)
+        throw std::bad_alloc();
+
+    m_data = static_cast<unsigned char*>(m_block.ptr);
+}
+
 TraceBufferChunk::~TraceBufferChunk()
 {
-    delete[] m_data;
+    util::page_free(m_block);
 
     if (m_next)
         delete m_next;
@@ -30,15 +75,32 @@ void TraceBufferChunk::append(TraceBufferChunk* chunk)
         m_next = chunk;
 }
 
-void TraceBufferChunk::reset()
+TraceBufferChunk* TraceBufferChunk::reset()
 {
+    //   The old buffer contents are left in place: flush() only decodes
+    // the first m_nrec records, and new records overwrite the old data.
     m_pos  = 0;
     m_nrec = 0;
 
-    memset(m_data, 0, m_size);
+    m_dict_size = 0;
+
+    TraceBufferChunk* ret = m_next;
+    m_next                = 0;
 
-    delete m_next;
-    m_next = 0;
+    return ret;
+}
+
+unsigned char* TraceBufferChunk::assign(size_t bytes, size_t nrec)
+{
+    if (bytes > m_size)
+        return nullptr;
+
+    m_pos  = bytes;
+    m_nrec = nrec;
+
+    m_dict_size = 0;
+
+    return m_data;
 }
 
 size_t TraceBufferChunk::flush(Caliper* c, SnapshotFlushFn proc_fn)
@@ -49,20 +111,26 @@ size_t TraceBufferChunk::flush(Caliper* c, SnapshotFlushFn proc_fn)
     // local flush
     //
 
-    size_t p = 0;
-
-    for (size_t r = 0; r < m_nrec; ++r) {
-        // decode snapshot record
+    if (m_delta) {
+        flush_delta(c, proc_fn);
+    } else {
         std::vector<Entry> rec;
 
-        uint64_t n = vldec_u64(m_data + p, &p);
-        rec.reserve(n);
+        size_t p = 0;
 
-        while (n-- > 0)
-            rec.push_back(Entry::unpack(*c, m_data + p, &p));
+        for (size_t r = 0; r < m_nrec; ++r) {
+            // decode snapshot record
+            uint64_t n = vldec_u64(m_data + p, &p);
 
-        // write snapshot
-        proc_fn(*c, rec);
+            rec.clear();
+            rec.reserve(n);
+
+            while (n-- > 0)
+                rec.push_back(Entry::unpack(*c, m_data + p, &p));
+
+            // write snapshot
+            proc_fn(*c, rec);
+        }
     }
 
     written += m_nrec;
@@ -77,11 +145,109 @@ size_t TraceBufferChunk::flush(Caliper* c, SnapshotFlushFn proc_fn)
     return written;
 }
 
+void TraceBufferChunk::flush_delta(Caliper* c, SnapshotFlushFn proc_fn)
+{
+    // rebuild the dictionary the same way save_snapshot_delta() did
+    std::vector<Entry> dict;
+    std::vector<Entry> rec;
+
+    dict.reserve(max_dict_size);
+
+    size_t p = 0;
+
+    for (size_t r = 0; r < m_nrec; ++r) {
+        uint64_t n = vldec_u64(m_data + p, &p);
+
+        rec.clear();
+        rec.reserve(n);
+
+        for (uint64_t i = 0; i < n; ++i) {
+            uint64_t tag = vldec_u64(m_data + p, &p);
+            uint64_t op  = tag & 3;
+
+            if (op == FullEntry) {
+                rec.push_back(Entry::unpack(*c, m_data + p, &p));
+
+                if (dict.size() < max_dict_size)
+                    dict.push_back(rec.back());
+
+                continue;
+            }
+
+            Entry& de = dict[tag >> 2];
+
+            if (op == NodeDelta) {
+                uint64_t d = zigzag_dec(vldec_u64(m_data + p, &p));
+                de         = Entry(c->node(de.node()->id() + d));
+            } else if (op == ValueDelta) {
+                cali_variant_t v = de.value().c_variant();
+                v.value.v_uint += zigzag_dec(vldec_u64(m_data + p, &p));
+                de = Entry(Attribute::make_attribute(de.node()), Variant(v));
+            }
+
+            rec.push_back(de);
+        }
+
+        proc_fn(*c, rec);
+    }
+}
+
+void TraceBufferChunk::save_snapshot_delta(SnapshotView s)
+{
+    m_pos += vlenc_u64(s.size(), m_data + m_pos);
+
+    for (const Entry& e : s) {
+        //   Find the dictionary entry for this attribute, i.e. the last
+        // entry seen for it in this chunk.
+        size_t j = 0;
+
+        while (j < m_dict_size && !is_match(e, m_dict[j]))
+            ++j;
+
+        if (j < m_dict_size) {
+            const Entry& de = m_dict[j];
+
+            uint64_t op = SameEntry;
+            uint64_t d  = 0;
+
+            if (e.is_reference()) {
+                d  = zigzag_enc(e.node()->id() - de.node()->id());
+                op = NodeDelta;
+            } else {
+                d  = zigzag_enc(e.value().c_variant().value.v_uint - de.value().c_variant().value.v_uint);
+                op = ValueDelta;
+            }
+
+            if (d == 0)
+                op = SameEntry;
+
+            m_pos += vlenc_u64((j << 2) | op, m_data + m_pos);
+
+            if (op != SameEntry) {
+                m_pos += vlenc_u64(d, m_data + m_pos);
+                m_dict[j] = e;
+            }
+        } else {
+            m_pos += vlenc_u64(FullEntry, m_data + m_pos);
+            m_pos += e.pack(m_data + m_pos);
+
+            if (m_dict_size < max_dict_size)
+                m_dict[m_dict_size++] = e;
+        }
+    }
+}
+
 void TraceBufferChunk::save_snapshot(SnapshotView s)
 {
     if (s.empty())
         return;
 
+    if (m_delta) {
+        save_snapshot_delta(s);
+        ++m_nrec;
+        return;
+    }
+
     m_pos += vlenc_u64(s.size(), m_data + m_pos);
 
     for (const Entry& e : s)
@@ -96,14 +262,16 @@ bool TraceBufferChunk::fits(SnapshotView rec) const
     //   10 bytes for size indicator
     //   n times Entry max size for data
 
-    size_t max = 10 + rec.size() * Entry::MAX_PACKED_SIZE;
+    //   Delta encoding adds up to 10 bytes per entry for the tag word
+
+    size_t max = 10 + rec.size() * (Entry::MAX_PACKED_SIZE + (m_delta ? 10 : 0));
 
     return (m_pos + max) < m_size;
 }
 
 TraceBufferChunk::UsageInfo TraceBufferChunk::info() const
 {
-    UsageInfo info { 0, 0, 0 };
+    UsageInfo info { 0, 0, 0, 0 };
 
     if (m_next)
         info = m_next->info();
@@ -112,5 +280,8 @@ TraceBufferChunk::UsageInfo TraceBufferChunk::info() const
     info.reserved += m_size;
     info.used += m_pos;
 
+    if (m_block.is_huge)
+        info.huge += m_block.size;
+
     return info;
 }
@@ -6,7 +6,10 @@
 #include "caliper/Caliper.h"
 #include "caliper/SnapshotRecord.h"
 
+#include "../../common/util/page_alloc.h"
+
 #include <cstring>
+#include <vector>
 
 namespace trace
 {
@@ -16,21 +19,59 @@ class TraceBufferChunk
     size_t m_pos;
     size_t m_nrec;
 
-    unsigned char* m_data;
+    util::PageBlock m_block;
+    unsigned char*  m_data;
+
+    //   With delta encoding, entries are encoded relative to the last entry
+    // for the same attribute in this chunk, which is kept in a small
+    // dictionary. Unchanged entries take a single byte, and node ids and
+    // immediate values are stored as differences. The dictionary is a
+    // fixed-size array so that writing snapshots doesn't allocate memory.
+    static constexpr size_t max_dict_size = 64;
+
+    bool        m_delta;
+    cali::Entry m_dict[max_dict_size];
+    size_t      m_dict_size;
 
     TraceBufferChunk* m_next;
 
+    void save_snapshot_delta(cali::SnapshotView s);
+    void flush_delta(cali::Caliper* c, cali::SnapshotFlushFn proc_fn);
+
 public:
 
-    TraceBufferChunk(size_t s) : m_size(s), m_pos(0), m_nrec(0), m_data(new unsigned char[s]), m_next(0) {}
+    /// \brief Create a trace buffer chunk of \a s bytes. The buffer pages
+    ///   are placed on the NUMA node of the thread that writes to them first.
+    ///   Throws std::bad_alloc if the allocation fails.
+    TraceBufferChunk(size_t s, util::HugePages hugepages = util::HugePages::None, bool delta = false);
 
     ~TraceBufferChunk();
 
     void append(TraceBufferChunk* chunk);
-    void reset();
+
+    /// \brief Clear this chunk's contents and detach the chunks appended
+    ///   to it.
+    ///
+    /// The buffer memory is not zeroed. Returns the detached chunk list
+    /// (still holding their old contents); the caller takes ownership.
+    TraceBufferChunk* reset();
 
     size_t flush(cali::Caliper* c, cali::SnapshotFlushFn proc_fn);
 
+    /// \brief Number of records in this chunk
+    size_t num_records() const { return m_nrec; }
+    /// \brief Number of bytes used in this chunk
+    size_t used() const { return m_pos; }
+    /// \brief The packed record data
+    const unsigned char* data() const { return m_data; }
+
+    /// \brief Prepare the chunk to take \a bytes of packed record data with
+    ///   \a nrec records from an external source, e.g. a spill file.
+    ///
+    /// \return The buffer to copy the data into, or \c nullptr if the data
+    ///   does not fit.
+    unsigned char* assign(size_t bytes, size_t nrec);
+
     void save_snapshot(cali::SnapshotView s);
     bool fits(cali::SnapshotView s) const;
 
@@ -38,6 +79,7 @@ public:
         size_t nchunks;
         size_t reserved;
         size_t used;
+        size_t huge; ///< bytes in explicit huge pages
     };
 
     UsageInfo info() const;
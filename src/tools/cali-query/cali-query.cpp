@@ -18,6 +18,7 @@
 #include "caliper/reader/CaliperMetadataDB.h"
 #include "caliper/reader/FormatProcessor.h"
 #include "caliper/reader/Preprocessor.h"
+#include "caliper/reader/RecordLimiter.h"
 #include "caliper/reader/RecordProcessor.h"
 #include "caliper/reader/RecordSelector.h"
 
@@ -280,11 +281,12 @@ int main(int argc, const char* argv[])
         return;
     };
 
-    Aggregator aggregate(spec);
+    Aggregator    aggregate(spec);
+    RecordLimiter limiter(spec);
 
     if (!args.is_set("list-globals")) {
         if (spec.aggregate.selection == QuerySpec::AggregationSelection::None)
-            snap_proc = format;
+            snap_proc = limiter.is_active() ? SnapshotProcessFn(limiter) : SnapshotProcessFn(format);
         else
             snap_proc = aggregate;
 
@@ -394,7 +396,13 @@ int main(int argc, const char* argv[])
         global_format.process_record(metadb, metadb.get_globals());
         global_format.flush(metadb);
     } else {
-        aggregate.flush(metadb, format);
+        if (limiter.is_active()) {
+            aggregate.flush(metadb, limiter);
+            limiter.flush(metadb, format);
+        } else {
+            aggregate.flush(metadb, format);
+        }
+
         format.flush(metadb);
     }
 
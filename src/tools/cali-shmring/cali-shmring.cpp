@@ -0,0 +1,539 @@
+// Copyright (c) 2015-2024, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+// Consumer for the shmring service: reads snapshots from the shared-memory
+// ring buffers of one or more processes and processes them with a CalQL
+// query
+
+#include "../util/Args.h"
+
+#include "../../common/CompressedSnapshotRecord.h"
+#include "../../services/shmring/ShmRingFormat.h"
+
+#include "caliper/cali.h"
+
+#include "caliper/reader/CalQLParser.h"
+#include "caliper/reader/CaliperMetadataDB.h"
+#include "caliper/reader/QueryProcessor.h"
+
+#include "caliper/common/Node.h"
+#include "caliper/common/OutputStream.h"
+#include "caliper/common/StringConverter.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cali;
+using namespace util;
+
+namespace
+{
+
+const char* usage = "cali-shmring [OPTION]..."
+                    "\n  Read and process snapshots written by the Caliper shmring service";
+
+const char* default_query = "aggregate count(),sum(time.duration.ns) group by path,mpi.rank format cali";
+
+const Args::Table option_table[] = {
+    // name, longopt name, shortopt char, has argument, info, argument info
+    { "directory", "directory", 'd', true, "Directory with the shared-memory segments. Default: /dev/shm", "DIR" },
+    { "query", "query", 'q', true, "CalQL query applied to the snapshots", "QUERY" },
+    { "processes", "processes", 'n', true, "Exit after NUM processes have finished", "NUM" },
+    { "timeout",
+      "timeout",
+      't',
+      true,
+      "Detach from processes that wrote nothing for SEC seconds, and exit if no process is active for SEC seconds",
+      "SEC" },
+    { "output", "output", 'o', true, "Set the output file name", "FILE" },
+    { "help", "help", 'h', false, "Print help message", nullptr },
+    Args::Terminator
+};
+
+// Extra zero bytes after each message so the unchecked snapshot record
+// decoder can't read past the end of the buffer
+const size_t msg_padding = 64;
+
+/// \brief A producer process's shared-memory segment
+struct Segment {
+    std::string             path;
+    int                     fd;
+    void*                   ptr;
+    size_t                  size;
+    shmring::SegmentHeader* hdr;
+    IdMap                   idmap;
+    size_t                  num_records;
+
+    std::chrono::steady_clock::time_point last_activity;
+};
+
+/// \brief Decodes ring messages (see ShmRingFormat.h) into the metadata DB
+///   and the query processor
+class MessageDecoder
+{
+    const unsigned char* m_buf;
+    size_t               m_size;
+    size_t               m_pos;
+    bool                 m_ok;
+
+    CaliperMetadataDB& m_db;
+    Segment&           m_seg;
+
+    uint64_t get_u64()
+    {
+        uint64_t val = 0;
+
+        for (unsigned shift = 0; m_ok; shift += 7) {
+            if (m_pos >= m_size || shift > 63) {
+                m_ok = false;
+                break;
+            }
+
+            unsigned char c = m_buf[m_pos++];
+            val |= static_cast<uint64_t>(c & 0x7F) << shift;
+
+            if (!(c & 0x80))
+                break;
+        }
+
+        return val;
+    }
+
+    cali_id_t map_id(cali_id_t id) const
+    {
+        auto it = m_seg.idmap.find(id);
+        return it == m_seg.idmap.end() ? id : it->second;
+    }
+
+    void read_node()
+    {
+        cali_id_t      id     = get_u64();
+        uint64_t       parent = get_u64();
+        cali_id_t      attr   = get_u64();
+        cali_attr_type type   = static_cast<cali_attr_type>(get_u64());
+
+        cali_id_t prnt_id = parent > 0 ? parent - 1 : CALI_INV_ID;
+
+        if (!m_ok || !m_db.get_attribute(map_id(attr)) || (parent > 0 && !m_db.node(map_id(prnt_id)))) {
+            m_ok = false;
+            return;
+        }
+
+        if (type == CALI_TYPE_STRING) {
+            uint64_t len = get_u64();
+
+            if (!m_ok || len > m_size - m_pos) {
+                m_ok = false;
+                return;
+            }
+
+            std::string str(reinterpret_cast<const char*>(m_buf + m_pos), len);
+            m_pos += len;
+
+            m_db.merge_node(id, attr, prnt_id, str, m_seg.idmap);
+        } else if (type == CALI_TYPE_USR) {
+            m_db.merge_node(id, attr, prnt_id, Variant(CALI_TYPE_USR, nullptr, 0), m_seg.idmap);
+        } else {
+            bool    ok  = false;
+            Variant val = Variant::unpack(m_buf + m_pos, &m_pos, &ok);
+
+            if (!ok || val.empty() || m_pos > m_size) {
+                m_ok = false;
+                return;
+            }
+
+            m_db.merge_node(id, attr, prnt_id, val, m_seg.idmap);
+        }
+    }
+
+    bool read_record(CompressedSnapshotRecordView& view)
+    {
+        view = CompressedSnapshotRecordView(m_buf + m_pos, &m_pos);
+
+        if (m_pos > m_size)
+            m_ok = false;
+
+        return m_ok;
+    }
+
+    void read_snapshot(QueryProcessor& proc)
+    {
+        CompressedSnapshotRecordView view;
+
+        if (!read_record(view))
+            return;
+
+        std::vector<cali_id_t> node_ids(view.num_nodes());
+        std::vector<cali_id_t> attr_ids(view.num_immediates());
+        std::vector<Variant>   values(view.num_immediates());
+
+        view.unpack_nodes(node_ids.size(), node_ids.data());
+        view.unpack_immediate(attr_ids.size(), attr_ids.data(), values.data());
+
+        for (cali_id_t id : node_ids)
+            if (!m_db.node(map_id(id))) {
+                m_ok = false;
+                return;
+            }
+        for (cali_id_t id : attr_ids)
+            if (!m_db.get_attribute(map_id(id))) {
+                m_ok = false;
+                return;
+            }
+
+        EntryList rec = m_db.merge_snapshot(
+            node_ids.size(),
+            node_ids.data(),
+            attr_ids.size(),
+            attr_ids.data(),
+            values.data(),
+            m_seg.idmap
+        );
+
+        proc.process_record(m_db, rec);
+
+        ++m_seg.num_records;
+    }
+
+    void read_globals()
+    {
+        CompressedSnapshotRecordView view;
+
+        if (!read_record(view))
+            return;
+
+        std::vector<cali_id_t> node_ids(view.num_nodes());
+        std::vector<cali_id_t> attr_ids(view.num_immediates());
+        std::vector<Variant>   values(view.num_immediates());
+
+        view.unpack_nodes(node_ids.size(), node_ids.data());
+        view.unpack_immediate(attr_ids.size(), attr_ids.data(), values.data());
+
+        for (cali_id_t id : node_ids)
+            m_db.merge_global(id, m_seg.idmap);
+        for (size_t i = 0; i < attr_ids.size(); ++i)
+            m_db.merge_global(attr_ids[i], values[i].to_string(), m_seg.idmap);
+    }
+
+public:
+
+    MessageDecoder(const unsigned char* buf, size_t size, CaliperMetadataDB& db, Segment& seg)
+        : m_buf(buf), m_size(size), m_pos(0), m_ok(true), m_db(db), m_seg(seg)
+    {}
+
+    bool read(QueryProcessor& proc)
+    {
+        while (m_ok && m_pos < m_size) {
+            switch (m_buf[m_pos++]) {
+            case shmring::NodeItem:
+                read_node();
+                break;
+            case shmring::SnapshotItem:
+                read_snapshot(proc);
+                break;
+            case shmring::GlobalsItem:
+                read_globals();
+                break;
+            default:
+                m_ok = false;
+            }
+        }
+
+        return m_ok;
+    }
+};
+
+bool attach(const std::string& path, Segment& seg)
+{
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+
+    if (fd < 0) {
+        std::cerr << "cali-shmring: open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < shmring::header_size) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void*  ptr  = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (ptr == MAP_FAILED) {
+        std::cerr << "cali-shmring: mmap " << path << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+
+    shmring::SegmentHeader* hdr = static_cast<shmring::SegmentHeader*>(ptr);
+
+    bool ok = std::memcmp(hdr->magic, shmring::magic, sizeof(shmring::magic)) == 0 && hdr->version == shmring::version
+              && hdr->ring_size > 0 && (hdr->ring_size & (hdr->ring_size - 1)) == 0
+              && shmring::segment_size(hdr->num_rings, hdr->ring_size) == size;
+
+    if (!ok) {
+        std::cerr << "cali-shmring: " << path << ": not a valid shmring segment" << std::endl;
+        munmap(ptr, size);
+        close(fd);
+        return false;
+    }
+
+    hdr->attached.store(1, std::memory_order_release);
+
+    seg.path        = path;
+    seg.fd          = fd;
+    seg.ptr         = ptr;
+    seg.size        = size;
+    seg.hdr         = hdr;
+    seg.num_records   = 0;
+    seg.last_activity = std::chrono::steady_clock::now();
+
+    return true;
+}
+
+/// \brief Check if the segment's producer process still exists
+bool producer_alive(const Segment& seg)
+{
+    return kill(static_cast<pid_t>(seg.hdr->pid), 0) == 0 || errno != ESRCH;
+}
+
+void detach(Segment& seg, bool remove)
+{
+    uint64_t num_dropped = 0;
+
+    for (uint32_t i = 0; i < seg.hdr->num_rings; ++i)
+        num_dropped += shmring::ring_header(seg.ptr, i)->num_dropped.load(std::memory_order_relaxed);
+
+    if (num_dropped > 0)
+        std::cerr << "cali-shmring: process " << seg.hdr->pid << ": " << num_dropped
+                  << " messages were dropped because the ring buffer was full" << std::endl;
+
+    munmap(seg.ptr, seg.size);
+    close(seg.fd);
+
+    if (remove)
+        unlink(seg.path.c_str());
+}
+
+/// \brief Process all messages in the segment's rings. Returns the number
+///   of messages read.
+size_t drain(Segment& seg, CaliperMetadataDB& db, QueryProcessor& proc, std::vector<unsigned char>& buf)
+{
+    size_t   count     = 0;
+    uint32_t num_rings = std::min(seg.hdr->num_used.load(std::memory_order_acquire), seg.hdr->num_rings);
+    uint64_t ring_size = seg.hdr->ring_size;
+
+    for (uint32_t i = 0; i < num_rings; ++i) {
+        shmring::RingHeader* ring = shmring::ring_header(seg.ptr, i);
+        unsigned char*       data = shmring::ring_data(seg.ptr, seg.hdr->num_rings, ring_size, i);
+
+        uint64_t r = ring->read_pos.load(std::memory_order_relaxed);
+        uint64_t w = ring->write_pos.load(std::memory_order_acquire);
+
+        while (w - r >= sizeof(uint32_t)) {
+            uint32_t len = 0;
+            shmring::copy_out(data, ring_size, r, &len, sizeof(len));
+
+            if (len > w - r - sizeof(len)) {
+                std::cerr << "cali-shmring: process " << seg.hdr->pid << ": corrupt ring buffer" << std::endl;
+                r = w;
+                break;
+            }
+
+            buf.assign(len + msg_padding, 0);
+            shmring::copy_out(data, ring_size, r + sizeof(len), buf.data(), len);
+
+            if (!MessageDecoder(buf.data(), len, db, seg).read(proc))
+                std::cerr << "cali-shmring: process " << seg.hdr->pid << ": skipping invalid message" << std::endl;
+
+            r += sizeof(len) + len;
+            ++count;
+        }
+
+        ring->read_pos.store(r, std::memory_order_release);
+    }
+
+    return count;
+}
+
+/// \brief Attach to new segments in \a dir
+void scan_directory(const std::string& dir, std::set<std::string>& seen, std::list<Segment>& segments)
+{
+    DIR* d = opendir(dir.c_str());
+
+    if (!d)
+        return;
+
+    const size_t prefix_len = std::strlen(shmring::file_prefix);
+
+    for (struct dirent* ent = readdir(d); ent; ent = readdir(d)) {
+        if (std::strncmp(ent->d_name, shmring::file_prefix, prefix_len) != 0)
+            continue;
+        if (!seen.insert(ent->d_name).second)
+            continue;
+
+        Segment seg;
+
+        if (attach(dir + "/" + ent->d_name, seg))
+            segments.push_back(std::move(seg));
+    }
+
+    closedir(d);
+}
+
+} // namespace
+
+//
+// --- main()
+//
+
+int main(int argc, const char* argv[])
+{
+    // Don't let Caliper settings for the monitored application apply to
+    // the consumer itself
+    cali_config_allow_read_env(false);
+
+    Args args(::option_table);
+
+    //
+    // --- Parse command line arguments
+    //
+
+    {
+        int i = args.parse(argc, argv);
+
+        if (i < argc) {
+            std::cerr << "cali-shmring: error: unknown option: " << argv[i] << '\n' << "  Available options: ";
+
+            args.print_available_options(std::cerr);
+
+            return -1;
+        }
+
+        if (args.is_set("help")) {
+            std::cerr << usage << "\n\n";
+
+            args.print_available_options(std::cerr);
+
+            return 0;
+        }
+    }
+
+    CalQLParser parser(args.get("query", default_query).c_str());
+
+    if (parser.error()) {
+        std::cerr << "cali-shmring: Invalid query: " << parser.error_msg() << std::endl;
+        return -2;
+    }
+
+    int    num_processes = StringConverter(args.get("processes", "0")).to_int();
+    double timeout_sec   = StringConverter(args.get("timeout", "-1")).to_double();
+
+    std::string dir = args.get("directory", "/dev/shm");
+
+    OutputStream stream;
+
+    if (args.is_set("output"))
+        stream.set_filename(args.get("output").c_str());
+    else
+        stream.set_stream(OutputStream::StdOut);
+
+    CaliperMetadataDB db;
+    QueryProcessor    proc(parser.spec(), stream);
+
+    std::set<std::string>      seen;
+    std::list<Segment>         segments;
+    std::vector<unsigned char> buf;
+
+    int num_finished = 0;
+    int ret          = 0;
+
+    auto last_scan     = std::chrono::steady_clock::time_point();
+    auto last_activity = std::chrono::steady_clock::now();
+
+    auto timeout = std::chrono::duration<double>(timeout_sec);
+
+    while (num_processes <= 0 || num_finished < num_processes) {
+        auto now = std::chrono::steady_clock::now();
+
+        // also check producer liveness at the scan interval
+        bool scan = now - last_scan >= std::chrono::milliseconds(100);
+
+        if (scan) {
+            scan_directory(dir, seen, segments);
+            last_scan = now;
+        }
+
+        size_t count = 0;
+
+        for (auto it = segments.begin(); it != segments.end();) {
+            // read the finished flag and check liveness first so we don't
+            // miss any messages
+            bool finished = it->hdr->finished.load(std::memory_order_acquire) != 0;
+            bool dead     = !finished && scan && !producer_alive(*it);
+
+            size_t n = drain(*it, db, proc, buf);
+            count += n;
+
+            if (n > 0)
+                it->last_activity = now;
+
+            if (finished || dead) {
+                if (dead)
+                    std::cerr << "cali-shmring: process " << it->hdr->pid << " exited without finishing" << std::endl;
+
+                detach(*it, true);
+                it = segments.erase(it);
+                ++num_finished;
+            } else if (timeout_sec >= 0.0 && now - it->last_activity > timeout) {
+                //   The producer is alive but idle (or hung). Leave its
+                // segment for another consumer.
+                std::cerr << "cali-shmring: process " << it->hdr->pid << ": timeout" << std::endl;
+
+                it->hdr->attached.store(0, std::memory_order_release);
+                detach(*it, false);
+                it = segments.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        if (count > 0 || !segments.empty()) {
+            last_activity = now;
+        } else if (timeout_sec >= 0.0 && now - last_activity > timeout) {
+            std::cerr << "cali-shmring: timeout" << std::endl;
+            ret = 1;
+            break;
+        }
+
+        if (count == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // leave segments of processes that are still running for another consumer
+    for (Segment& seg : segments) {
+        seg.hdr->attached.store(0, std::memory_order_release);
+        detach(seg, false);
+    }
+
+    proc.flush(db);
+
+    return ret;
+}
@@ -0,0 +1,475 @@
+// Copyright (c) 2015-2024, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+// A reference collector for the telemetry service: receives profile
+// messages on a Unix domain socket and prints them with a CalQL query
+
+#include "../util/Args.h"
+
+#include "../../services/telemetry/TelemetryFormat.h"
+
+#include "caliper/cali.h"
+
+#include "caliper/reader/CalQLParser.h"
+#include "caliper/reader/CaliperMetadataDB.h"
+#include "caliper/reader/QueryProcessor.h"
+
+#include "caliper/common/Node.h"
+#include "caliper/common/OutputStream.h"
+#include "caliper/common/StringConverter.h"
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace cali;
+using namespace util;
+
+namespace
+{
+
+const char* usage =
+    "cali-telemetry [OPTION]..."
+    "\n  Receive and print profiles sent by the Caliper telemetry service";
+
+const Args::Table option_table[] = {
+    // name, longopt name, shortopt char, has argument, info, argument info
+    { "socket", "socket", 's', true, "Path of the Unix domain socket to listen on", "PATH" },
+    { "query", "query", 'q', true, "CalQL query applied to each profile interval. Default: format expand", "QUERY" },
+    { "processes", "processes", 'n', true, "Exit after NUM processes have sent their final profile", "NUM" },
+    { "timeout", "timeout", 't', true, "Exit if no message arrives for SEC seconds", "SEC" },
+    { "output", "output", 'o', true, "Set the output file name", "FILE" },
+    { "help", "help", 'h', false, "Print help message", nullptr },
+    Args::Terminator
+};
+
+const size_t max_message_size = 256 * 1024;
+
+/// \brief Decodes a telemetry message (see TelemetryFormat.h) into
+///   snapshot records in a metadata DB
+class MessageDecoder
+{
+    const unsigned char* m_buf;
+    size_t               m_size;
+    size_t               m_pos;
+    bool                 m_ok;
+
+    CaliperMetadataDB&               m_db;
+    std::unordered_set<std::string>& m_strings;
+
+    std::vector<Attribute> m_attrs;
+    std::vector<Node*>     m_nodes;
+
+    uint64_t get_u64()
+    {
+        uint64_t val = 0;
+
+        for (unsigned shift = 0; m_ok; shift += 7) {
+            if (m_pos >= m_size || shift > 63) {
+                m_ok = false;
+                break;
+            }
+
+            unsigned char c = m_buf[m_pos++];
+            val |= static_cast<uint64_t>(c & 0x7F) << shift;
+
+            if (!(c & 0x80))
+                break;
+        }
+
+        return val;
+    }
+
+    const char* get_bytes(uint64_t len)
+    {
+        if (!m_ok || len > m_size - m_pos) {
+            m_ok = false;
+            return nullptr;
+        }
+
+        const char* ptr = reinterpret_cast<const char*>(m_buf + m_pos);
+        m_pos += len;
+
+        return ptr;
+    }
+
+    //   Returns the value for the given type. String values point into the
+    // message buffer until they are copied into the DB or string pool.
+    Variant get_value(cali_attr_type type)
+    {
+        switch (type) {
+        case CALI_TYPE_STRING:
+            {
+                uint64_t    len = get_u64();
+                const char* ptr = get_bytes(len);
+
+                if (ptr)
+                    return Variant(CALI_TYPE_STRING, ptr, len);
+            }
+            break;
+        case CALI_TYPE_INT:
+            {
+                int64_t i = telemetry::zigzag_decode(get_u64());
+                return Variant(CALI_TYPE_INT, &i, sizeof(i));
+            }
+        case CALI_TYPE_UINT:
+        case CALI_TYPE_ADDR:
+            {
+                uint64_t u = get_u64();
+                return Variant(type, &u, sizeof(u));
+            }
+        case CALI_TYPE_TYPE:
+            return Variant(static_cast<cali_attr_type>(get_u64()));
+        case CALI_TYPE_BOOL:
+            return Variant(get_u64() != 0);
+        case CALI_TYPE_DOUBLE:
+            {
+                const char* ptr = get_bytes(8);
+
+                if (ptr) {
+                    uint64_t bits = 0;
+                    for (int i = 0; i < 8; ++i)
+                        bits |= static_cast<uint64_t>(static_cast<unsigned char>(ptr[i])) << (8 * i);
+
+                    double d = 0.0;
+                    std::memcpy(&d, &bits, sizeof(d));
+
+                    return Variant(d);
+                }
+            }
+            break;
+        default:
+            m_ok = false;
+        }
+
+        return Variant();
+    }
+
+    const Attribute* get_attribute()
+    {
+        uint64_t idx = get_u64();
+
+        if (idx >= m_attrs.size())
+            m_ok = false;
+
+        return m_ok ? &m_attrs[idx] : nullptr;
+    }
+
+public:
+
+    uint64_t flags;
+    uint64_t pid;
+    uint64_t sequence;
+    uint64_t fragment;
+    uint64_t timestamp_us;
+    uint64_t interval_us;
+
+    MessageDecoder(const unsigned char* buf, size_t size, CaliperMetadataDB& db, std::unordered_set<std::string>& strings)
+        : m_buf(buf),
+          m_size(size),
+          m_pos(0),
+          m_ok(true),
+          m_db(db),
+          m_strings(strings),
+          flags(0),
+          pid(0),
+          sequence(0),
+          fragment(0),
+          timestamp_us(0),
+          interval_us(0)
+    {}
+
+    bool read_header()
+    {
+        if (m_size < 5 || std::memcmp(m_buf, telemetry::magic, 4) != 0 || m_buf[4] != telemetry::version)
+            return false;
+
+        m_pos = 5;
+
+        flags        = get_u64();
+        pid          = get_u64();
+        sequence     = get_u64();
+        fragment     = get_u64();
+        timestamp_us = get_u64();
+        interval_us  = get_u64();
+
+        return m_ok;
+    }
+
+    bool read_records(std::vector<EntryList>& records)
+    {
+        uint64_t num_attrs = get_u64();
+
+        for (uint64_t i = 0; m_ok && i < num_attrs; ++i) {
+            cali_attr_type type = static_cast<cali_attr_type>(get_u64());
+            int            prop = static_cast<int>(get_u64());
+            uint64_t       len  = get_u64();
+            const char*    name = get_bytes(len);
+
+            if (name)
+                m_attrs.push_back(m_db.create_attribute(std::string(name, len), type, prop));
+        }
+
+        uint64_t num_nodes = get_u64();
+
+        for (uint64_t i = 0; m_ok && i < num_nodes; ++i) {
+            uint64_t         parent = get_u64();
+            const Attribute* attr   = get_attribute();
+
+            if (!m_ok || parent > m_nodes.size()) {
+                m_ok = false;
+                break;
+            }
+
+            Variant val = get_value(attr->type());
+
+            if (!m_ok)
+                break;
+
+            Node* parent_node = parent > 0 ? m_nodes[parent - 1] : nullptr;
+            Node* node        = m_db.make_tree_entry(1, attr, &val, parent_node);
+
+            m_nodes.push_back(node ? node : parent_node);
+        }
+
+        uint64_t num_records = get_u64();
+
+        for (uint64_t i = 0; m_ok && i < num_records; ++i) {
+            EntryList rec;
+
+            uint64_t num_refs = get_u64();
+
+            for (uint64_t r = 0; m_ok && r < num_refs; ++r) {
+                uint64_t idx = get_u64();
+
+                if (idx >= m_nodes.size())
+                    m_ok = false;
+                else if (m_nodes[idx])
+                    rec.push_back(Entry(m_nodes[idx]));
+            }
+
+            uint64_t num_imm = get_u64();
+
+            for (uint64_t r = 0; m_ok && r < num_imm; ++r) {
+                const Attribute* attr = get_attribute();
+
+                if (!m_ok)
+                    break;
+
+                Variant val = get_value(attr->type());
+
+                if (val.type() == CALI_TYPE_STRING) {
+                    auto it = m_strings.emplace(static_cast<const char*>(val.data()), val.size()).first;
+                    val     = Variant(CALI_TYPE_STRING, it->data(), it->size());
+                }
+
+                rec.push_back(Entry(*attr, val));
+            }
+
+            if (m_ok)
+                records.push_back(std::move(rec));
+        }
+
+        return m_ok;
+    }
+};
+
+/// \brief Collects the profile records of one sender process
+struct Sender {
+    std::unique_ptr<QueryProcessor> proc;
+    bool                            finished = false;
+};
+
+int open_socket(const std::string& path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "cali-telemetry: socket path " << path << " is too long" << std::endl;
+        return -1;
+    }
+
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+        std::cerr << "cali-telemetry: socket: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+
+    int bufsize = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+    unlink(path.c_str());
+
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "cali-telemetry: bind " << path << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+} // namespace
+
+//
+// --- main()
+//
+
+int main(int argc, const char* argv[])
+{
+    // Don't let Caliper settings for the monitored application apply to
+    // the collector itself
+    cali_config_allow_read_env(false);
+
+    Args args(::option_table);
+
+    //
+    // --- Parse command line arguments
+    //
+
+    {
+        int i = args.parse(argc, argv);
+
+        if (i < argc) {
+            std::cerr << "cali-telemetry: error: unknown option: " << argv[i] << '\n' << "  Available options: ";
+
+            args.print_available_options(std::cerr);
+
+            return -1;
+        }
+
+        if (args.is_set("help")) {
+            std::cerr << usage << "\n\n";
+
+            args.print_available_options(std::cerr);
+
+            return 0;
+        }
+    }
+
+    if (!args.is_set("socket")) {
+        std::cerr << "cali-telemetry: error: no socket path given (use --socket)" << std::endl;
+        return -1;
+    }
+
+    CalQLParser parser(args.get("query", "format expand").c_str());
+
+    if (parser.error()) {
+        std::cerr << "cali-telemetry: Invalid query: " << parser.error_msg() << std::endl;
+        return -2;
+    }
+
+    QuerySpec spec = parser.spec();
+
+    int num_processes = StringConverter(args.get("processes", "0")).to_int();
+    int timeout_ms    = static_cast<int>(StringConverter(args.get("timeout", "-1")).to_double() * 1000.0);
+
+    if (timeout_ms < 0)
+        timeout_ms = -1;
+
+    OutputStream stream;
+
+    if (args.is_set("output"))
+        stream.set_filename(args.get("output").c_str());
+    else
+        stream.set_stream(OutputStream::StdOut);
+
+    std::string path = args.get("socket");
+    int         fd   = ::open_socket(path);
+
+    if (fd < 0)
+        return -2;
+
+    CaliperMetadataDB               db;
+    std::unordered_set<std::string> strings;
+
+    Attribute pid_attr = db.create_attribute("telemetry.pid", CALI_TYPE_UINT, CALI_ATTR_ASVALUE);
+    Attribute seq_attr = db.create_attribute("telemetry.sequence", CALI_TYPE_UINT, CALI_ATTR_ASVALUE);
+    Attribute time_attr = db.create_attribute("telemetry.timestamp", CALI_TYPE_DOUBLE, CALI_ATTR_ASVALUE);
+
+    std::map<uint64_t, Sender> senders;
+    int                        num_finished = 0;
+    int                        ret          = 0;
+
+    std::vector<unsigned char> buf(max_message_size);
+
+    while (num_processes <= 0 || num_finished < num_processes) {
+        pollfd pfd { fd, POLLIN, 0 };
+
+        int n = poll(&pfd, 1, timeout_ms);
+
+        if (n == 0) {
+            std::cerr << "cali-telemetry: timeout" << std::endl;
+            ret = 1;
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+
+            std::cerr << "cali-telemetry: poll: " << std::strerror(errno) << std::endl;
+            ret = -1;
+            break;
+        }
+
+        ssize_t size = recv(fd, buf.data(), buf.size(), 0);
+
+        if (size < 0) {
+            if (errno != EINTR && errno != EAGAIN)
+                std::cerr << "cali-telemetry: recv: " << std::strerror(errno) << std::endl;
+            continue;
+        }
+
+        MessageDecoder         decoder(buf.data(), static_cast<size_t>(size), db, strings);
+        std::vector<EntryList> records;
+
+        if (!decoder.read_header() || !decoder.read_records(records)) {
+            std::cerr << "cali-telemetry: skipping invalid message" << std::endl;
+            continue;
+        }
+
+        Sender& sender = senders[decoder.pid];
+
+        if (!sender.proc)
+            sender.proc.reset(new QueryProcessor(spec, stream));
+
+        EntryList info { Entry(pid_attr, Variant(decoder.pid)),
+                         Entry(seq_attr, Variant(decoder.sequence)),
+                         Entry(time_attr, Variant(1e-6 * decoder.timestamp_us)) };
+
+        for (EntryList& rec : records) {
+            rec.insert(rec.end(), info.begin(), info.end());
+            sender.proc->process_record(db, rec);
+        }
+
+        if (decoder.flags & telemetry::LastFragment) {
+            sender.proc->flush(db);
+            sender.proc.reset();
+        }
+
+        if ((decoder.flags & telemetry::FinalInterval) && !sender.finished) {
+            sender.finished = true;
+            ++num_finished;
+        }
+    }
+
+    close(fd);
+    unlink(path.c_str());
+
+    return ret;
+}
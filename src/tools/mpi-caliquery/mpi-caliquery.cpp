@@ -15,6 +15,7 @@
 #include "caliper/reader/FormatProcessor.h"
 #include "caliper/reader/Preprocessor.h"
 #include "caliper/reader/QuerySpec.h"
+#include "caliper/reader/RecordLimiter.h"
 #include "caliper/reader/RecordProcessor.h"
 #include "caliper/reader/RecordSelector.h"
 
@@ -23,6 +24,9 @@
 #include "caliper/common/StringConverter.h"
 
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace cali;
 using namespace util;
@@ -33,7 +37,8 @@ namespace
 const char* usage =
     "mpi-caliquery [OPTION]... "
     "\n  Read, merge, and filter caliper streams in parallel."
-    "\n  Reads data from <rank>.cali on each MPI rank (i.e., 0.cali, 1.cali, ...)";
+    "\n  Reads data from files 0.cali, 1.cali, ... (by default, one file per MPI rank)."
+    "\n  Files are assigned to ranks dynamically so that differing file sizes are balanced.";
 
 const Args::Table option_table[] = {
     // name, longopt name, shortopt char, has argument, info, argument info
@@ -92,6 +97,13 @@ const Args::Table option_table[] = {
       true,
       "Caliper configuration flags (for cali-query profiling)",
       "KEY=VALUE,..." },
+    { "num-files",
+      "num-files",
+      0,
+      true,
+      "Read this many input files (0.cali ... <num-files - 1>.cali). Default: number of ranks",
+      "NUM_FILES" },
+    { "threads", "threads", 0, true, "Use this many threads per rank to read input files", "THREADS" },
     { "verbose", "verbose", 'v', false, "Be verbose.", nullptr },
     { "help", "help", 'h', true, "Print help message", nullptr },
     { "output", "output", 'o', true, "Set the output file name", "FILE" },
@@ -110,20 +122,110 @@ void format_output(const Args& args, const QuerySpec& spec, CaliperMetadataAcces
         stream.set_stream(OutputStream::StdOut);
 
     FormatProcessor format(spec, stream);
+    RecordLimiter   limiter(spec);
+
+    if (limiter.is_active()) {
+        aggregate.flush(db, limiter);
+        limiter.flush(db, format);
+    } else {
+        aggregate.flush(db, format);
+    }
 
-    aggregate.flush(db, format);
     format.flush(db);
 }
 
-void process_my_input(int rank, const Args& args, const QuerySpec& spec, CaliperMetadataDB& db, Aggregator& aggregate)
+/// \brief Distributes input file indices to ranks on demand
+///
+/// Uses a shared counter on rank 0 that is incremented with MPI one-sided
+/// atomics, so ranks (and threads within a rank) fetch the next file
+/// whenever they are done with the previous one.
+///
+/// Rank 0 reads files itself. Since many MPI implementations only make
+/// progress on passive-target operations while the target is inside MPI,
+/// rank 0 must call progress() regularly while it is busy reading.
+class FileQueue
 {
-    CALI_CXX_MARK_FUNCTION;
+    long*      m_counter;
+    long       m_num_files;
+    int        m_rank;
+    MPI_Comm   m_comm;
+    MPI_Win    m_win;
+    std::mutex m_mutex;
+
+public:
+
+    FileQueue(long num_files, MPI_Comm comm) : m_counter(nullptr), m_num_files(num_files), m_rank(0), m_comm(comm)
+    {
+        MPI_Comm_rank(comm, &m_rank);
+
+        // let MPI allocate the window memory so it can use shared memory
+        // or RDMA-capable buffers for the atomics
+        MPI_Win_allocate(
+            m_rank == 0 ? sizeof(long) : 0,
+            sizeof(long),
+            MPI_INFO_NULL,
+            comm,
+            &m_counter,
+            &m_win
+        );
+
+        if (m_rank == 0) {
+            MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, m_win);
+            *m_counter = 0;
+            MPI_Win_unlock(0, m_win);
+        }
 
-    std::string filename = std::to_string(rank) + ".cali";
+        MPI_Barrier(comm);
+    }
 
-    if (!args.arguments().empty())
-        if (!args.arguments().front().empty())
-            filename = args.arguments().front() + "/" + filename;
+    ~FileQueue() { MPI_Win_free(&m_win); }
+
+    /// \brief Let MPI progress other ranks' requests on the counter. Only
+    ///   does something on rank 0, and never blocks.
+    void progress()
+    {
+        if (m_rank != 0)
+            return;
+
+        std::unique_lock<std::mutex> g(m_mutex, std::try_to_lock);
+
+        if (!g.owns_lock())
+            return;
+
+        int flag = 0;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, m_comm, &flag, MPI_STATUS_IGNORE);
+    }
+
+    /// \brief Return the index of the next file to process, or -1 if all
+    ///   files have been assigned
+    long next()
+    {
+        const long one = 1;
+        long       ret = 0;
+
+        {
+            // MPI is initialized with MPI_THREAD_SERIALIZED at most
+            std::lock_guard<std::mutex> g(m_mutex);
+
+            MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, m_win);
+            MPI_Fetch_and_op(&one, &ret, MPI_LONG, 0, 0, MPI_SUM, m_win);
+            MPI_Win_unlock(0, m_win);
+        }
+
+        return ret < m_num_files ? ret : -1;
+    }
+};
+
+void process_file(
+    int                rank,
+    const std::string& filename,
+    const QuerySpec&   spec,
+    CaliperMetadataDB& db,
+    Aggregator&        aggregate,
+    FileQueue&         queue
+)
+{
+    CALI_CXX_MARK_FUNCTION;
 
     NodeProcessFn node_proc = [](CaliperMetadataAccessInterface&, const Node*) {
         return;
@@ -135,6 +237,16 @@ void process_my_input(int rank, const Args& args, const QuerySpec& spec, Caliper
     if (spec.filter.selection == QuerySpec::FilterSelection::List)
         snap_proc = SnapshotFilterStep(RecordSelector(spec), snap_proc);
 
+    unsigned count = 0;
+
+    if (rank == 0)
+        snap_proc = [&queue, &count, snap_proc](CaliperMetadataAccessInterface& db, const EntryList& rec) {
+            if ((++count % 1024) == 0)
+                queue.progress();
+
+            snap_proc(db, rec);
+        };
+
     CaliReader reader;
     reader.read(filename, db, node_proc, snap_proc);
 
@@ -142,6 +254,42 @@ void process_my_input(int rank, const Args& args, const QuerySpec& spec, Caliper
         std::cerr << "mpi-caliquery (" << rank << "): error " << filename << ": " << reader.error_msg() << std::endl;
 }
 
+void process_input(
+    int                rank,
+    long               num_files,
+    unsigned           num_threads,
+    const Args&        args,
+    const QuerySpec&   spec,
+    CaliperMetadataDB& db,
+    Aggregator&        aggregate
+)
+{
+    CALI_CXX_MARK_FUNCTION;
+
+    std::string dir;
+
+    if (!args.arguments().empty())
+        if (!args.arguments().front().empty())
+            dir = args.arguments().front() + "/";
+
+    FileQueue queue(num_files, MPI_COMM_WORLD);
+
+    auto thread_fn = [&]() {
+        for (long i = queue.next(); i >= 0; i = queue.next())
+            process_file(rank, dir + std::to_string(i) + ".cali", spec, db, aggregate, queue);
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 1; t < num_threads; ++t)
+        threads.emplace_back(thread_fn);
+
+    thread_fn();
+
+    for (auto& t : threads)
+        t.join();
+}
+
 void setup_caliper_config(const Args& args)
 {
     cali_config_preset("CALI_LOG_VERBOSITY", "0");
@@ -185,7 +333,20 @@ int main(int argc, char* argv[])
     ::setup_caliper_config(args);
     cali::ConfigManager mgr;
 
-    MPI_Init(&argc, &argv);
+    unsigned num_threads = static_cast<unsigned>(StringConverter(args.get("threads", "1")).to_uint());
+
+    if (num_threads < 1)
+        num_threads = 1;
+
+    if (num_threads > 1) {
+        int provided = MPI_THREAD_SINGLE;
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+
+        if (provided < MPI_THREAD_SERIALIZED)
+            num_threads = 1;
+    } else {
+        MPI_Init(&argc, &argv);
+    }
 
     int rank;
     int worldsize;
@@ -193,6 +354,8 @@ int main(int argc, char* argv[])
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &worldsize);
 
+    long num_files = StringConverter(args.get("num-files", std::to_string(worldsize))).to_int();
+
     if (first_unknown_arg < argc) {
         if (rank == 0) {
             std::cerr << "mpi-caliquery: error: unknown option: " << argv[first_unknown_arg] << '\n'
@@ -236,10 +399,10 @@ int main(int argc, char* argv[])
     Aggregator        aggregate(spec);
     CaliperMetadataDB metadb;
 
-    // --- Process our own input
+    // --- Process input files
     //
 
-    ::process_my_input(rank, args, spec, metadb, aggregate);
+    ::process_input(rank, num_files, num_threads, args, spec, metadb, aggregate);
 
     // --- Aggregation loop
     //
@@ -227,7 +227,8 @@ int main(int argc, char* argv[])
         std::string s("chn.");
         s.append(std::to_string(x));
 
-        c.create_channel(s.c_str(), cali::RuntimeConfig::get_default_config());
+        cali::Channel channel = c.create_channel(s.c_str(), cali::RuntimeConfig::get_default_config());
+        c.activate_channel(channel);
     }
 
     // --- pre-timing loop. initializes OpenMP subsystem
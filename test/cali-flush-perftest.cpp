@@ -10,6 +10,10 @@
 //
 // The benchmark is multi-threaded: the loop is statically divided
 // between threads using OpenMP.
+//
+// With --write and --mode=trace, the flushed records are written through
+// the recorder service, so the result measures .cali output throughput
+// (e.g., use CALI_RECORDER_FILENAME=/dev/null to exclude disk I/O).
 
 #include <caliper/common/Attribute.h>
 #include <caliper/common/RuntimeConfig.h>
@@ -65,7 +69,18 @@ const util::Args::Table option_table[] = {
 
     { "channels", "channels", 'c', true, "Number of replicated channels", "CHANNELS" },
 
-    { "write", "write", 'w', false, "Write to output service in addition to flush", nullptr },
+    { "write",
+      "write",
+      'w',
+      false,
+      "Write to output service in addition to flush. Adds the recorder service in trace and aggregate mode",
+      nullptr },
+    { "mode",
+      "mode",
+      'm',
+      true,
+      "Buffer service to fill and flush: trace or aggregate. Default: use runtime configuration",
+      "MODE" },
 
     { "help", "help", 'h', false, "Print help", nullptr },
 
@@ -96,6 +111,21 @@ int main(int argc, char* argv[])
         return 2;
     }
 
+    std::string mode = args.get("mode", "");
+
+    // with --write, add the recorder to measure .cali output throughput
+    if (mode == "trace")
+        cali_config_preset("CALI_SERVICES_ENABLE", args.is_set("write") ? "event,trace,recorder" : "event,trace");
+    else if (mode == "aggregate")
+        cali_config_preset(
+            "CALI_SERVICES_ENABLE",
+            args.is_set("write") ? "event,aggregate,recorder" : "event,aggregate"
+        );
+    else if (!mode.empty()) {
+        std::cerr << "cali-flush-perftest: unknown mode \"" << mode << "\" (use trace or aggregate)" << std::endl;
+        return 1;
+    }
+
     int threads = 1;
 #ifdef _OPENMP
     threads = omp_get_max_threads();
@@ -116,6 +146,7 @@ int main(int argc, char* argv[])
     // --- print info
 
     std::cout << "cali-flush-perftest:"
+              << "\n    Mode:       " << (mode.empty() ? "(runtime config)" : mode)
               << "\n    Channels:   " << cfg.channels << "\n    Iterations: " << cfg.iter
               << "\n    Xtra:       " << cfg.nxtra
 #ifdef _OPENMP
@@ -177,8 +208,9 @@ int main(int argc, char* argv[])
 
     CALI_MARK_END("flush");
 
-    auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(etime - stime).count();
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(etime - stime).count();
+    auto msec = usec / 1000.0;
 
     std::cout << "  " << snapshots << " snapshots flushed in " << msec / 1000.0 << " sec, " << 1000.0 * msec / snapshots
-              << " usec/snapshot" << std::endl;
+              << " usec/snapshot, " << (usec > 0 ? 1e6 * snapshots / usec : 0.0) << " snapshots/sec" << std::endl;
 }
@@ -0,0 +1,113 @@
+// Copyright (c) 2015-2022, Lawrence Livermore National Security, LLC.
+// See top-level LICENSE file for details.
+
+// -- cali-startup-perftest
+//
+// Measures Caliper startup costs: runtime initialization, ConfigManager
+// setup (parsing the built-in config specs and the config string), and
+// channel creation.
+//
+// Runtime initialization happens only once per process. The ConfigManager
+// and channel setup steps are repeated and averaged.
+
+#include <caliper/Caliper.h>
+#include <caliper/ConfigManager.h>
+
+#include "../src/tools/util/Args.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+
+double usec_since(std::chrono::steady_clock::time_point t)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count();
+}
+
+} // namespace
+
+const util::Args::Table option_table[] = {
+    { "iterations", "iterations", 'i', true, "Number of ConfigManager/channel setup iterations", "ITERATIONS" },
+    { "config", "config", 'P', true, "Caliper config string (default: runtime-report)", "CONFIGSTRING" },
+    { "print-csv", "print-csv", 'c', false, "CSV output. Fields: init, configmanager, channel setup (usec)", nullptr },
+
+    { "help", "help", 'h', false, "Print help", nullptr },
+
+    util::Args::Terminator
+};
+
+int main(int argc, char* argv[])
+{
+    util::Args args(option_table);
+
+    int lastarg = args.parse(argc, argv);
+
+    if (lastarg < argc) {
+        std::cerr << "cali-startup-perftest: unknown option: " << argv[lastarg] << '\n' << "Available options: ";
+
+        args.print_available_options(std::cerr);
+
+        return 1;
+    }
+
+    if (args.is_set("help")) {
+        args.print_available_options(std::cerr);
+        return 2;
+    }
+
+    int         iter   = std::max(std::stoi(args.get("iterations", "100")), 1);
+    std::string config = args.get("config", "runtime-report,output=/dev/null");
+
+    // --- Caliper runtime initialization
+
+    auto   t         = std::chrono::steady_clock::now();
+    bool   ok        = static_cast<bool>(cali::Caliper::instance());
+    double init_usec = usec_since(t);
+
+    if (!ok) {
+        std::cerr << "cali-startup-perftest: Caliper initialization failed" << std::endl;
+        return 1;
+    }
+
+    // --- ConfigManager and channel setup
+
+    double mgr_usec = 0.0;
+    double chn_usec = 0.0;
+
+    for (int i = 0; i < iter; ++i) {
+        t = std::chrono::steady_clock::now();
+
+        cali::ConfigManager mgr;
+        mgr.add(config.c_str());
+
+        mgr_usec += usec_since(t);
+
+        if (mgr.error()) {
+            std::cerr << "cali-startup-perftest: config error: " << mgr.error_msg() << std::endl;
+            return 1;
+        }
+
+        t = std::chrono::steady_clock::now();
+
+        mgr.start();
+        mgr.stop();
+
+        chn_usec += usec_since(t);
+    }
+
+    mgr_usec /= iter;
+    chn_usec /= iter;
+
+    if (args.is_set("print-csv")) {
+        std::cout << init_usec << "," << mgr_usec << "," << chn_usec << std::endl;
+    } else {
+        std::cout << "cali-startup-perftest:"
+                  << "\n    Config:              " << config << "\n    Iterations:          " << iter
+                  << "\n    Initialization:      " << init_usec << " usec"
+                  << "\n    ConfigManager setup: " << mgr_usec << " usec"
+                  << "\n    Channel setup:       " << chn_usec << " usec" << std::endl;
+    }
+}
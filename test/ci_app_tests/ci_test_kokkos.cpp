@@ -0,0 +1,95 @@
+// --- Caliper continuous integration test app: Kokkos tool interface
+
+// Drives the Kokkos profiling hooks the way the Kokkos Serial backend
+// does, so the kokkostime service can be tested without Kokkos itself.
+
+#include "caliper/cali.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+extern "C"
+{
+void kokkosp_init_library(const int, const uint64_t, const uint32_t, void*);
+void kokkosp_finalize_library();
+void kokkosp_begin_parallel_for(const char*, const uint32_t, uint64_t*);
+void kokkosp_end_parallel_for(const uint64_t);
+void kokkosp_begin_parallel_reduce(const char*, const uint32_t, uint64_t*);
+void kokkosp_end_parallel_reduce(const uint64_t);
+void kokkosp_begin_fence(const char*, const uint32_t, uint64_t*);
+void kokkosp_end_fence(const uint64_t);
+void kokkosp_push_profile_region(char*);
+void kokkosp_pop_profile_region();
+}
+
+namespace
+{
+
+// kernel ID value if no tool assigned one
+const uint64_t no_kID = ~static_cast<uint64_t>(0);
+
+uint64_t parallel_for(const std::string& label)
+{
+    uint64_t kID = no_kID;
+    kokkosp_begin_parallel_for(label.c_str(), 0, &kID);
+    kokkosp_end_parallel_for(kID);
+    return kID;
+}
+
+uint64_t parallel_reduce(const std::string& label)
+{
+    uint64_t kID = no_kID;
+    kokkosp_begin_parallel_reduce(label.c_str(), 0, &kID);
+    kokkosp_end_parallel_reduce(kID);
+    return kID;
+}
+
+} // namespace
+
+int main()
+{
+    kokkosp_init_library(0, 20211015, 0, nullptr);
+
+    int ret = 0;
+
+    {
+        CALI_CXX_MARK_FUNCTION;
+
+        const std::string init_label = "init";
+        uint64_t          init_kID   = parallel_for(init_label);
+
+        for (int i = 0; i < 4; ++i) {
+            // labels are passed from temporary strings on every launch
+            uint64_t kID     = parallel_for(std::string("ini") + "t");
+            uint64_t dot_kID = parallel_reduce("dot");
+
+            if (init_kID == no_kID) // no kokkos service active
+                continue;
+
+            if (kID != init_kID) {
+                std::cerr << "kernel ID mismatch for kernel \"init\"" << std::endl;
+                ret = 1;
+            }
+            if (dot_kID == init_kID) {
+                std::cerr << "kernel \"dot\" has the same kernel ID as \"init\"" << std::endl;
+                ret = 1;
+            }
+        }
+
+        char region[] = "outer";
+        kokkosp_push_profile_region(region);
+
+        parallel_for(init_label);
+
+        uint64_t kID = no_kID;
+        kokkosp_begin_fence("sync", 0, &kID);
+        kokkosp_end_fence(kID);
+
+        kokkosp_pop_profile_region();
+    }
+
+    kokkosp_finalize_library();
+
+    return ret;
+}
@@ -0,0 +1,56 @@
+// Test Caliper MPI message tracing: point-to-point messages to self
+
+#include <caliper/cali.h>
+
+#include <mpi.h>
+
+int main(int argc, char* argv[])
+{
+    MPI_Init(&argc, &argv);
+
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    {
+        CALI_CXX_MARK_FUNCTION;
+
+        double sbuf[16] = { 0 };
+        double rbuf[16] = { 0 };
+
+        CALI_MARK_BEGIN("isend");
+
+        for (int i = 0; i < 4; ++i) {
+            MPI_Request req;
+            MPI_Isend(sbuf, 16, MPI_DOUBLE, rank, 1, MPI_COMM_WORLD, &req);
+            MPI_Recv(rbuf, 16, MPI_DOUBLE, rank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Wait(&req, MPI_STATUS_IGNORE);
+        }
+
+        CALI_MARK_END("isend");
+
+        CALI_MARK_BEGIN("sendrecv");
+
+        for (int i = 0; i < 2; ++i)
+            MPI_Sendrecv(sbuf, 8, MPI_INT, rank, 2, rbuf, 8, MPI_INT, rank, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+        CALI_MARK_END("sendrecv");
+
+        CALI_MARK_BEGIN("persistent");
+
+        MPI_Request reqs[2];
+        MPI_Send_init(sbuf, 4, MPI_DOUBLE, rank, 3, MPI_COMM_WORLD, reqs);
+        MPI_Recv_init(rbuf, 4, MPI_DOUBLE, rank, 3, MPI_COMM_WORLD, reqs + 1);
+
+        for (int i = 0; i < 3; ++i) {
+            MPI_Startall(2, reqs);
+            MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+        }
+
+        MPI_Request_free(reqs);
+        MPI_Request_free(reqs + 1);
+
+        CALI_MARK_END("persistent");
+    }
+
+    MPI_Finalize();
+}
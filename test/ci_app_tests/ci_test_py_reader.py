@@ -0,0 +1,101 @@
+# --- Caliper continuous integration test app for the native .cali reader
+#
+# Reads a .cali file with the native (compiled) and the pure-Python
+# caliperreader implementations and exits with an error if the results
+# differ.
+
+import math
+import sys
+
+sys.path.insert(0, "@PYPATH_TESTING@")
+sys.path.insert(0, "@PROJECT_SOURCE_DIR@/python/caliper-reader")
+
+import caliperreader as cr
+
+
+def same_value(a, b):
+    if isinstance(a, list) or isinstance(b, list):
+        return isinstance(a, list) and isinstance(b, list) and len(a) == len(b) and all(same_value(x, y) for x, y in zip(a, b))
+
+    if a == b:
+        return True
+
+    # the native reader re-formats numbers from their typed representation
+    try:
+        return math.isclose(float(a), float(b), rel_tol=1e-9)
+    except (TypeError, ValueError):
+        return False
+
+
+def compare_dicts(what, a, b):
+    errors = []
+
+    if set(a.keys()) != set(b.keys()):
+        errors.append("{}: keys differ: {} vs. {}".format(what, sorted(a.keys()), sorted(b.keys())))
+    else:
+        for k in a.keys():
+            if not same_value(a[k], b[k]):
+                errors.append("{}: {}: {} vs. {}".format(what, k, a[k], b[k]))
+
+    return errors
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: ci_test_py_reader.py FILE", file=sys.stderr)
+        sys.exit(2)
+    if not cr.have_native_reader():
+        print("native reader extension not available", file=sys.stderr)
+        sys.exit(1)
+
+    filename = sys.argv[1]
+
+    py_reader = cr.CaliperReader()
+    py_reader.read(filename)
+
+    native_reader = cr.NativeCaliperReader()
+    native_reader.read(filename)
+
+    errors = []
+
+    if len(py_reader.records) != len(native_reader.records):
+        errors.append("number of records differ: {} vs. {}".format(len(py_reader.records), len(native_reader.records)))
+    else:
+        for i, (a, b) in enumerate(zip(py_reader.records, native_reader.records)):
+            errors += compare_dicts("record {}".format(i), a, b)
+
+    errors += compare_dicts("globals", py_reader.globals, native_reader.globals)
+
+    if set(py_reader.attributes()) != set(native_reader.attributes()):
+        errors.append("attributes differ")
+
+    py_columns, _ = cr.read_caliper_columns(filename, native=False)
+    native_columns, _ = cr.read_caliper_columns(filename, native=True)
+
+    if set(py_columns.keys()) != set(native_columns.keys()):
+        errors.append("columns differ: {} vs. {}".format(sorted(py_columns.keys()), sorted(native_columns.keys())))
+    else:
+        for name, col in py_columns.items():
+            if isinstance(col, tuple):
+                values, valid = col
+                nvalues, nvalid = native_columns[name]
+                nvalues = memoryview(nvalues).tolist()
+                nvalid = memoryview(nvalid).tolist()
+
+                for i in range(len(valid)):
+                    if valid[i] != nvalid[i] or (valid[i] and not same_value(values[i], nvalues[i])):
+                        errors.append("column {}: row {} differs".format(name, i))
+            elif not all(same_value(a, b) for a, b in zip(col, native_columns[name])):
+                errors.append("column {} differs".format(name))
+
+    for e in errors[:20]:
+        print(e, file=sys.stderr)
+
+    if errors:
+        sys.exit(1)
+
+    print("{} records match".format(len(py_reader.records)))
+
+
+if __name__ == "__main__":
+    main()
@@ -7,6 +7,8 @@
 
 #include <pthread.h>
 
+#include <cstring>
+
 cali_id_t thread_attr_id = CALI_INV_ID;
 
 void* thread_proc(void* arg)
@@ -19,7 +21,7 @@ void* thread_proc(void* arg)
     return NULL;
 }
 
-int main()
+int main(int argc, char* argv[])
 {
     CALI_CXX_MARK_FUNCTION;
 
@@ -46,9 +48,17 @@ int main()
     cali::Annotation("local", CALI_ATTR_SCOPE_THREAD | CALI_ATTR_UNALIGNED).set(99);
     cali::Annotation("global", CALI_ATTR_SCOPE_PROCESS | CALI_ATTR_UNALIGNED).set(999);
 
-    for (int i = 0; i < 4; ++i)
-        pthread_create(&thread[i], NULL, thread_proc, &thread_ids[i]);
-
-    for (int i = 0; i < 4; ++i)
-        pthread_join(thread[i], NULL);
+    if (argc > 1 && strcmp(argv[1], "sequential") == 0) {
+        // run threads one after another so they re-use released thread data
+        for (int i = 0; i < 4; ++i) {
+            pthread_create(&thread[i], NULL, thread_proc, &thread_ids[i]);
+            pthread_join(thread[i], NULL);
+        }
+    } else {
+        for (int i = 0; i < 4; ++i)
+            pthread_create(&thread[i], NULL, thread_proc, &thread_ids[i]);
+
+        for (int i = 0; i < 4; ++i)
+            pthread_join(thread[i], NULL);
+    }
 }
@@ -143,5 +143,30 @@ class CaliperAggregationTest(unittest.TestCase):
                 'iteration'  : '3',
                 'count'      : '1' }))
 
+    def test_aggregate_merge_threads(self):
+        target_cmd = [ './ci_test_thread' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'   : 'aggregate:event:recorder',
+            'CALI_AGGREGATE_KEY'     : 'region',
+            'CALI_AGGREGATE_MERGE_THREADS' : 'true',
+            'CALI_AGGREGATE_MERGE_PARTITIONS' : '2',
+            'CALI_RECORDER_FILENAME' : 'stdout',
+            'CALI_LOG_VERBOSITY'     : '0'
+        }
+
+        query_output = calitest.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = calitest.get_snapshots_from_text(query_output)
+
+        thread_snapshots = [ s for s in snapshots if s.get('region') == 'thread_proc' ]
+
+        self.assertEqual(len(thread_snapshots), 1)
+        self.assertEqual(thread_snapshots[0]['count'], '8')
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, {
+                'region'     : 'main',
+                'count'      : '3' }))
+
 if __name__ == "__main__":
     unittest.main()
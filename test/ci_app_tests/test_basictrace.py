@@ -30,6 +30,50 @@ class CaliperBasicTraceTest(unittest.TestCase):
         self.assertTrue(cat.has_snapshot_with_attributes(
             snapshots, {'event.end#iteration': '3', 'iteration': '3', 'myphase': 'loop'}))
 
+    def test_trace_no_delta_encoding(self):
+        target_cmd = [ './ci_test_basic' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'CALI_CONFIG_PROFILE'        : 'serial-trace',
+            'CALI_RECORDER_FILENAME'     : 'stdout',
+            'CALI_TRACE_DELTA_ENCODING'  : 'false',
+            'CALI_LOG_VERBOSITY'         : '0'
+        }
+
+        query_output = cat.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = cat.get_snapshots_from_text(query_output)
+
+        self.assertTrue(len(snapshots) > 10)
+
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, {'event.end#myphase': 'initialization', 'myphase': 'initialization'}))
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, {'event.end#iteration': '3', 'iteration': '3', 'myphase': 'loop'}))
+
+    def test_trace_spill(self):
+        target_cmd = [ './ci_test_macros', '0', 'none', '200' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        # 1 MiB trace buffers fill up and spill to disk
+        caliper_config = {
+            'CALI_CONFIG_PROFILE'        : 'serial-trace',
+            'CALI_RECORDER_FILENAME'     : 'stdout',
+            'CALI_TRACE_BUFFER_SIZE'     : '1',
+            'CALI_TRACE_BUFFER_POLICY'   : 'spill',
+            'CALI_LOG_VERBOSITY'         : '0'
+        }
+
+        query_output = cat.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = cat.get_snapshots_from_text(query_output)
+
+        self.assertEqual(len(snapshots), 82012)
+
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'event.end#loop': 'main loop' }))
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'event.end#region': 'main' }))
+
     def test_cali_config(self):
         # Test the builtin ConfigManager (CALI_CONFIG env var)
 
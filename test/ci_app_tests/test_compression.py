@@ -0,0 +1,71 @@
+# Compressed output tests
+
+import gzip
+import os
+import shutil
+import tempfile
+import unittest
+
+import calipertest as cat
+
+class CaliperCompressionTest(unittest.TestCase):
+    """ Caliper compressed output test case """
+
+    def test_recorder_gzip_stream(self):
+        target_cmd = [ './ci_test_macros', '0', 'none', '10' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'CALI_CONFIG_PROFILE'       : 'serial-trace',
+            'CALI_RECORDER_FILENAME'    : 'stdout',
+            'CALI_RECORDER_COMPRESSION' : 'gzip',
+            'CALI_LOG_VERBOSITY'        : '0'
+        }
+
+        query_output = cat.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = cat.get_snapshots_from_text(query_output)
+
+        self.assertEqual(len(snapshots), 312)
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'event.end#region': 'main' }))
+
+    def test_file_suffix(self):
+        tmpdir = tempfile.mkdtemp()
+
+        try:
+            target_cmd = [ './ci_test_macros', '0', 'event-trace,output=' + tmpdir + '/trace.cali.gz', '10' ]
+            query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e', tmpdir + '/trace.cali.gz' ]
+
+            caliper_config = {
+                'CALI_LOG_VERBOSITY' : '0'
+            }
+
+            cat.run_test(target_cmd, caliper_config)
+
+            with gzip.open(tmpdir + '/trace.cali.gz', 'rt') as f:
+                self.assertTrue(f.readline().startswith('__rec='))
+
+            query_output = cat.run_test(query_cmd, caliper_config)
+            snapshots = cat.get_snapshots_from_text(query_output[0])
+
+            self.assertTrue(cat.has_snapshot_with_attributes(
+                snapshots, { 'event.end#region': 'main' }))
+        finally:
+            shutil.rmtree(tmpdir)
+
+    def test_report_gzip(self):
+        target_cmd = [ './ci_test_macros', '0', 'runtime-report,aggregate_across_ranks=false,output=stdout,output.compression=gzip', '10' ]
+
+        caliper_config = {
+            'CALI_LOG_VERBOSITY' : '0'
+        }
+
+        report_out, _ = cat.run_test(target_cmd, caliper_config)
+        report = gzip.decompress(report_out).decode()
+
+        self.assertIn('main', report)
+        self.assertIn('Time (E)', report)
+
+
+if __name__ == "__main__":
+    unittest.main()
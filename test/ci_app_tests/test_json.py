@@ -1,6 +1,7 @@
 # JSON output test cases
 
 import json
+import subprocess
 import unittest
 
 import calipertest as cat
@@ -103,6 +104,30 @@ class CaliperJSONTest(unittest.TestCase):
         # Note: this is a pretty fragile test
         self.assertEqual(data[9][iterindex], 3)
 
+    def test_jsonsplit_memory_budget(self):
+        """ Test json-split output with records spilled to disk """
+
+        target_cmd = [ './ci_test_macros', '0', 'none', '100' ]
+
+        caliper_config = {
+            'CALI_CONFIG_PROFILE'    : 'serial-trace',
+            'CALI_RECORDER_FILENAME' : 'stdout',
+            'CALI_LOG_VERBOSITY'     : '0'
+        }
+
+        # ~20000 trace records, well above the 1 MiB budget
+        trace,_ = cat.run_test(target_cmd, caliper_config)
+
+        def query(fmt):
+            query_cmd = [ '../../src/tools/cali-query/cali-query', '-q', 'format ' + fmt ]
+            return subprocess.run(query_cmd, input=trace, stdout=subprocess.PIPE, check=True).stdout
+
+        inmem = query('json-split')
+        spill = query('json-split(memory-budget=1)')
+
+        self.assertGreater(len(json.loads(inmem)['data']), 20000)
+        self.assertEqual(inmem, spill)
+
         
     def test_hatchetcontroller(self):
         """ Test hatchet-region-profile controller """
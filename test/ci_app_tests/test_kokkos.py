@@ -0,0 +1,81 @@
+# Tests for the Kokkos connector services
+
+import unittest
+
+import calipertest as calitest
+
+class CaliperKokkosTest(unittest.TestCase):
+    """ Caliper Kokkos test cases """
+
+    def test_kokkostime_trace(self):
+        target_cmd = [ './ci_test_kokkos' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'   : 'event,kokkostime,trace,recorder',
+            'CALI_RECORDER_FILENAME' : 'stdout',
+            'CALI_LOG_VERBOSITY'     : '0'
+        }
+
+        query_output = calitest.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = calitest.get_snapshots_from_text(query_output)
+
+        self.assertEqual(len([ s for s in snapshots if s.get('event.end#region') == 'init' ]), 6)
+        self.assertEqual(len([ s for s in snapshots if s.get('event.end#region') == 'dot' ]), 4)
+
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'event.end#region' : 'init',
+                         'kernel_type'      : 'kokkos.parallel_for',
+                         'region'           : 'main/init' }))
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'event.end#region' : 'dot',
+                         'kernel_type'      : 'kokkos.parallel_reduce',
+                         'region'           : 'main/dot' }))
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'event.end#region' : 'init',
+                         'kernel_type'      : 'kokkos.user_region/kokkos.parallel_for',
+                         'region'           : 'main/outer/init' }))
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'event.end#region' : 'sync',
+                         'kernel_type'      : 'kokkos.user_region/kokkos.fence',
+                         'region'           : 'main/outer/sync' }))
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'event.end#region' : 'outer',
+                         'kernel_type'      : 'kokkos.user_region',
+                         'region'           : 'main/outer' }))
+
+        # kernel paths must be fully removed again when kernels end
+        main_end = [ s for s in snapshots if s.get('event.end#region') == 'main' ]
+        self.assertEqual(len(main_end), 1)
+        self.assertEqual(main_end[0].get('region'), 'main')
+        self.assertNotIn('kernel_type', main_end[0])
+
+    def test_kokkos_runtime_report(self):
+        target_cmd = [ './ci_test_kokkos' ]
+
+        caliper_config = {
+            'CALI_CONFIG'        : 'runtime-report,profile.kokkos,output=stdout',
+            'CALI_LOG_VERBOSITY' : '0'
+        }
+
+        log_targets = [
+            'Path',
+            'main',
+            'init',
+            'dot',
+            'outer',
+            'sync'
+        ]
+
+        report_out,_ = calitest.run_test(target_cmd, caliper_config)
+        lines = report_out.decode().splitlines()
+
+        for target in log_targets:
+            for line in lines:
+                if target in line:
+                    break
+            else:
+                self.fail('%s not found in log' % target)
+
+if __name__ == "__main__":
+    unittest.main()
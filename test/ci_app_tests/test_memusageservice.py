@@ -28,5 +28,29 @@ class CaliperMemusageServiceTest(unittest.TestCase):
                          'myphase',
                          'iteration' }))
 
+    def test_memstat_async(self):
+        target_cmd = [ './ci_test_basic' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'   : 'event,memstat,trace,recorder',
+            'CALI_MEMSTAT_ASYNC'     : 'true',
+            'CALI_MEMSTAT_INTERVAL'  : '1',
+            'CALI_RECORDER_FILENAME' : 'stdout',
+            'CALI_LOG_VERBOSITY'     : '0'
+        }
+
+        query_output = calitest.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = calitest.get_snapshots_from_text(query_output)
+
+        self.assertTrue(len(snapshots) > 1)
+
+        self.assertTrue(calitest.has_snapshot_with_keys(
+            snapshots, { 'memstat.vmsize',
+                         'memstat.vmrss',
+                         'memstat.data',
+                         'myphase',
+                         'iteration' }))
+
 if __name__ == "__main__":
     unittest.main()
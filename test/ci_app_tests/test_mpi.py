@@ -1,8 +1,12 @@
 # MPI application tests
-# For simplicity, these tests only run on a single rank without mpiexec
+# For simplicity, these tests only run on a single rank without mpiexec,
+# except for the mpi-caliquery test which needs several ranks
 
 import json
 import os
+import shutil
+import subprocess
+import tempfile
 import unittest
 
 import calipertest as cat
@@ -167,6 +171,93 @@ class CaliperMPITest(unittest.TestCase):
             snapshots, { 'region', 'mpi.function', 'mpi.coll.type'
             }))
 
+    def test_mpi_msg_trace_p2p(self):
+        target_cmd = [ './ci_test_mpi_p2p' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query',
+                       '-q', 'aggregate count(),sum(mpi.msg.size) where mpi.msg.dst group by region,mpi.msg.tag format expand' ]
+
+        caliper_config = {
+            'PATH'                    : '/usr/bin', # for ssh/rsh
+            'CALI_LOG_VERBOSITY'      : '0',
+            'CALI_SERVICES_ENABLE'    : 'event,mpi,recorder,trace',
+            'CALI_MPI_MSG_TRACING'    : 'true',
+            'CALI_MPI_WHITELIST'      : 'all',
+            'CALI_RECORDER_FILENAME'  : 'stdout'
+        }
+
+        query_output = cat.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = cat.get_snapshots_from_text(query_output)
+
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'region'            : 'main/isend',
+                         'mpi.msg.tag'       : '1',
+                         'count'             : '4',
+                         'sum#mpi.msg.size'  : '512'
+            }))
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'region'            : 'main/sendrecv',
+                         'mpi.msg.tag'       : '2',
+                         'count'             : '2',
+                         'sum#mpi.msg.size'  : '64'
+            }))
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'region'            : 'main/persistent',
+                         'mpi.msg.tag'       : '3',
+                         'count'             : '3',
+                         'sum#mpi.msg.size'  : '96'
+            }))
+
+    def test_mpi_msg_aggregation(self):
+        target_cmd = [ './ci_test_mpi_p2p' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'PATH'                     : '/usr/bin', # for ssh/rsh
+            'CALI_LOG_VERBOSITY'       : '0',
+            'CALI_SERVICES_ENABLE'     : 'event,mpi,recorder,trace',
+            'CALI_MPI_MSG_AGGREGATION' : 'true',
+            'CALI_MPI_WHITELIST'       : 'all',
+            'CALI_RECORDER_FILENAME'   : 'stdout'
+        }
+
+        query_output = cat.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = cat.get_snapshots_from_text(query_output)
+
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'region'            : 'main/isend',
+                         'mpi.msg.dst'       : '0',
+                         'mpi.msg.tag'       : '1',
+                         'mpi.send.count'    : '4',
+                         'mpi.msg.size'      : '512',
+                         'min#mpi.msg.size'  : '128',
+                         'max#mpi.msg.size'  : '128'
+            }))
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'region'            : 'main/isend',
+                         'mpi.msg.src'       : '0',
+                         'mpi.msg.tag'       : '1',
+                         'mpi.recv.count'    : '4',
+                         'mpi.msg.size'      : '512'
+            }))
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'region'            : 'main/sendrecv',
+                         'mpi.msg.dst'       : '0',
+                         'mpi.msg.tag'       : '2',
+                         'mpi.send.count'    : '2',
+                         'mpi.msg.size'      : '64'
+            }))
+        self.assertTrue(cat.has_snapshot_with_attributes(
+            snapshots, { 'region'            : 'main/persistent',
+                         'mpi.msg.src'       : '0',
+                         'mpi.msg.tag'       : '3',
+                         'mpi.recv.count'    : '3',
+                         'mpi.msg.size'      : '96'
+            }))
+
+        # no per-message snapshots in aggregation mode
+        self.assertFalse(cat.has_snapshot_with_attributes(
+            snapshots, { 'mpi.send.count' : '1' }))
+
     def test_mpireport_controller(self):
         target_cmd = [ './ci_test_mpi_before_cali', 'mpi-report' ]
 
@@ -316,5 +407,38 @@ class CaliperMPITest(unittest.TestCase):
                          'mpi.function'  : 'MPI_Barrier'
             }))
 
+    @unittest.skipUnless(shutil.which('mpiexec'), 'mpiexec not found')
+    def test_mpi_caliquery_multirank(self):
+        """ mpi-caliquery's dynamic file queue on several ranks and threads """
+
+        query = 'select count(),loop group by loop format expand order by loop'
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            # files of different sizes, more files than ranks
+            for i in range(8):
+                cat.run_test([ './ci_test_macros', '0', 'none', str(i + 2) ], {
+                    'CALI_CONFIG_PROFILE'    : 'serial-trace',
+                    'CALI_RECORDER_FILENAME' : os.path.join(tmpdir, str(i) + '.cali'),
+                    'CALI_LOG_VERBOSITY'     : '0'
+                })
+
+            files = [ os.path.join(tmpdir, str(i) + '.cali') for i in range(8) ]
+            expected = subprocess.run([ '../../src/tools/cali-query/cali-query', '-q', query ] + files,
+                                      stdout=subprocess.PIPE, check=True).stdout
+
+            env = dict(os.environ, OMPI_ALLOW_RUN_AS_ROOT='1', OMPI_ALLOW_RUN_AS_ROOT_CONFIRM='1')
+
+            mpiexec = [ 'mpiexec', '-n', '3' ]
+            version = subprocess.run([ 'mpiexec', '--version' ], stdout=subprocess.PIPE, stderr=subprocess.STDOUT, env=env).stdout
+            if b'Open MPI' in version or b'OpenRTE' in version:
+                mpiexec.append('--oversubscribe')
+
+            cmd = mpiexec + [ '../../src/tools/mpi-caliquery/mpi-caliquery',
+                              '--num-files', '8', '--threads', '2', '-q', query, tmpdir ]
+
+            output = subprocess.run(cmd, stdout=subprocess.PIPE, env=env, timeout=120, check=True).stdout
+
+            self.assertEqual(output, expected)
+
 if __name__ == "__main__":
     unittest.main()
@@ -47,5 +47,39 @@ class CaliperOpenMPMetrics(unittest.TestCase):
                 if target in line:
                     break
 
+    def test_aggregate_sync(self):
+        target_cmd = [ './ci_test_openmp', 'hatchet-region-profile,openmp.aggregate_sync,output=stdout,output.format=json-split' ]
+
+        caliper_config = {
+            'CALI_LOG_VERBOSITY'     : '0'
+        }
+
+        obj = json.loads( cat.run_test(target_cmd, caliper_config)[0] )
+
+        self.assertIn('Time (barrier)', obj['columns'])
+
+        col = obj['columns'].index('Time (barrier)')
+
+        self.assertTrue(any(row[col] is not None and row[col] > 0 for row in obj['data']))
+
+    def test_aggregate_sync_trace(self):
+        target_cmd = [ './ci_test_openmp' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'      : 'event,ompt,trace,recorder',
+            'CALI_OMPT_AGGREGATE_SYNC'  : 'true',
+            'CALI_RECORDER_FILENAME'    : 'stdout',
+            'CALI_LOG_VERBOSITY'        : '0'
+        }
+
+        query_output = cat.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = cat.get_snapshots_from_text(query_output)
+
+        # sync regions are not recorded as events, only as counter records
+        self.assertFalse(cat.has_snapshot_with_keys(snapshots, { 'event.begin#omp.sync' }))
+        self.assertTrue(cat.has_snapshot_with_keys(
+            snapshots, { 'omp.sync', 'omp.sync.count', 'omp.sync.duration.ns', 'region' }))
+
 if __name__ == "__main__":
     unittest.main()
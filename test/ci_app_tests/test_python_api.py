@@ -1,6 +1,8 @@
 # Tests of the Python API
 
+import os
 import sys
+import tempfile
 
 import unittest
 
@@ -91,6 +93,25 @@ class CaliperPythonAPITest(unittest.TestCase):
             )
         )
 
+    def test_native_reader(self):
+        """Native and pure-Python .cali readers return the same data"""
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            califile = os.path.join(tmpdir, "trace.cali")
+
+            caliper_config = {
+                "CALI_CONFIG_PROFILE": "serial-trace",
+                "CALI_RECORDER_FILENAME": califile,
+                "CALI_LOG_VERBOSITY": "0",
+            }
+
+            cat.run_test([sys.executable, "./ci_test_py_ann.py"], caliper_config)
+
+            # exits with an error if the readers disagree
+            out, _ = cat.run_test([sys.executable, "./ci_test_py_reader.py", califile], {})
+
+            self.assertIn(b"records match", out)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,134 @@
+# Tests for the shmring service and the cali-shmring consumer
+
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+import unittest
+
+import calipertest as calitest
+
+class CaliperShmRingTest(unittest.TestCase):
+    """ Caliper shmring service test cases """
+
+    query = 'aggregate count() group by region,loop format expand'
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir, ignore_errors=True)
+
+    def start_consumer(self, query):
+        consumer_cmd = [ '../../src/tools/cali-shmring/cali-shmring',
+                         '-d', self.tmpdir, '-n', '1', '-t', '30', '-q', query ]
+
+        return subprocess.Popen(consumer_cmd, stdout=subprocess.PIPE)
+
+    def run_target(self, keep_unattached=False):
+        target_cmd = [ './ci_test_macros', '0', 'none', '4' ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'   : 'event,shmring',
+            'CALI_SHMRING_DIRECTORY' : self.tmpdir,
+            'CALI_SHMRING_KEEP_UNATTACHED' : 'true' if keep_unattached else 'false',
+            'CALI_LOG_VERBOSITY'     : '0'
+        }
+
+        calitest.run_test(target_cmd, caliper_config)
+
+    def test_shmring_matches_trace(self):
+        """ The consumer sees the same snapshots as the trace service """
+
+        # the consumer may only find the segment after the program is done
+        consumer = self.start_consumer(self.query)
+        self.run_target(keep_unattached=True)
+
+        consumer_out,_ = consumer.communicate(timeout=60)
+        self.assertEqual(consumer.returncode, 0)
+
+        target_cmd = [ './ci_test_macros', '0', 'none', '4' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-q', self.query ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'   : 'event,trace,recorder',
+            'CALI_RECORDER_FILENAME' : 'stdout',
+            'CALI_LOG_VERBOSITY'     : '0'
+        }
+
+        trace_out = calitest.run_test_with_query(target_cmd, query_cmd, caliper_config)
+
+        snapshots = calitest.get_snapshots_from_text(consumer_out)
+
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'region' : 'main/foo', 'loop' : 'main loop/fooloop' }))
+        self.assertEqual(sorted(consumer_out.decode().splitlines()),
+                         sorted(trace_out.decode().splitlines()))
+
+        # the consumer removes the segment when it's done
+        self.assertEqual(os.listdir(self.tmpdir), [])
+
+    def test_shmring_late_consumer(self):
+        """ A consumer started after the program exits still gets its data """
+
+        self.run_target(keep_unattached=True)
+
+        segments = os.listdir(self.tmpdir)
+        self.assertEqual(len(segments), 1)
+        self.assertTrue(segments[0].startswith('caliper-shmring-'))
+
+        consumer = self.start_consumer('select region,count() group by region format expand')
+        consumer_out,_ = consumer.communicate(timeout=60)
+        self.assertEqual(consumer.returncode, 0)
+
+        snapshots = calitest.get_snapshots_from_text(consumer_out)
+
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'region' : 'main/foo', 'count' : '48' }))
+        self.assertEqual(os.listdir(self.tmpdir), [])
+
+    def test_shmring_no_consumer(self):
+        """ The segment is removed at exit if no consumer attached """
+
+        self.run_target()
+
+        self.assertEqual(os.listdir(self.tmpdir), [])
+
+    def test_shmring_killed_producer(self):
+        """ The consumer detaches from a process that was killed """
+
+        consumer = self.start_consumer(self.query)
+
+        target_cmd = [ './ci_test_macros', '100000', 'none', '100' ]
+
+        env = os.environ.copy()
+        env.update({
+            'CALI_SERVICES_ENABLE'   : 'event,shmring',
+            'CALI_SHMRING_DIRECTORY' : self.tmpdir,
+            'CALI_LOG_VERBOSITY'     : '0'
+        })
+
+        target = subprocess.Popen(target_cmd, env=env, stdout=subprocess.DEVNULL)
+
+        for _ in range(100):
+            if os.listdir(self.tmpdir):
+                break
+            time.sleep(0.05)
+
+        time.sleep(0.2)
+        target.kill()
+        target.wait()
+
+        # well before the 30 second timeout
+        consumer_out,_ = consumer.communicate(timeout=10)
+        self.assertEqual(consumer.returncode, 0)
+
+        snapshots = calitest.get_snapshots_from_text(consumer_out)
+
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'region' : 'main' }))
+        self.assertEqual(os.listdir(self.tmpdir), [])
+
+if __name__ == "__main__":
+    unittest.main()
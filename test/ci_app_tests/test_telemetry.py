@@ -0,0 +1,112 @@
+# Tests for the telemetry service and the cali-telemetry collector
+
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+import unittest
+
+import calipertest as calitest
+
+class CaliperTelemetryTest(unittest.TestCase):
+    """ Caliper telemetry service test cases """
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.socket = os.path.join(self.tmpdir, 'telemetry.sock')
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir, ignore_errors=True)
+
+    def start_collector(self, query):
+        collector_cmd = [ '../../src/tools/cali-telemetry/cali-telemetry',
+                          '-s', self.socket, '-n', '1', '-t', '30', '-q', query ]
+
+        proc = subprocess.Popen(collector_cmd, stdout=subprocess.PIPE)
+
+        for _ in range(100):
+            if os.path.exists(self.socket):
+                break
+            time.sleep(0.05)
+        else:
+            proc.kill()
+            self.fail('collector socket was not created')
+
+        return proc
+
+    def test_telemetry_collector(self):
+        collector = self.start_collector('select * format expand')
+
+        target_cmd = [ './ci_test_macros', '5000', 'none', '8' ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'    : 'telemetry',
+            'CALI_TELEMETRY_SOCKET'   : self.socket,
+            'CALI_TELEMETRY_INTERVAL' : '0.05',
+            'CALI_LOG_VERBOSITY'      : '0'
+        }
+
+        calitest.run_test(target_cmd, caliper_config)
+
+        collector_out,_ = collector.communicate(timeout=60)
+        self.assertEqual(collector.returncode, 0)
+
+        snapshots = calitest.get_snapshots_from_text(collector_out)
+
+        self.assertTrue(calitest.has_snapshot_with_keys(
+            snapshots, { 'region', 'loop', 'count', 'sum#time.duration.ns',
+                         'telemetry.pid', 'telemetry.sequence' }))
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'region' : 'main/foo', 'loop' : 'main loop/fooloop' }))
+        self.assertFalse(calitest.has_snapshot_with_keys(snapshots, { 'cali.caliper.version' }))
+
+        # the run takes ~320ms, so we should get several intervals
+        seqs = set([ s.get('telemetry.sequence') for s in snapshots if 'telemetry.sequence' in s ])
+        self.assertGreater(len(seqs), 1)
+
+        # the per-interval profiles add up to the full profile: 64 fooloop
+        # iteration begin and end events each, plus 8 fooloop end events
+        foo_count = sum([ int(s.get('count')) for s in snapshots
+                          if s.get('region') == 'main/foo' and s.get('loop') == 'main loop/fooloop' ])
+        self.assertEqual(foo_count, 136)
+
+    def test_telemetry_aggregate_query(self):
+        collector = self.start_collector('select region,sum(count) group by region format expand')
+
+        target_cmd = [ './ci_test_macros', '0', 'none', '4' ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'    : 'telemetry',
+            'CALI_TELEMETRY_SOCKET'   : self.socket,
+            'CALI_LOG_VERBOSITY'      : '0'
+        }
+
+        calitest.run_test(target_cmd, caliper_config)
+
+        collector_out,_ = collector.communicate(timeout=60)
+        self.assertEqual(collector.returncode, 0)
+
+        snapshots = calitest.get_snapshots_from_text(collector_out)
+
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'region' : 'main/foo' }))
+        self.assertTrue(calitest.has_snapshot_with_attributes(
+            snapshots, { 'region' : 'main/bar' }))
+
+    def test_telemetry_without_collector(self):
+        """ The application must not block or fail when nobody is listening """
+
+        target_cmd = [ './ci_test_macros', '0', 'none', '4' ]
+
+        caliper_config = {
+            'CALI_SERVICES_ENABLE'    : 'telemetry',
+            'CALI_TELEMETRY_SOCKET'   : self.socket,
+            'CALI_TELEMETRY_INTERVAL' : '0.01',
+            'CALI_LOG_VERBOSITY'      : '0'
+        }
+
+        calitest.run_test(target_cmd, caliper_config)
+
+if __name__ == "__main__":
+    unittest.main()
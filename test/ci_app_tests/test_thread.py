@@ -38,5 +38,55 @@ class CaliperThreadTest(unittest.TestCase):
             snapshots, { 'region'      : 'main',
                          'local'       : '99' }))
 
+    def test_thread_reuse(self):
+        target_cmd = [ './ci_test_thread', 'sequential' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'CALI_CONFIG_PROFILE'    : 'serial-trace',
+            'CALI_RECORDER_FILENAME' : 'stdout',
+            'CALI_LOG_VERBOSITY'     : '0'
+        }
+
+        query_output = calitest.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = calitest.get_snapshots_from_text(query_output)
+
+        for tid in [ '16', '25', '36', '49' ]:
+            self.assertTrue(calitest.has_snapshot_with_attributes(
+                snapshots, {'my_thread_id' : tid,
+                            'region'       : 'thread_proc' }))
+
+        # thread-local values must not carry over into re-used thread data
+        self.assertFalse(calitest.has_snapshot_with_keys(
+            snapshots, {'event.begin#region', 'my_thread_id' }))
+
+        # inclusive timer stacks of re-used timer data must still pair up
+        for tid in [ '16', '25', '36', '49' ]:
+            self.assertTrue(calitest.has_snapshot_with_keys(
+                [ s for s in snapshots if s.get('my_thread_id') == tid and 'event.end#region' in s ],
+                { 'time.inclusive.duration.ns' }))
+
+    def test_thread_small_blocktable(self):
+        # each thread takes its own node block, so with one block per
+        # block table the metadata tree has to grow its block table
+        target_cmd = [ './ci_test_thread' ]
+        query_cmd  = [ '../../src/tools/cali-query/cali-query', '-e' ]
+
+        caliper_config = {
+            'CALI_CONFIG_PROFILE'         : 'serial-trace',
+            'CALI_RECORDER_FILENAME'      : 'stdout',
+            'CALI_CONTEXTTREE_NUM_BLOCKS' : '1',
+            'CALI_LOG_VERBOSITY'          : '0'
+        }
+
+        query_output = calitest.run_test_with_query(target_cmd, query_cmd, caliper_config)
+        snapshots = calitest.get_snapshots_from_text(query_output)
+
+        for tid in [ '16', '25', '36', '49' ]:
+            self.assertTrue(calitest.has_snapshot_with_attributes(
+                snapshots, {'my_thread_id' : tid,
+                            'region'       : 'thread_proc',
+                            'global'       : '999' }))
+
 if __name__ == "__main__":
     unittest.main()